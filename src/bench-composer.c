@@ -0,0 +1,264 @@
+/* vim:set et sts=4: */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <glib.h>
+#include <hangul.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <locale.h>
+#include <time.h>
+
+#include "composer.h"
+
+/* Checks the fast path of Composer against libhangul, and measures it.
+ *
+ * For every standard keyboard a random keystroke corpus is typed into a
+ * Composer and into a plain HangulInputContext. The return value, the
+ * commit string and the preedit string must be the same after every
+ * key. The corpus is typed twice: first while the transition table is
+ * still being filled, then once it mostly is. The seed is fixed, so a
+ * failure can be reproduced. Exits with 1 on any difference. */
+
+#define N_EVENTS        200000
+#define N_ROUNDS        5
+#define SEED            20100521
+
+enum {
+    EVENT_BACKSPACE = -1,
+    EVENT_FLUSH     = -2,
+    EVENT_RESET     = -3,
+};
+
+static const gchar *keyboards[] = {
+    "2", "2y", "32", "39", "3f", "3s", "3y"
+};
+
+static gdouble
+now (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static gboolean
+ucs_equal (const ucschar *a, const ucschar *b)
+{
+    while (*a != 0 && *a == *b) {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+/* Mostly letters, as in text, with the rest of the keyboard, BackSpace
+ * and the odd key that is not ASCII. */
+static GArray*
+corpus_new (guint32 seed)
+{
+    static const gchar punctuation[] = " .,;'/[]-=`!?\"()";
+    GArray *corpus;
+    GRand *rand;
+    guint i;
+
+    corpus = g_array_sized_new (FALSE, FALSE, sizeof (gint), N_EVENTS);
+    rand = g_rand_new_with_seed (seed);
+
+    for (i = 0; i < N_EVENTS; ++i) {
+        gint r = g_rand_int_range (rand, 0, 1000);
+        gint event;
+
+        if (r < 620)
+            event = 'a' + g_rand_int_range (rand, 0, 26);
+        else if (r < 720)
+            event = 'A' + g_rand_int_range (rand, 0, 26);
+        else if (r < 800)
+            event = punctuation[g_rand_int_range (rand, 0,
+                                              sizeof (punctuation) - 1)];
+        else if (r < 850)
+            event = '0' + g_rand_int_range (rand, 0, 10);
+        else if (r < 950)
+            event = EVENT_BACKSPACE;
+        else if (r < 970)
+            event = EVENT_FLUSH;
+        else if (r < 980)
+            event = EVENT_RESET;
+        else
+            event = 0xa0 + g_rand_int_range (rand, 0, 0x60);
+
+        g_array_append_val (corpus, event);
+    }
+
+    g_rand_free (rand);
+    return corpus;
+}
+
+static gboolean
+check (const gchar *keyboard, GArray *corpus, Composer *composer,
+       HangulInputContext *context)
+{
+    guint i;
+
+    for (i = 0; i < corpus->len; ++i) {
+        gint event = g_array_index (corpus, gint, i);
+        gboolean retval1 = FALSE;
+        gboolean retval2 = FALSE;
+        const ucschar *commit1;
+        const ucschar *commit2;
+
+        if (event == EVENT_BACKSPACE) {
+            retval1 = composer_backspace (composer);
+            retval2 = hangul_ic_backspace (context);
+        } else if (event == EVENT_FLUSH) {
+            commit1 = composer_flush (composer);
+            commit2 = hangul_ic_flush (context);
+            if (!ucs_equal (commit1, commit2))
+                goto fail;
+            continue;
+        } else if (event == EVENT_RESET) {
+            composer_reset (composer);
+            hangul_ic_reset (context);
+            continue;
+        } else {
+            retval1 = composer_process (composer, event);
+            retval2 = hangul_ic_process (context, event);
+        }
+
+        if (retval1 != retval2)
+            goto fail;
+        if (!ucs_equal (composer_get_commit_string (composer),
+                        hangul_ic_get_commit_string (context)))
+            goto fail;
+        if (!ucs_equal (composer_get_preedit_string (composer),
+                        hangul_ic_get_preedit_string (context)))
+            goto fail;
+        continue;
+
+fail:
+        g_print ("  %s: differs from libhangul at event %u (%d)\n",
+                 keyboard, i, event);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static gdouble
+time_composer (GArray *corpus, Composer *composer)
+{
+    gdouble start;
+    guint round;
+    guint i;
+    gsize sum = 0;
+
+    start = now ();
+    for (round = 0; round < N_ROUNDS; ++round) {
+        for (i = 0; i < corpus->len; ++i) {
+            gint event = g_array_index (corpus, gint, i);
+
+            if (event == EVENT_BACKSPACE) {
+                composer_backspace (composer);
+            } else if (event == EVENT_FLUSH) {
+                sum += composer_flush (composer)[0];
+                continue;
+            } else if (event == EVENT_RESET) {
+                composer_reset (composer);
+                continue;
+            } else {
+                composer_process (composer, event);
+            }
+            sum += composer_get_commit_string (composer)[0];
+            sum += composer_get_preedit_string (composer)[0];
+        }
+    }
+
+    // keep the loop from being optimized away
+    if (sum == 1)
+        g_print (" ");
+
+    return (now () - start) * 1e9 / (N_ROUNDS * corpus->len);
+}
+
+static gdouble
+time_context (GArray *corpus, HangulInputContext *context)
+{
+    gdouble start;
+    guint round;
+    guint i;
+    gsize sum = 0;
+
+    start = now ();
+    for (round = 0; round < N_ROUNDS; ++round) {
+        for (i = 0; i < corpus->len; ++i) {
+            gint event = g_array_index (corpus, gint, i);
+
+            if (event == EVENT_BACKSPACE) {
+                hangul_ic_backspace (context);
+            } else if (event == EVENT_FLUSH) {
+                sum += hangul_ic_flush (context)[0];
+                continue;
+            } else if (event == EVENT_RESET) {
+                hangul_ic_reset (context);
+                continue;
+            } else {
+                hangul_ic_process (context, event);
+            }
+            sum += hangul_ic_get_commit_string (context)[0];
+            sum += hangul_ic_get_preedit_string (context)[0];
+        }
+    }
+
+    if (sum == 1)
+        g_print (" ");
+
+    return (now () - start) * 1e9 / (N_ROUNDS * corpus->len);
+}
+
+int
+main (gint argc, gchar **argv)
+{
+    GArray *corpus;
+    gboolean ok = TRUE;
+    guint32 seed = SEED;
+    guint i;
+
+    setlocale (LC_ALL, "");
+
+    if (argc > 1)
+        seed = strtoul (argv[1], NULL, 10);
+
+    corpus = corpus_new (seed);
+    composer_set_fast_path (TRUE);
+
+    g_print ("%u events, seed %u\n", corpus->len, seed);
+    g_print ("  %-8s %16s %16s\n", "keyboard",
+             "libhangul (ns)", "Composer (ns)");
+
+    for (i = 0; i < G_N_ELEMENTS (keyboards); ++i) {
+        Composer *composer;
+        HangulInputContext *context;
+
+        composer = composer_new (keyboards[i]);
+        context = hangul_ic_new (keyboards[i]);
+
+        if (!check (keyboards[i], corpus, composer, context) ||
+            !check (keyboards[i], corpus, composer, context)) {
+            ok = FALSE;
+        } else {
+            g_print ("  %-8s %16.1f %16.1f\n", keyboards[i],
+                     time_context (corpus, context),
+                     time_composer (corpus, composer));
+        }
+
+        composer_delete (composer);
+        hangul_ic_delete (context);
+    }
+
+    composer_cleanup ();
+    g_array_free (corpus, TRUE);
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,348 @@
+/* vim:set et sts=4: */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <glib.h>
+#include <hangul.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <locale.h>
+#include <malloc.h>
+#include <time.h>
+
+#include "dictionary.h"
+#include "dicttrie.h"
+
+/* Benchmarks of the dictionary layer alone: load time, memory, prefix
+ * match latency and the cost of walking the results, for libhangul's
+ * HanjaTable and for our DictTrie.
+ *
+ * The queries are taken from the dictionary files at fixed strides, so
+ * the same files always give the same query sets. A miss is a key with
+ * its last syllable replaced until it is not a key any more; prefix
+ * matching still finds its shorter prefixes, as it would when typing. */
+
+#define N_QUERIES       1000
+#define N_ROUNDS        100
+/* candidates in a lookup table page */
+#define PAGE_SIZE       9
+
+typedef struct _QuerySet QuerySet;
+
+struct _QuerySet {
+    const gchar *name;
+    guint        min_length;
+    guint        max_length;
+    guint        hit_percent;
+};
+
+static const QuerySet query_sets[] = {
+    { "short, all hits",        1,  1, 100 },
+    { "short, half hits",       1,  1,  50 },
+    { "short, all misses",      1,  1,   0 },
+    { "long, all hits",         3, 16, 100 },
+    { "long, half hits",        3, 16,  50 },
+    { "long, all misses",       3, 16,   0 },
+};
+
+static gdouble
+now (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static gsize
+heap_size (void)
+{
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 33)
+    struct mallinfo2 info = mallinfo2 ();
+    return info.uordblks + info.hblkhd;
+#else
+    struct mallinfo info = mallinfo ();
+    return (guint) info.uordblks + (guint) info.hblkhd;
+#endif
+}
+
+/* Returns key with its last syllable changed so that it is not a key
+ * of dict, or NULL. */
+static gchar*
+make_miss (const Dictionary *dict, const gchar *key)
+{
+    GString *miss;
+    gunichar c;
+    guint i;
+
+    miss = g_string_new (key);
+    c = g_utf8_get_char (g_utf8_prev_char (key + strlen (key)));
+    if (c < 0xac00 || c > 0xd7a3) {
+        g_string_free (miss, TRUE);
+        return NULL;
+    }
+
+    for (i = 1; i < 64; ++i) {
+        gunichar s = 0xac00 + (c - 0xac00 + i * 28) % 11172;
+
+        g_string_truncate (miss,
+                g_utf8_prev_char (miss->str + miss->len) - miss->str);
+        g_string_append_unichar (miss, s);
+        if (dictionary_find_key (dict, miss->str) < 0)
+            return g_string_free (miss, FALSE);
+    }
+
+    g_string_free (miss, TRUE);
+    return NULL;
+}
+
+static GPtrArray*
+query_set_make (const QuerySet *set, const Dictionary *dict)
+{
+    GPtrArray *queries;
+    GArray *key_ids;
+    guint n_keys;
+    guint i;
+
+    // all keys of the wanted length, then N_QUERIES of them evenly spread
+    key_ids = g_array_new (FALSE, FALSE, sizeof (guint));
+    n_keys = dictionary_get_n_keys (dict);
+    for (i = 0; i < n_keys; ++i) {
+        glong length = g_utf8_strlen (dictionary_get_key (dict, i), -1);
+        if (length >= set->min_length && length <= set->max_length)
+            g_array_append_val (key_ids, i);
+    }
+
+    queries = g_ptr_array_new ();
+    for (i = 0; i < N_QUERIES && key_ids->len > 0; ++i) {
+        guint key_id = g_array_index (key_ids, guint,
+                                      (guint64) i * key_ids->len / N_QUERIES);
+        const gchar *key = dictionary_get_key (dict, key_id);
+        gchar *query = NULL;
+
+        if (i % 100 >= set->hit_percent)
+            query = make_miss (dict, key);
+        if (query == NULL)
+            query = g_strdup (key);
+
+        g_ptr_array_add (queries, query);
+    }
+
+    g_array_free (key_ids, TRUE);
+    return queries;
+}
+
+static void
+query_set_free (GPtrArray *queries)
+{
+    g_ptr_array_foreach (queries, (GFunc) g_free, NULL);
+    g_ptr_array_free (queries, TRUE);
+}
+
+static gdouble
+bench_table_match (HanjaTable *table, GPtrArray *queries, gboolean iterate)
+{
+    gdouble start;
+    guint round;
+    guint i;
+    gsize sum = 0;
+
+    start = now ();
+    for (round = 0; round < N_ROUNDS; ++round) {
+        for (i = 0; i < queries->len; ++i) {
+            HanjaList *list;
+            gint j, n;
+
+            list = hanja_table_match_prefix (table,
+                                             g_ptr_array_index (queries, i));
+            if (list == NULL)
+                continue;
+
+            if (iterate) {
+                n = hanja_list_get_size (list);
+                for (j = 0; j < n; ++j) {
+                    sum += strlen (hanja_list_get_nth_key (list, j));
+                    sum += strlen (hanja_list_get_nth_value (list, j));
+                    sum += strlen (hanja_list_get_nth_comment (list, j));
+                }
+            }
+            hanja_list_delete (list);
+        }
+    }
+
+    // keep the loop from being optimized away
+    if (sum == 1)
+        g_print (" ");
+
+    return (now () - start) * 1e9 / (N_ROUNDS * queries->len);
+}
+
+static gdouble
+bench_trie_match (DictTrie *trie, GPtrArray *queries, gboolean iterate)
+{
+    gdouble start;
+    guint round;
+    guint i;
+    gsize sum = 0;
+
+    start = now ();
+    for (round = 0; round < N_ROUNDS; ++round) {
+        for (i = 0; i < queries->len; ++i) {
+            CandidateList *list;
+            guint j, n;
+
+            list = candidate_list_new ();
+            dict_trie_match_prefix (trie, NULL, g_ptr_array_index (queries, i),
+                                    list);
+
+            if (iterate) {
+                n = candidate_list_get_size (list);
+                for (j = 0; j < n; ++j) {
+                    sum += strlen (candidate_list_get_nth_key (list, j));
+                    sum += strlen (candidate_list_get_nth_value (list, j));
+                    sum += strlen (candidate_list_get_nth_comment (list, j));
+                }
+            }
+            candidate_list_delete (list);
+        }
+    }
+
+    if (sum == 1)
+        g_print (" ");
+
+    return (now () - start) * 1e9 / (N_ROUNDS * queries->len);
+}
+
+/* the first page of a bounded search, and its total if count */
+static gdouble
+bench_trie_page (DictTrie *trie, GPtrArray *queries, gboolean count)
+{
+    gdouble start;
+    guint round;
+    guint i;
+    gsize sum = 0;
+
+    start = now ();
+    for (round = 0; round < N_ROUNDS; ++round) {
+        for (i = 0; i < queries->len; ++i) {
+            DictTrieSearch *search;
+            CandidateList *list;
+            guint j, n;
+
+            list = candidate_list_new ();
+            search = dict_trie_search_new (trie, NULL,
+                                           g_ptr_array_index (queries, i));
+            dict_trie_search_next (search, PAGE_SIZE, list);
+            if (count)
+                sum += dict_trie_search_get_total (search);
+
+            n = candidate_list_get_size (list);
+            for (j = 0; j < n; ++j) {
+                sum += strlen (candidate_list_get_nth_key (list, j));
+                sum += strlen (candidate_list_get_nth_value (list, j));
+                sum += strlen (candidate_list_get_nth_comment (list, j));
+            }
+            dict_trie_search_free (search);
+            candidate_list_delete (list);
+        }
+    }
+
+    if (sum == 1)
+        g_print (" ");
+
+    return (now () - start) * 1e9 / (N_ROUNDS * queries->len);
+}
+
+static void
+bench_dictionary (const gchar *name, const gchar *filename)
+{
+    HanjaTable *table;
+    DictTrie *trie;
+    Dictionary *dict;
+    gdouble start;
+    gdouble table_time;
+    gdouble trie_time;
+    gsize before;
+    gsize table_size;
+    gsize trie_size;
+    guint i;
+
+    g_print ("%s: %s\n", name, filename);
+
+    before = heap_size ();
+    start = now ();
+    table = hanja_table_load (filename);
+    table_time = now () - start;
+    table_size = heap_size () - before;
+
+    before = heap_size ();
+    start = now ();
+    trie = dict_trie_load (filename);
+    trie_time = now () - start;
+    trie_size = heap_size () - before;
+
+    dict = dictionary_load (filename);
+
+    if (table == NULL || trie == NULL || dict == NULL) {
+        g_print ("  can't load the dictionary\n");
+        goto out;
+    }
+
+    g_print ("  %u keys\n", dictionary_get_n_keys (dict));
+    g_print ("  %-24s %10s %12s\n", "", "load (ms)", "heap (bytes)");
+    g_print ("  %-24s %10.1f %12lu\n", "HanjaTable",
+             table_time * 1e3, (gulong) table_size);
+    g_print ("  %-24s %10.1f %12lu\n", "DictTrie",
+             trie_time * 1e3, (gulong) trie_size);
+
+    g_print ("  %-24s %12s %12s %12s %12s %12s %12s\n",
+             "match_prefix (ns/query)",
+             "HanjaTable", "+ iterate", "DictTrie", "+ iterate",
+             "first page", "+ total");
+    for (i = 0; i < G_N_ELEMENTS (query_sets); ++i) {
+        GPtrArray *queries = query_set_make (&query_sets[i], dict);
+
+        if (queries->len == 0) {
+            query_set_free (queries);
+            continue;
+        }
+
+        g_print ("  %-24s %12.0f %12.0f %12.0f %12.0f %12.0f %12.0f\n",
+                 query_sets[i].name,
+                 bench_table_match (table, queries, FALSE),
+                 bench_table_match (table, queries, TRUE),
+                 bench_trie_match (trie, queries, FALSE),
+                 bench_trie_match (trie, queries, TRUE),
+                 bench_trie_page (trie, queries, FALSE),
+                 bench_trie_page (trie, queries, TRUE));
+
+        query_set_free (queries);
+    }
+
+out:
+    dictionary_delete (dict);
+    dict_trie_delete (trie);
+    if (table != NULL)
+        hanja_table_delete (table);
+}
+
+int
+main (gint argc, gchar **argv)
+{
+    const gchar *hanja_file = LIBHANGUL_HANJA_FILE;
+    const gchar *symbol_file = IBUSHANGUL_DATADIR "/data/symbol.txt";
+
+    setlocale (LC_ALL, "");
+
+    if (argc > 1)
+        hanja_file = argv[1];
+    if (argc > 2)
+        symbol_file = argv[2];
+
+    bench_dictionary ("hanja", hanja_file);
+    bench_dictionary ("symbol", symbol_file);
+
+    return 0;
+}
@@ -0,0 +1,178 @@
+/* vim:set et sts=4: */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <ibus.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <locale.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "engine.h"
+
+/* Measures how fast engines are created and destroyed, the way the
+ * factory does it for every new input context, how much memory an
+ * engine takes, and how long a key press takes in Hangul and in Latin
+ * mode. Engines are not connected to the bus. */
+
+static guint serial = 0;
+
+static gdouble
+now (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static glong
+resident_size (void)
+{
+    glong size = 0;
+    glong resident = 0;
+    FILE *file;
+
+    file = fopen ("/proc/self/statm", "r");
+    if (file == NULL)
+        return 0;
+    if (fscanf (file, "%ld %ld", &size, &resident) != 2)
+        resident = 0;
+    fclose (file);
+
+    return resident * sysconf (_SC_PAGESIZE);
+}
+
+static IBusEngine*
+engine_new (void)
+{
+    IBusEngine *engine;
+    gchar *path;
+
+    path = g_strdup_printf ("/org/freedesktop/IBus/Engine/Bench/%u",
+                            ++serial);
+    engine = g_object_new (IBUS_TYPE_HANGUL_ENGINE,
+                           "name", "hangul",
+                           "path", path,
+                           NULL);
+    g_free (path);
+
+    return engine;
+}
+
+static void
+engine_free (IBusEngine *engine)
+{
+    ibus_object_destroy ((IBusObject *) engine);
+    g_object_unref (engine);
+}
+
+static void
+bench_create_destroy (const gchar *name, guint n)
+{
+    gdouble start;
+    gdouble elapsed;
+    guint i;
+
+    // warm up, and fill the pool if there is one
+    engine_free (engine_new ());
+
+    start = now ();
+    for (i = 0; i < n; i++)
+        engine_free (engine_new ());
+    elapsed = now () - start;
+
+    g_print ("%-24s %8u engines  %8.2f us/engine  %10.0f engines/s\n",
+             name, n, elapsed * 1e6 / n, n / elapsed);
+}
+
+static void
+bench_memory (guint n)
+{
+    IBusEngine **engines;
+    glong before;
+    glong after;
+    guint i;
+
+    engines = g_new (IBusEngine *, n);
+
+    before = resident_size ();
+    for (i = 0; i < n; i++)
+        engines[i] = engine_new ();
+    after = resident_size ();
+
+    for (i = 0; i < n; i++)
+        engine_free (engines[i]);
+    g_free (engines);
+
+    g_print ("%-24s %8u engines  %8ld bytes/engine\n",
+             "memory", n, (after - before) / n);
+}
+
+static void
+bench_keys (const gchar *name, gboolean latin, guint n)
+{
+    static const gchar text[] = "dkssudgktpdy. rkskekfkakqktk ";
+    IBusEngine *engine;
+    IBusEngineClass *klass;
+    gdouble start;
+    gdouble elapsed;
+    guint i;
+
+    engine = engine_new ();
+    klass = IBUS_ENGINE_GET_CLASS (engine);
+    if (latin)
+        klass->property_activate (engine, "hangul_mode", 0);
+
+    start = now ();
+    for (i = 0; i < n; i++) {
+        guint keyval = text[i % (sizeof (text) - 1)];
+
+        klass->process_key_event (engine, keyval, 0, 0);
+        klass->process_key_event (engine, keyval, 0, IBUS_RELEASE_MASK);
+    }
+    elapsed = now () - start;
+
+    g_print ("%-24s %8u keys     %8.1f ns/key\n",
+             name, n, elapsed * 1e9 / n);
+
+    engine_free (engine);
+}
+
+int
+main (gint argc, gchar **argv)
+{
+    guint n = 10000;
+
+    setlocale (LC_ALL, "");
+
+    if (argc > 1)
+        n = atoi (argv[1]);
+    if (n == 0)
+        n = 1;
+
+    if (!g_thread_supported ())
+        g_thread_init (NULL);
+
+    ibus_init ();
+    ibus_hangul_init (NULL);
+
+    ibus_hangul_engine_set_pool_size (0);
+    bench_create_destroy ("create/destroy", n);
+
+    ibus_hangul_engine_set_pool_size (16);
+    bench_create_destroy ("create/destroy, pooled", n);
+
+    ibus_hangul_engine_set_pool_size (0);
+    bench_memory (MIN (n, 1000));
+
+    // a key is a press and a release
+    bench_keys ("keys, Hangul mode", FALSE, n * 10);
+    bench_keys ("keys, Latin mode", TRUE, n * 10);
+
+    ibus_hangul_exit ();
+
+    return 0;
+}
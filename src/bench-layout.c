@@ -0,0 +1,258 @@
+/* vim:set et sts=4: */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <locale.h>
+#include <time.h>
+
+#include "layoutdetect.h"
+
+/* Evaluates the wrong layout detection offline, see layoutdetect.h: a
+ * model is trained on most of the words of a Hangul and a Latin corpus,
+ * and the rest are typed into a detector as if in the wrong mode, and
+ * in the right one. For each threshold it tells how many of the words
+ * typed in the wrong mode are caught, after how many keys, and how many
+ * typed in the right mode would be corrected wrongly.
+ *
+ * With -o the model is trained again on all the words and saved, e.g.
+ * as the layout.model the engine reads. */
+
+/* one word in this many is held out of the training */
+#define TEST_STRIDE     10
+#define N_ROUNDS        20
+
+static const guint thresholds[] = { 4, 6, 8, 10, 12, 14, 16, 20, 24 };
+
+static gdouble
+now (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+usage (void)
+{
+    fprintf (stderr,
+             "usage: ibus-hangul-bench-layout [-o MODEL] "
+             "HANGUL_CORPUS LATIN_CORPUS\n");
+    exit (2);
+}
+
+static gchar**
+read_words (const gchar *filename, gboolean latin)
+{
+    gchar *text;
+    gchar **words;
+
+    if (!g_file_get_contents (filename, &text, NULL, NULL)) {
+        fprintf (stderr, "can't read %s\n", filename);
+        exit (1);
+    }
+
+    words = layout_split_words (text, latin);
+    g_free (text);
+
+    return words;
+}
+
+/* Splits words into the ones to train on and the ones held out. The
+ * arrays share the strings of words. */
+static void
+split_words (gchar **words, GPtrArray *train, GPtrArray *test)
+{
+    guint i;
+
+    for (i = 0; words[i] != NULL; ++i) {
+        if (i % TEST_STRIDE == TEST_STRIDE - 1)
+            g_ptr_array_add (test, words[i]);
+        else
+            g_ptr_array_add (train, words[i]);
+    }
+    g_ptr_array_add (train, NULL);
+}
+
+/* Types each word of test into detector, and counts the words on which
+ * guess is made, and the keys typed before it. */
+static guint
+count_guesses (LayoutDetector *detector,
+               GPtrArray      *test,
+               LayoutGuess     guess,
+               guint          *n_keys)
+{
+    guint n = 0;
+    guint i;
+
+    *n_keys = 0;
+    for (i = 0; i < test->len; ++i) {
+        const gchar *p;
+
+        layout_detector_reset (detector);
+        for (p = g_ptr_array_index (test, i); *p != '\0'; ++p) {
+            if (layout_detector_push (detector, (guchar) *p) == guess) {
+                *n_keys += p - (const gchar *) g_ptr_array_index (test, i)
+                           + 1;
+                n++;
+                break;
+            }
+        }
+    }
+
+    return n;
+}
+
+static gdouble
+percent (guint n, guint total)
+{
+    return total > 0 ? 100.0 * n / total : 0.0;
+}
+
+static void
+bench_thresholds (LayoutModel *model, GPtrArray *hangul, GPtrArray *latin)
+{
+    LayoutDetector *detector;
+    guint i;
+
+    detector = layout_detector_new (model);
+
+    g_print ("  %-10s %12s %10s %12s %12s %10s %12s\n", "",
+             "Hangul in", "", "Latin", "Latin in", "", "Hangul");
+    g_print ("  %-10s %12s %10s %12s %12s %10s %12s\n", "threshold",
+             "Latin mode", "keys", "flagged", "Hangul mode", "keys",
+             "flagged");
+
+    for (i = 0; i < G_N_ELEMENTS (thresholds); ++i) {
+        guint caught_hangul, caught_latin, wrong_hangul, wrong_latin;
+        guint keys_hangul, keys_latin, keys;
+
+        layout_detector_set_threshold (detector, thresholds[i]);
+        caught_hangul = count_guesses (detector, hangul, LAYOUT_HANGUL,
+                                       &keys_hangul);
+        caught_latin = count_guesses (detector, latin, LAYOUT_LATIN,
+                                      &keys_latin);
+        wrong_hangul = count_guesses (detector, latin, LAYOUT_HANGUL, &keys);
+        wrong_latin = count_guesses (detector, hangul, LAYOUT_LATIN, &keys);
+
+        g_print ("  %-10u %11.1f%% %10.1f %11.2f%% %11.1f%% %10.1f "
+                 "%11.2f%%\n", thresholds[i],
+                 percent (caught_hangul, hangul->len),
+                 caught_hangul > 0 ? (gdouble) keys_hangul / caught_hangul : 0,
+                 percent (wrong_hangul, latin->len),
+                 percent (caught_latin, latin->len),
+                 caught_latin > 0 ? (gdouble) keys_latin / caught_latin : 0,
+                 percent (wrong_latin, hangul->len));
+    }
+
+    layout_detector_delete (detector);
+}
+
+/* the cost of a key, over the keys of all the words */
+static gdouble
+bench_speed (LayoutModel *model, GPtrArray *words)
+{
+    LayoutDetector *detector;
+    gdouble start;
+    guint n_keys = 0;
+    guint guesses = 0;
+    guint round, i;
+
+    detector = layout_detector_new (model);
+
+    start = now ();
+    for (round = 0; round < N_ROUNDS; ++round) {
+        for (i = 0; i < words->len; ++i) {
+            const gchar *p;
+
+            layout_detector_reset (detector);
+            for (p = g_ptr_array_index (words, i); *p != '\0'; ++p) {
+                guesses += layout_detector_push (detector, (guchar) *p);
+                n_keys++;
+            }
+        }
+    }
+    start = now () - start;
+
+    layout_detector_delete (detector);
+
+    // so the loop isn't optimized away
+    if (guesses == G_MAXUINT)
+        g_print (" ");
+
+    return n_keys > 0 ? start * 1e9 / n_keys : 0;
+}
+
+int
+main (gint argc, gchar **argv)
+{
+    const gchar *output = NULL;
+    gchar **hangul_words, **latin_words;
+    GPtrArray *hangul_train, *hangul_test;
+    GPtrArray *latin_train, *latin_test;
+    GPtrArray *all;
+    LayoutModel *model;
+    guint i;
+
+    setlocale (LC_ALL, "");
+
+    if (argc > 2 && strcmp (argv[1], "-o") == 0) {
+        output = argv[2];
+        argc -= 2;
+        argv += 2;
+    }
+    if (argc != 3)
+        usage ();
+
+    hangul_words = read_words (argv[1], FALSE);
+    latin_words = read_words (argv[2], TRUE);
+
+    hangul_train = g_ptr_array_new ();
+    hangul_test = g_ptr_array_new ();
+    split_words (hangul_words, hangul_train, hangul_test);
+    latin_train = g_ptr_array_new ();
+    latin_test = g_ptr_array_new ();
+    split_words (latin_words, latin_train, latin_test);
+
+    g_print ("Hangul: %s, %u words held out of %u\n", argv[1],
+             hangul_test->len, hangul_test->len + hangul_train->len - 1);
+    g_print ("Latin: %s, %u words held out of %u\n", argv[2],
+             latin_test->len, latin_test->len + latin_train->len - 1);
+
+    model = layout_model_train ((gchar **) hangul_train->pdata,
+                                (gchar **) latin_train->pdata);
+    bench_thresholds (model, hangul_test, latin_test);
+
+    all = g_ptr_array_new ();
+    for (i = 0; i < hangul_test->len; ++i)
+        g_ptr_array_add (all, g_ptr_array_index (hangul_test, i));
+    for (i = 0; i < latin_test->len; ++i)
+        g_ptr_array_add (all, g_ptr_array_index (latin_test, i));
+    g_print ("  %.1f ns/key\n", bench_speed (model, all));
+    g_ptr_array_free (all, TRUE);
+
+    layout_model_delete (model);
+
+    if (output != NULL) {
+        model = layout_model_train (hangul_words, latin_words);
+        if (!layout_model_save (model, output)) {
+            fprintf (stderr, "can't write %s\n", output);
+            return 1;
+        }
+        layout_model_delete (model);
+    }
+
+    g_ptr_array_free (hangul_train, TRUE);
+    g_ptr_array_free (hangul_test, TRUE);
+    g_ptr_array_free (latin_train, TRUE);
+    g_ptr_array_free (latin_test, TRUE);
+    g_strfreev (hangul_words);
+    g_strfreev (latin_words);
+
+    return 0;
+}
@@ -0,0 +1,151 @@
+/* vim:set et sts=4: */
+#include "candidate.h"
+
+typedef struct _Candidate Candidate;
+
+struct _Candidate {
+    const gchar *key;
+    const gchar *value;
+    const gchar *comment;
+    guint        length;
+};
+
+struct _CandidateList {
+    GArray       *items;
+    GStringChunk *strings;
+
+    CandidateListFillFunc fill;
+    gpointer              fill_data;
+    GDestroyNotify        fill_destroy;
+};
+
+CandidateList*
+candidate_list_new (void)
+{
+    CandidateList *list = g_new (CandidateList, 1);
+
+    list->items = g_array_new (FALSE, FALSE, sizeof (Candidate));
+    list->strings = NULL;
+    list->fill = NULL;
+    list->fill_data = NULL;
+    list->fill_destroy = NULL;
+
+    return list;
+}
+
+static void
+candidate_list_clear_fill_func (CandidateList *list)
+{
+    if (list->fill_destroy != NULL)
+        list->fill_destroy (list->fill_data);
+
+    list->fill = NULL;
+    list->fill_data = NULL;
+    list->fill_destroy = NULL;
+}
+
+void
+candidate_list_delete (CandidateList *list)
+{
+    if (list == NULL)
+        return;
+
+    candidate_list_clear_fill_func (list);
+    if (list->strings != NULL)
+        g_string_chunk_free (list->strings);
+    g_array_free (list->items, TRUE);
+    g_free (list);
+}
+
+void
+candidate_list_append (CandidateList *list,
+                       const gchar   *key,
+                       const gchar   *value,
+                       const gchar   *comment,
+                       guint          length)
+{
+    Candidate c;
+
+    c.key = key;
+    c.value = value;
+    c.comment = comment != NULL ? comment : "";
+    c.length = length;
+    g_array_append_val (list->items, c);
+}
+
+const gchar*
+candidate_list_intern (CandidateList *list, const gchar *str, gssize len)
+{
+    if (list->strings == NULL)
+        list->strings = g_string_chunk_new (256);
+
+    return g_string_chunk_insert_len (list->strings, str, len);
+}
+
+void
+candidate_list_set_fill_func (CandidateList         *list,
+                              CandidateListFillFunc  func,
+                              gpointer               user_data,
+                              GDestroyNotify         destroy)
+{
+    candidate_list_clear_fill_func (list);
+
+    list->fill = func;
+    list->fill_data = user_data;
+    list->fill_destroy = destroy;
+}
+
+guint
+candidate_list_fill (CandidateList *list, guint n)
+{
+    if (list->fill != NULL && list->items->len < n) {
+        if (!list->fill (list, n, list->fill_data))
+            candidate_list_clear_fill_func (list);
+    }
+
+    return list->items->len;
+}
+
+gboolean
+candidate_list_is_complete (const CandidateList *list)
+{
+    return list->fill == NULL;
+}
+
+guint
+candidate_list_get_size (const CandidateList *list)
+{
+    return list->items->len;
+}
+
+const gchar*
+candidate_list_get_nth_key (const CandidateList *list, guint n)
+{
+    if (n >= list->items->len)
+        return NULL;
+    return g_array_index (list->items, Candidate, n).key;
+}
+
+const gchar*
+candidate_list_get_nth_value (const CandidateList *list, guint n)
+{
+    if (n >= list->items->len)
+        return NULL;
+    return g_array_index (list->items, Candidate, n).value;
+}
+
+const gchar*
+candidate_list_get_nth_comment (const CandidateList *list, guint n)
+{
+    if (n >= list->items->len)
+        return NULL;
+    return g_array_index (list->items, Candidate, n).comment;
+}
+
+guint
+candidate_list_get_nth_length (const CandidateList *list, guint n)
+{
+    if (n >= list->items->len)
+        return 0;
+    return g_array_index (list->items, Candidate, n).length;
+}
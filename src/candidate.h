@@ -0,0 +1,56 @@
+/* vim:set et sts=4: */
+#ifndef __CANDIDATE_H__
+#define __CANDIDATE_H__
+
+#include <glib.h>
+
+/* CandidateList is the list shown in the lookup table. Unlike HanjaList
+ * it can collect entries from several sources. The strings are not
+ * copied: they must outlive the list, or be copied into it with
+ * candidate_list_intern(). */
+typedef struct _CandidateList CandidateList;
+
+/* Appends more candidates to list, until it has n or there are no more.
+ * Returns FALSE once every candidate is in the list. */
+typedef gboolean (*CandidateListFillFunc) (CandidateList *list,
+                                           guint          n,
+                                           gpointer       user_data);
+
+CandidateList* candidate_list_new               (void);
+void           candidate_list_delete            (CandidateList *list);
+
+/* length is the number of preedit characters the candidate replaces */
+void           candidate_list_append            (CandidateList *list,
+                                                 const gchar   *key,
+                                                 const gchar   *value,
+                                                 const gchar   *comment,
+                                                 guint          length);
+/* Returns a copy of str, or of its first len bytes, owned by list */
+const gchar*   candidate_list_intern            (CandidateList *list,
+                                                 const gchar   *str,
+                                                 gssize         len);
+
+/* Has the rest of the list made on demand, by candidate_list_fill().
+ * destroy frees user_data once the list is complete, or deleted. */
+void           candidate_list_set_fill_func     (CandidateList *list,
+                                                 CandidateListFillFunc func,
+                                                 gpointer       user_data,
+                                                 GDestroyNotify destroy);
+/* Makes list have n candidates, or all there are. Returns the size. */
+guint          candidate_list_fill              (CandidateList *list,
+                                                 guint          n);
+/* TRUE if no candidate is left to be made */
+gboolean       candidate_list_is_complete       (const CandidateList *list);
+
+/* the number of candidates made so far */
+guint          candidate_list_get_size          (const CandidateList *list);
+const gchar*   candidate_list_get_nth_key       (const CandidateList *list,
+                                                 guint          n);
+const gchar*   candidate_list_get_nth_value     (const CandidateList *list,
+                                                 guint          n);
+const gchar*   candidate_list_get_nth_comment   (const CandidateList *list,
+                                                 guint          n);
+guint          candidate_list_get_nth_length    (const CandidateList *list,
+                                                 guint          n);
+
+#endif
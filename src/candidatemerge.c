@@ -0,0 +1,150 @@
+/* vim:set et sts=4: */
+#include "candidatemerge.h"
+
+typedef struct _CandidateSlot CandidateSlot;
+
+struct _CandidateSlot {
+    CandidateSource *source;
+    gint             priority;
+    /* no candidate left in the source has a lower rank */
+    guint            bound;
+    /* head is the next candidate, taken from the source already */
+    gboolean         has_head;
+    gboolean         done;
+    CandidateEntry   head;
+};
+
+struct _CandidateMerge {
+    GArray     *slots;
+    /* the values in the list, to leave out duplicates */
+    GHashTable *values;
+};
+
+CandidateMerge*
+candidate_merge_new (void)
+{
+    CandidateMerge *merge;
+
+    merge = g_new (CandidateMerge, 1);
+    merge->slots = g_array_new (FALSE, FALSE, sizeof (CandidateSlot));
+    merge->values = g_hash_table_new (g_str_hash, g_str_equal);
+
+    return merge;
+}
+
+void
+candidate_merge_delete (CandidateMerge *merge)
+{
+    guint i;
+
+    if (merge == NULL)
+        return;
+
+    for (i = 0; i < merge->slots->len; ++i) {
+        CandidateSource *source;
+
+        source = g_array_index (merge->slots, CandidateSlot, i).source;
+        source->destroy (source);
+    }
+
+    g_hash_table_destroy (merge->values);
+    g_array_free (merge->slots, TRUE);
+    g_free (merge);
+}
+
+void
+candidate_merge_add (CandidateMerge  *merge,
+                     CandidateSource *source,
+                     gint             priority)
+{
+    CandidateSlot slot = { NULL, };
+
+    slot.source = source;
+    slot.priority = priority;
+    slot.bound = source->min_rank;
+    g_array_append_val (merge->slots, slot);
+}
+
+/* TRUE if the next candidate of a has to come before that of b */
+static gboolean
+candidate_slot_before (const CandidateSlot *a, const CandidateSlot *b)
+{
+    if (a->bound != b->bound)
+        return a->bound < b->bound;
+
+    // slots are in the order they were added
+    return a->priority > b->priority;
+}
+
+/* Takes the next candidate of the merge, or returns FALSE if there is
+ * none left. */
+static gboolean
+candidate_merge_next (CandidateMerge *merge,
+                      CandidateList  *list,
+                      CandidateEntry *entry)
+{
+    for (;;) {
+        CandidateSlot *best = NULL;
+        guint i;
+
+        // There are only a handful of sources, so a scan is cheaper
+        // than keeping them in a heap.
+        for (i = 0; i < merge->slots->len; ++i) {
+            CandidateSlot *slot = &g_array_index (merge->slots,
+                                                  CandidateSlot, i);
+
+            if (slot->done)
+                continue;
+            if (best == NULL || candidate_slot_before (slot, best))
+                best = slot;
+        }
+
+        if (best == NULL)
+            return FALSE;
+
+        // The best slot may only have a bound so far. Its candidate is
+        // taken now, and then compared with the others again.
+        if (!best->has_head) {
+            if (best->source->next (best->source, list, &best->head)) {
+                best->has_head = TRUE;
+                best->bound = MAX (best->bound, best->head.rank);
+            } else {
+                best->done = TRUE;
+            }
+            continue;
+        }
+
+        best->has_head = FALSE;
+        *entry = best->head;
+        return TRUE;
+    }
+}
+
+static gboolean
+candidate_merge_fill (CandidateList *list, guint n, gpointer user_data)
+{
+    CandidateMerge *merge = user_data;
+    CandidateEntry entry;
+
+    while (candidate_list_get_size (list) < n) {
+        if (!candidate_merge_next (merge, list, &entry))
+            return FALSE;
+
+        if (g_hash_table_lookup (merge->values, entry.value) != NULL)
+            continue;
+        g_hash_table_insert (merge->values, (gpointer) entry.value,
+                             (gpointer) entry.value);
+
+        candidate_list_append (list, entry.key, entry.value, entry.comment,
+                               entry.length);
+    }
+
+    return TRUE;
+}
+
+void
+candidate_merge_attach (CandidateMerge *merge, CandidateList *list)
+{
+    candidate_list_set_fill_func (list, candidate_merge_fill, merge,
+                                  (GDestroyNotify) candidate_merge_delete);
+}
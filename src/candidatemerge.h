@@ -0,0 +1,60 @@
+/* vim:set et sts=4: */
+#ifndef __CANDIDATE_MERGE_H__
+#define __CANDIDATE_MERGE_H__
+
+#include <glib.h>
+
+#include "candidate.h"
+
+/* CandidateMerge makes one CandidateList out of several ranked sources,
+ * e.g. the symbols, the user's words and the system hanja dictionary.
+ * It is a k-way merge: the list takes the best candidate at the head of
+ * any source, so sources can be mixed rather than one hiding the rest.
+ *
+ * The merge is lazy. A source is only asked for a candidate when it
+ * could be the next one in the list, and the list is only filled as far
+ * as candidate_list_fill() asks, so a source with hundreds of matches
+ * costs no more than the page that is shown. */
+typedef struct _CandidateMerge CandidateMerge;
+typedef struct _CandidateSource CandidateSource;
+typedef struct _CandidateEntry CandidateEntry;
+
+struct _CandidateEntry {
+    const gchar *key;
+    const gchar *value;
+    const gchar *comment;
+    /* see candidate_list_append() */
+    guint        length;
+    /* lower ranks come first */
+    guint        rank;
+};
+
+/* A source puts this first in its own struct. */
+struct _CandidateSource {
+    /* Sets entry to the next candidate, or returns FALSE at the end.
+     * Ranks don't go down from one candidate to the next. The strings
+     * must outlive the source, or be interned into list. */
+    gboolean (*next)       (CandidateSource     *source,
+                            CandidateList       *list,
+                            CandidateEntry      *entry);
+    void     (*destroy)    (CandidateSource     *source);
+    /* no candidate of the source has a lower rank */
+    guint      min_rank;
+};
+
+CandidateMerge* candidate_merge_new     (void);
+void            candidate_merge_delete  (CandidateMerge  *merge);
+
+/* Adds source, which the merge then owns. Of candidates with the same
+ * rank, those of the source with the higher priority come first, then
+ * those of the source added first. */
+void            candidate_merge_add     (CandidateMerge  *merge,
+                                         CandidateSource *source,
+                                         gint             priority);
+
+/* Has list filled from merge, which the list then owns. A candidate
+ * whose value is in the list already is left out. */
+void            candidate_merge_attach  (CandidateMerge  *merge,
+                                         CandidateList   *list);
+
+#endif
@@ -0,0 +1,138 @@
+/* vim:set et sts=4: */
+#include <string.h>
+
+#include "charfilter.h"
+#include "ksx1001.h"
+
+/* pages of the code space, 0x110000 / 256 */
+#define CHAR_FILTER_N_PAGES     0x1100
+
+/* a bit for each code point of a page */
+typedef guint32 CharFilterPage[8];
+
+struct _CharFilter {
+    /* index of the bits of each page in pages, 0 for a page without
+     * any character, whose bits are all 0 */
+    guint16  directory[CHAR_FILTER_N_PAGES];
+    CharFilterPage *pages;
+    guint    n_pages;
+};
+
+static CharFilter*
+char_filter_new (void)
+{
+    CharFilter *filter;
+
+    filter = g_new0 (CharFilter, 1);
+    filter->pages = g_new0 (CharFilterPage, 1);
+    filter->n_pages = 1;
+
+    return filter;
+}
+
+static void
+char_filter_add (CharFilter *filter, gunichar c)
+{
+    guint page = c >> 8;
+    guint i;
+
+    if (page >= CHAR_FILTER_N_PAGES)
+        return;
+
+    i = filter->directory[page];
+    if (i == 0) {
+        i = filter->n_pages++;
+        filter->pages = g_renew (CharFilterPage, filter->pages,
+                                 filter->n_pages);
+        memset (filter->pages[i], 0, sizeof (filter->pages[i]));
+        filter->directory[page] = i;
+    }
+
+    filter->pages[i][(c & 0xff) / 32] |= 1u << (c % 32);
+}
+
+CharFilter*
+char_filter_new_ksx1001 (void)
+{
+    CharFilter *filter;
+    guint i;
+
+    filter = g_new0 (CharFilter, 1);
+    filter->n_pages = KSX1001_N_PAGES + 1;
+    filter->pages = g_new0 (CharFilterPage, filter->n_pages);
+
+    for (i = 0; i < KSX1001_N_PAGES; ++i) {
+        filter->directory[ksx1001_page_numbers[i]] = i + 1;
+        memcpy (filter->pages[i + 1], ksx1001_pages[i],
+                sizeof (ksx1001_pages[i]));
+    }
+
+    return filter;
+}
+
+CharFilter*
+char_filter_load (const gchar *filename)
+{
+    CharFilter *filter;
+    gchar *contents;
+    gchar **lines;
+    guint i;
+
+    if (!g_file_get_contents (filename, &contents, NULL, NULL))
+        return NULL;
+
+    filter = char_filter_new ();
+
+    lines = g_strsplit (contents, "\n", -1);
+    for (i = 0; lines[i] != NULL; ++i) {
+        const gchar *p = lines[i];
+
+        if (p[0] == '#' || !g_utf8_validate (p, -1, NULL))
+            continue;
+
+        for (; *p != '\0'; p = g_utf8_next_char (p)) {
+            gunichar c = g_utf8_get_char (p);
+
+            if (!g_unichar_isspace (c))
+                char_filter_add (filter, c);
+        }
+    }
+
+    g_strfreev (lines);
+    g_free (contents);
+
+    return filter;
+}
+
+void
+char_filter_delete (CharFilter *filter)
+{
+    if (filter == NULL)
+        return;
+
+    g_free (filter->pages);
+    g_free (filter);
+}
+
+gboolean
+char_filter_contains (const CharFilter *filter, gunichar c)
+{
+    guint page = c >> 8;
+
+    if (page >= CHAR_FILTER_N_PAGES)
+        return FALSE;
+
+    return (filter->pages[filter->directory[page]][(c & 0xff) / 32] >>
+            (c % 32)) & 1;
+}
+
+gboolean
+char_filter_accepts (const CharFilter *filter, const gchar *str)
+{
+    for (; *str != '\0'; str = g_utf8_next_char (str)) {
+        if (!char_filter_contains (filter, g_utf8_get_char (str)))
+            return FALSE;
+    }
+
+    return TRUE;
+}
@@ -0,0 +1,27 @@
+/* vim:set et sts=4: */
+#ifndef __CHAR_FILTER_H__
+#define __CHAR_FILTER_H__
+
+#include <glib.h>
+
+/* CharFilter is a set of characters, kept as a bit for each code point
+ * in pages of 256, only the pages that have any of them being stored.
+ * Testing a character is two array lookups. It is read only once made,
+ * and can be used from several threads at once. */
+typedef struct _CharFilter CharFilter;
+
+/* the characters of KS X 1001, and ASCII */
+CharFilter*  char_filter_new_ksx1001  (void);
+/* Reads a list of characters, e.g. the hanja approved for a site. Every
+ * character of the file but white space is in the set; lines starting
+ * with # are left out. Returns NULL if the file can't be read. */
+CharFilter*  char_filter_load         (const gchar      *filename);
+void         char_filter_delete       (CharFilter       *filter);
+
+gboolean     char_filter_contains     (const CharFilter *filter,
+                                       gunichar          c);
+/* TRUE if every character of the UTF-8 string str is in the set */
+gboolean     char_filter_accepts      (const CharFilter *filter,
+                                       const gchar      *str);
+
+#endif
@@ -0,0 +1,165 @@
+/* vim:set et sts=4: */
+#include <string.h>
+#include <hangul.h>
+
+#include "chosungindex.h"
+
+struct _ChosungIndex {
+    const DictTrie   *trie;
+    GHashTable       *table;
+};
+
+/* compatibility jamo of the 19 choseong in syllable order */
+static const ucschar choseong_cjamo[19] = {
+    0x3131, 0x3132, 0x3134, 0x3137, 0x3138, 0x3139, 0x3141, 0x3142,
+    0x3143, 0x3145, 0x3146, 0x3147, 0x3148, 0x3149, 0x314a, 0x314b,
+    0x314c, 0x314d, 0x314e
+};
+
+static gboolean
+is_choseong_cjamo (ucschar c)
+{
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS (choseong_cjamo); ++i) {
+        if (choseong_cjamo[i] == c)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+/* Returns the initial consonants of word as a newly allocated string,
+ * or NULL if word is not made of two or more syllables. */
+static gchar*
+chosung_skeleton (const gchar *word)
+{
+    GString *skeleton;
+    guint n = 0;
+
+    skeleton = g_string_new (NULL);
+    while (*word != '\0') {
+        ucschar c = g_utf8_get_char (word);
+
+        if (c < 0xac00 || c > 0xd7a3) {
+            g_string_free (skeleton, TRUE);
+            return NULL;
+        }
+
+        g_string_append_unichar (skeleton,
+                                 choseong_cjamo[(c - 0xac00) / 588]);
+        n++;
+        word = g_utf8_next_char (word);
+    }
+
+    if (n < 2) {
+        g_string_free (skeleton, TRUE);
+        return NULL;
+    }
+
+    return g_string_free (skeleton, FALSE);
+}
+
+static void
+key_id_array_free (gpointer data)
+{
+    g_array_free ((GArray *) data, TRUE);
+}
+
+ChosungIndex*
+chosung_index_new (const DictTrie *trie)
+{
+    ChosungIndex *index;
+    GString *word;
+    guint i, n;
+
+    if (trie == NULL)
+        return NULL;
+
+    index = g_new (ChosungIndex, 1);
+    index->trie = trie;
+    index->table = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                          g_free, key_id_array_free);
+
+    word = g_string_new (NULL);
+    n = dict_trie_get_n_keys (trie);
+    for (i = 0; i < n; ++i) {
+        gchar *skeleton;
+        GArray *key_ids;
+
+        dict_trie_get_key (trie, i, word);
+        skeleton = chosung_skeleton (word->str);
+        if (skeleton == NULL)
+            continue;
+
+        key_ids = g_hash_table_lookup (index->table, skeleton);
+        if (key_ids == NULL) {
+            key_ids = g_array_sized_new (FALSE, FALSE, sizeof (guint), 1);
+            g_hash_table_insert (index->table, skeleton, key_ids);
+        } else {
+            g_free (skeleton);
+        }
+        g_array_append_val (key_ids, i);
+    }
+    g_string_free (word, TRUE);
+
+    return index;
+}
+
+void
+chosung_index_delete (ChosungIndex *index)
+{
+    if (index == NULL)
+        return;
+
+    g_hash_table_destroy (index->table);
+    g_free (index);
+}
+
+gboolean
+chosung_is_abbreviation (const gchar *key)
+{
+    guint n = 0;
+
+    while (*key != '\0') {
+        if (!is_choseong_cjamo (g_utf8_get_char (key)))
+            return FALSE;
+        n++;
+        key = g_utf8_next_char (key);
+    }
+
+    return n >= 2;
+}
+
+void
+chosung_index_search (const ChosungIndex *index,
+                      const DictMask     *mask,
+                      const gchar        *key,
+                      CandidateList      *list)
+{
+    GArray *key_ids;
+    GString *word;
+    guint key_len;
+    guint i;
+
+    if (index == NULL)
+        return;
+
+    key_ids = g_hash_table_lookup (index->table, key);
+    if (key_ids == NULL)
+        return;
+
+    word = g_string_new (NULL);
+    key_len = g_utf8_strlen (key, -1);
+    for (i = 0; i < key_ids->len; ++i) {
+        guint key_id = g_array_index (key_ids, guint, i);
+        const gchar *str;
+
+        // the hangul word itself, then its hanja forms
+        dict_trie_get_key (index->trie, key_id, word);
+        str = candidate_list_intern (list, word->str, word->len);
+        candidate_list_append (list, str, str, "", key_len);
+        dict_trie_append_entries (index->trie, mask, key_id, str, key_len,
+                                  list);
+    }
+    g_string_free (word, TRUE);
+}
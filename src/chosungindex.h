@@ -0,0 +1,29 @@
+/* vim:set et sts=4: */
+#ifndef __CHOSUNG_INDEX_H__
+#define __CHOSUNG_INDEX_H__
+
+#include <glib.h>
+
+#include "dicttrie.h"
+#include "candidate.h"
+
+/* ChosungIndex maps the initial consonants of dictionary words to the
+ * words, so that ㄷㅎㅁㄱ finds 대한민국. Only words of two or more
+ * syllables are indexed; single consonants belong to the symbol table. */
+typedef struct _ChosungIndex ChosungIndex;
+
+ChosungIndex* chosung_index_new      (const DictTrie     *trie);
+void          chosung_index_delete   (ChosungIndex       *index);
+
+/* Returns TRUE if key is made of two or more compatibility
+ * consonants only, i.e. it can be an abbreviation. */
+gboolean      chosung_is_abbreviation(const gchar        *key);
+
+/* Appends every word with the initial consonants of key, followed by
+ * its hanja forms that pass mask, to list. */
+void          chosung_index_search   (const ChosungIndex *index,
+                                      const DictMask     *mask,
+                                      const gchar        *key,
+                                      CandidateList      *list);
+
+#endif
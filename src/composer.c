@@ -0,0 +1,384 @@
+/* vim:set et sts=4: */
+#include <string.h>
+
+#include "composer.h"
+
+/* states deeper than this are left to libhangul */
+#define COMPOSER_MAX_KEYS       16
+/* upper bound of the table of one keyboard, about 1.5MB */
+#define COMPOSER_MAX_STATES     4096
+
+/* printable ASCII, then BackSpace */
+#define KEY_BACKSPACE           95
+#define N_KEYS                  96
+#define KEY_NONE                N_KEYS
+
+typedef struct _ComposerTable ComposerTable;
+typedef struct _ComposerState ComposerState;
+typedef struct _ComposerTransition ComposerTransition;
+
+struct _ComposerState {
+    /* index + 1 in transitions of every key, NULL if none is known */
+    guint32 *next;
+};
+
+struct _ComposerTransition {
+    guint32 state;
+    guint32 commit;
+    guint32 preedit;
+    guint32 retval;
+};
+
+struct _ComposerTable {
+    GArray *states;
+    GArray *transitions;
+    /* 0 terminated strings, the first one empty */
+    GArray *strings;
+};
+
+struct _Composer {
+    HangulInputContext *context;
+    ComposerTable      *table;
+
+    /* state and keys describe the context */
+    gboolean            tracking;
+    guint               state;
+    guint8              keys[COMPOSER_MAX_KEYS];
+    guint               n_keys;
+
+    /* the context has seen all the keys */
+    gboolean            synced;
+    /* the transition of the last key if it was taken from the table,
+     * or -1 */
+    gint                transition;
+};
+
+/* the standard keyboards of libhangul */
+static const gchar *composer_keyboards[] = {
+    "2", "2y", "32", "39", "3f", "3s", "3y"
+};
+
+/* the tables of each thread, by keyboard: a table grows as it is read,
+ * and the strings handed out point into it, so it is not shared */
+static GStaticPrivate composer_tables = G_STATIC_PRIVATE_INIT;
+static gboolean    fast_path = FALSE;
+
+static ComposerTable*
+composer_table_new (void)
+{
+    ComposerTable *table;
+    ComposerState empty = { NULL };
+    ucschar nul = 0;
+
+    table = g_new (ComposerTable, 1);
+    table->states = g_array_new (FALSE, FALSE, sizeof (ComposerState));
+    table->transitions = g_array_new (FALSE, FALSE,
+                                      sizeof (ComposerTransition));
+    table->strings = g_array_new (FALSE, FALSE, sizeof (ucschar));
+
+    g_array_append_val (table->states, empty);
+    g_array_append_val (table->strings, nul);
+
+    return table;
+}
+
+static void
+composer_table_free (gpointer data)
+{
+    ComposerTable *table = (ComposerTable *) data;
+    guint i;
+
+    for (i = 0; i < table->states->len; ++i)
+        g_free (g_array_index (table->states, ComposerState, i).next);
+
+    g_array_free (table->states, TRUE);
+    g_array_free (table->transitions, TRUE);
+    g_array_free (table->strings, TRUE);
+    g_free (table);
+}
+
+static guint32
+composer_table_add_string (ComposerTable *table, const ucschar *str)
+{
+    guint32 offset;
+    guint len;
+
+    if (str == NULL || str[0] == 0)
+        return 0;
+
+    for (len = 0; str[len] != 0; ++len)
+        continue;
+
+    offset = table->strings->len;
+    g_array_append_vals (table->strings, str, len + 1);
+
+    return offset;
+}
+
+static ComposerTable*
+composer_table_get (const gchar *keyboard)
+{
+    GHashTable *tables;
+    ComposerTable *table;
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS (composer_keyboards); ++i) {
+        if (strcmp (composer_keyboards[i], keyboard) == 0)
+            break;
+    }
+    if (i == G_N_ELEMENTS (composer_keyboards))
+        return NULL;
+
+    tables = g_static_private_get (&composer_tables);
+    if (tables == NULL) {
+        tables = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                        NULL, composer_table_free);
+        g_static_private_set (&composer_tables, tables,
+                              (GDestroyNotify) g_hash_table_destroy);
+    }
+
+    table = g_hash_table_lookup (tables, composer_keyboards[i]);
+    if (table == NULL) {
+        table = composer_table_new ();
+        g_hash_table_insert (tables, (gpointer) composer_keyboards[i], table);
+    }
+
+    return table;
+}
+
+static inline const ComposerTransition*
+composer_get_transition (const Composer *composer)
+{
+    return &g_array_index (composer->table->transitions, ComposerTransition,
+                           composer->transition);
+}
+
+static void
+composer_start (Composer *composer)
+{
+    composer->tracking = composer->table != NULL;
+    composer->state = 0;
+    composer->n_keys = 0;
+    composer->synced = TRUE;
+    composer->transition = -1;
+}
+
+/* Brings the context up to date with the keys taken from the table. */
+static void
+composer_sync (Composer *composer)
+{
+    guint i;
+
+    if (composer->synced)
+        return;
+
+    hangul_ic_reset (composer->context);
+    for (i = 0; i < composer->n_keys; ++i) {
+        if (composer->keys[i] == KEY_BACKSPACE)
+            hangul_ic_backspace (composer->context);
+        else
+            hangul_ic_process (composer->context, composer->keys[i] + 0x20);
+    }
+    composer->synced = TRUE;
+}
+
+static void
+composer_move (Composer *composer, guint key, guint state)
+{
+    if (state == 0) {
+        composer->n_keys = 0;
+    } else {
+        composer->keys[composer->n_keys] = key;
+        composer->n_keys++;
+    }
+    composer->state = state;
+}
+
+/* Records what libhangul did with key, and follows it. */
+static void
+composer_learn (Composer *composer, guint key, gboolean retval)
+{
+    ComposerTable *table = composer->table;
+    ComposerTransition t;
+    ComposerState *from;
+    guint32 index;
+
+    if (table == NULL || !fast_path) {
+        composer->tracking = FALSE;
+        return;
+    }
+
+    if (hangul_ic_is_empty (composer->context)) {
+        // whatever came before, an empty context starts over
+        t.state = 0;
+    } else if (!composer->tracking || key == KEY_NONE ||
+               composer->n_keys >= COMPOSER_MAX_KEYS ||
+               table->states->len >= COMPOSER_MAX_STATES) {
+        composer->tracking = FALSE;
+        return;
+    } else {
+        ComposerState state = { NULL };
+
+        t.state = table->states->len;
+        g_array_append_val (table->states, state);
+    }
+
+    if (composer->tracking && key != KEY_NONE) {
+        t.commit = composer_table_add_string (table,
+                            hangul_ic_get_commit_string (composer->context));
+        t.preedit = composer_table_add_string (table,
+                            hangul_ic_get_preedit_string (composer->context));
+        t.retval = retval;
+
+        index = table->transitions->len;
+        g_array_append_val (table->transitions, t);
+
+        from = &g_array_index (table->states, ComposerState, composer->state);
+        if (from->next == NULL)
+            from->next = g_new0 (guint32, N_KEYS);
+        from->next[key] = index + 1;
+    }
+
+    composer->tracking = TRUE;
+    composer_move (composer, key, t.state);
+}
+
+static gboolean
+composer_step (Composer *composer, guint key, gint ascii)
+{
+    ComposerTable *table = composer->table;
+    gboolean retval;
+
+    if (fast_path && composer->tracking && key != KEY_NONE) {
+        ComposerState *state;
+
+        state = &g_array_index (table->states, ComposerState, composer->state);
+        if (state->next != NULL && state->next[key] != 0) {
+            composer->transition = state->next[key] - 1;
+            composer->synced = FALSE;
+            composer_move (composer, key,
+                           composer_get_transition (composer)->state);
+            return composer_get_transition (composer)->retval;
+        }
+    }
+
+    composer_sync (composer);
+    composer->transition = -1;
+
+    if (key == KEY_BACKSPACE)
+        retval = hangul_ic_backspace (composer->context);
+    else
+        retval = hangul_ic_process (composer->context, ascii);
+
+    composer_learn (composer, key, retval);
+
+    return retval;
+}
+
+Composer*
+composer_new (const gchar *keyboard)
+{
+    Composer *composer;
+
+    composer = g_new (Composer, 1);
+    composer->context = hangul_ic_new (keyboard);
+    composer->table = composer_table_get (keyboard);
+    composer_start (composer);
+
+    return composer;
+}
+
+void
+composer_delete (Composer *composer)
+{
+    if (composer == NULL)
+        return;
+
+    hangul_ic_delete (composer->context);
+    g_free (composer);
+}
+
+gboolean
+composer_process (Composer *composer, gint ascii)
+{
+    guint key = KEY_NONE;
+
+    if (ascii >= 0x20 && ascii <= 0x7e)
+        key = ascii - 0x20;
+
+    return composer_step (composer, key, ascii);
+}
+
+gboolean
+composer_backspace (Composer *composer)
+{
+    return composer_step (composer, KEY_BACKSPACE, 0);
+}
+
+void
+composer_reset (Composer *composer)
+{
+    hangul_ic_reset (composer->context);
+    composer_start (composer);
+}
+
+const ucschar*
+composer_flush (Composer *composer)
+{
+    const ucschar *str;
+
+    composer_sync (composer);
+    str = hangul_ic_flush (composer->context);
+    composer_start (composer);
+
+    return str;
+}
+
+void
+composer_select_keyboard (Composer *composer, const gchar *keyboard)
+{
+    composer_sync (composer);
+    hangul_ic_select_keyboard (composer->context, keyboard);
+
+    // The composing syllable is kept, and the table of the new
+    // keyboard can't tell how it was typed.
+    composer->table = composer_table_get (keyboard);
+    composer_start (composer);
+    if (!hangul_ic_is_empty (composer->context))
+        composer->tracking = FALSE;
+}
+
+const ucschar*
+composer_get_preedit_string (Composer *composer)
+{
+    if (!composer->synced) {
+        const ComposerTransition *t = composer_get_transition (composer);
+        return &g_array_index (composer->table->strings, ucschar, t->preedit);
+    }
+
+    return hangul_ic_get_preedit_string (composer->context);
+}
+
+const ucschar*
+composer_get_commit_string (Composer *composer)
+{
+    if (composer->transition >= 0) {
+        const ComposerTransition *t = composer_get_transition (composer);
+        return &g_array_index (composer->table->strings, ucschar, t->commit);
+    }
+
+    return hangul_ic_get_commit_string (composer->context);
+}
+
+void
+composer_set_fast_path (gboolean enabled)
+{
+    fast_path = enabled;
+}
+
+void
+composer_cleanup (void)
+{
+    // the old tables are freed with their destroy notify
+    g_static_private_set (&composer_tables, NULL, NULL);
+}
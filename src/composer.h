@@ -0,0 +1,46 @@
+/* vim:set et sts=4: */
+#ifndef __COMPOSER_H__
+#define __COMPOSER_H__
+
+#include <glib.h>
+#include <hangul.h>
+
+/* Composer wraps a HangulInputContext and has the same interface. For
+ * the standard keyboards it can skip libhangul with a transition table.
+ *
+ * libhangul does not export its keyboard and combination tables, so the
+ * transition table is filled from libhangul itself: the first time a
+ * key is pressed in some state, it goes through hangul_ic_process() and
+ * the result is recorded. A state is the sequence of keys typed since
+ * the context was last empty, which is all the output depends on. So
+ * the table gives exactly libhangul's results, and the context is
+ * brought up to date by replaying those few keys whenever libhangul
+ * itself is needed again. Anything else is done by libhangul.
+ *
+ * The tables are shared by the composers with the same keyboard on the
+ * same thread. Each thread fills tables of its own, so composers can
+ * run on different threads without a lock, but a composer has to stay
+ * on the thread it was made on. */
+typedef struct _Composer Composer;
+
+Composer*      composer_new                 (const gchar *keyboard);
+void           composer_delete              (Composer    *composer);
+
+gboolean       composer_process             (Composer    *composer,
+                                             gint         ascii);
+gboolean       composer_backspace           (Composer    *composer);
+void           composer_reset               (Composer    *composer);
+const ucschar* composer_flush               (Composer    *composer);
+void           composer_select_keyboard     (Composer    *composer,
+                                             const gchar *keyboard);
+
+const ucschar* composer_get_preedit_string  (Composer    *composer);
+const ucschar* composer_get_commit_string   (Composer    *composer);
+
+/* The fast path is off by default. */
+void           composer_set_fast_path       (gboolean     enabled);
+/* Frees the transition tables of the calling thread. Those of other
+ * threads are freed when they exit. */
+void           composer_cleanup             (void);
+
+#endif
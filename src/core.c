@@ -0,0 +1,1642 @@
+/* vim:set et sts=4: */
+#include <string.h>
+
+#include "core.h"
+#include "candidatemerge.h"
+#include "composer.h"
+#include "ustring.h"
+#include "dicttrie.h"
+#include "dictdelta.h"
+#include "fuzzyindex.h"
+#include "chosungindex.h"
+#include "reverseindex.h"
+#include "symbolindex.h"
+#include "snippet.h"
+
+/* the keysyms we handle */
+#define KEY_BackSpace   0xff08
+#define KEY_Return      0xff0d
+#define KEY_Escape      0xff1b
+#define KEY_Left        0xff51
+#define KEY_Up          0xff52
+#define KEY_Right       0xff53
+#define KEY_Down        0xff54
+#define KEY_Page_Up     0xff55
+#define KEY_Page_Down   0xff56
+
+/* candidates on a page, which 1 to 9 select from */
+#define CORE_PAGE_SIZE  9
+
+/* the characters kept of the text followed in the snippets, for the
+ * one before a key */
+#define CORE_SNIPPET_CONTEXT    32
+
+/* the order of the dictionaries, for matches of the same length */
+#define CORE_PRIORITY_SYMBOL    2
+#define CORE_PRIORITY_USER      1
+#define CORE_PRIORITY_HANJA     0
+
+/* which dictionary of CoreDicts a CoreDict is, for its indices */
+typedef enum {
+    CORE_DICT_HANJA,
+    CORE_DICT_USER,
+    CORE_DICT_SYMBOL,
+    CORE_DICT_N
+} CoreDictKind;
+
+/* A dictionary with its indices. When a delta updates one of the
+ * dictionaries, the new CoreDicts shares the others with the old one. */
+typedef struct _CoreDict CoreDict;
+
+struct _CoreDict {
+    volatile gint  ref_count;
+    CoreDictKind   kind;
+    DictTrie      *trie;
+    /* of the last delta applied, 0 for none */
+    guint          version;
+    /* dictionary_get_checksum() of trie, NULL until a delta needs it */
+    gchar         *checksum;
+    FuzzyIndex    *fuzzy_index;
+    ChosungIndex  *chosung_index;
+    ReverseIndex  *reverse_index;
+    SymbolIndex   *symbol_index;
+};
+
+struct _CoreDicts {
+    volatile gint  ref_count;
+    /* NULL for those not loaded */
+    CoreDict      *dicts[CORE_DICT_N];
+    /* the fields below are those of dicts[], for the searches */
+    DictTrie      *hanja_trie;
+    /* the user's own words, NULL if there is no such file */
+    DictTrie      *user_trie;
+    DictTrie      *symbol_trie;
+    FuzzyIndex    *fuzzy_index;
+    ChosungIndex  *chosung_index;
+    ReverseIndex  *reverse_index;
+    SymbolIndex   *symbol_index;
+};
+
+struct _CoreFilter {
+    volatile gint  ref_count;
+    CoreDicts     *dicts;
+    CharFilter    *chars;
+    DictMask      *hanja_mask;
+    DictMask      *user_mask;
+    DictMask      *symbol_mask;
+};
+
+typedef struct _TrieSource TrieSource;
+typedef struct _FuzzySource FuzzySource;
+
+/* the entries of the keys that are a prefix of the search key, longest
+ * first; the rank is the number of characters left over */
+struct _TrieSource {
+    CandidateSource  parent;
+    CoreDicts       *dicts;
+    CoreFilter      *filter;
+    const DictTrie  *trie;
+    DictTrieSearch  *search;
+    const gchar     *key;
+    guint            key_length;
+    /* the first entry, taken for the bound */
+    gboolean         has_first;
+    guint            first_key_id;
+    guint            first_n;
+    guint            first_length;
+    /* the key of the last entry, in the list */
+    guint            prefix_bytes;
+    const gchar     *prefix;
+    guint            prefix_length;
+};
+
+/* the near misses, searched on the first call, which are ranked below
+ * every prefix */
+struct _FuzzySource {
+    CandidateSource  parent;
+    CoreDicts       *dicts;
+    CoreFilter      *filter;
+    const DictMask  *mask;
+    gchar           *key;
+    CandidateList   *matches;
+    guint            n;
+    const gchar     *last_key;
+    const gchar     *list_key;
+};
+
+struct _Core {
+    CoreDicts           *dicts;
+    CoreFilter          *filter;
+    Composer            *composer;
+    /* composed text kept for a hanja conversion */
+    UString             *preedit;
+    /* preedit and the composing syllable, see core_get_preedit() */
+    UString             *buffer;
+    gboolean             hanja_mode;
+    gboolean             vertical;
+
+    CandidateList       *candidates;
+    guint                cursor;
+    gboolean             search_pending;
+    /* the candidates are readings of last_commit */
+    gboolean             reconverting;
+    /* the candidate committed last, while the cursor is behind it */
+    GString             *last_commit;
+    /* symbols are looked up by name, see core_start_symbol_search() */
+    gboolean             symbol_search;
+    GString             *symbol_query;
+
+    /* the user's snippets, see core_set_snippets() */
+    SnippetTable        *snippets;
+    gboolean             snippet_auto_commit;
+    /* where the text before the cursor is in snippets */
+    guint                snippet_state;
+    /* the last characters of that text, and how many there were since
+     * it started */
+    gunichar             snippet_text[CORE_SNIPPET_CONTEXT];
+    guint                snippet_n_chars;
+    /* the last key the text ended with during this key event, or -1 */
+    gint                 snippet_key;
+    /* the text after that key */
+    GString             *snippet_tail;
+    /* the last character is a key the application is yet to insert */
+    gboolean             snippet_pending;
+    /* the candidates are expansions of the snippet key and tail that
+     * are the last snippet_chars characters of the text */
+    gboolean             snippet_offer;
+    guint                snippet_chars;
+    /* the user moved in the offer, so Return and the digits take from
+     * it rather than go to the application */
+    gboolean             snippet_engaged;
+
+    const CoreCallbacks *callbacks;
+    gpointer             user_data;
+};
+
+static const CoreCallbacks no_callbacks = { NULL, };
+
+static void core_flush_preedit (Core *core);
+
+/* Makes the dictionary of trie, which it takes; trie can be NULL. */
+static CoreDict*
+core_dict_new (CoreDictKind kind, DictTrie *trie, guint version)
+{
+    CoreDict *dict;
+
+    if (trie == NULL)
+        return NULL;
+
+    dict = g_new0 (CoreDict, 1);
+    dict->ref_count = 1;
+    dict->kind = kind;
+    dict->trie = trie;
+    dict->version = version;
+
+    switch (kind) {
+    case CORE_DICT_HANJA:
+        dict->fuzzy_index = fuzzy_index_new (trie);
+        dict->chosung_index = chosung_index_new (trie);
+        dict->reverse_index = reverse_index_new (trie);
+        break;
+    case CORE_DICT_SYMBOL:
+        dict->symbol_index = symbol_index_new (trie);
+        break;
+    default:
+        break;
+    }
+
+    return dict;
+}
+
+static void
+core_dict_unref (CoreDict *dict)
+{
+    if (dict == NULL)
+        return;
+
+    if (!g_atomic_int_dec_and_test (&dict->ref_count))
+        return;
+
+    fuzzy_index_delete (dict->fuzzy_index);
+    chosung_index_delete (dict->chosung_index);
+    reverse_index_delete (dict->reverse_index);
+    symbol_index_delete (dict->symbol_index);
+    dict_trie_delete (dict->trie);
+    g_free (dict->checksum);
+    g_free (dict);
+}
+
+/* Makes the CoreDicts of dicts, which it takes. */
+static CoreDicts*
+core_dicts_new (CoreDict *dicts[CORE_DICT_N])
+{
+    CoreDicts *self;
+    CoreDict *hanja, *symbol;
+    guint i;
+
+    self = g_new0 (CoreDicts, 1);
+    self->ref_count = 1;
+    for (i = 0; i < CORE_DICT_N; ++i)
+        self->dicts[i] = dicts[i];
+
+    hanja = dicts[CORE_DICT_HANJA];
+    symbol = dicts[CORE_DICT_SYMBOL];
+    if (hanja != NULL) {
+        self->hanja_trie = hanja->trie;
+        self->fuzzy_index = hanja->fuzzy_index;
+        self->chosung_index = hanja->chosung_index;
+        self->reverse_index = hanja->reverse_index;
+    }
+    if (dicts[CORE_DICT_USER] != NULL)
+        self->user_trie = dicts[CORE_DICT_USER]->trie;
+    if (symbol != NULL) {
+        self->symbol_trie = symbol->trie;
+        self->symbol_index = symbol->symbol_index;
+    }
+
+    return self;
+}
+
+CoreDicts*
+core_dicts_load (const gchar *hanja_file,
+                 const gchar *user_file,
+                 const gchar *symbol_file)
+{
+    CoreDict *dicts[CORE_DICT_N];
+
+    // The dictionaries are read into compact tries rather than
+    // libhangul's HanjaTable, which we can't walk for the indices below
+    // and which keeps every string of the file on its own.
+    dicts[CORE_DICT_HANJA] =
+        core_dict_new (CORE_DICT_HANJA, hanja_file != NULL ?
+                       dict_trie_load (hanja_file) : NULL, 0);
+    dicts[CORE_DICT_USER] =
+        core_dict_new (CORE_DICT_USER, user_file != NULL ?
+                       dict_trie_load (user_file) : NULL, 0);
+    dicts[CORE_DICT_SYMBOL] =
+        core_dict_new (CORE_DICT_SYMBOL, symbol_file != NULL ?
+                       dict_trie_load (symbol_file) : NULL, 0);
+
+    return core_dicts_new (dicts);
+}
+
+CoreDicts*
+core_dicts_ref (CoreDicts *dicts)
+{
+    g_atomic_int_inc (&dicts->ref_count);
+    return dicts;
+}
+
+void
+core_dicts_unref (CoreDicts *dicts)
+{
+    guint i;
+
+    if (dicts == NULL)
+        return;
+
+    if (!g_atomic_int_dec_and_test (&dicts->ref_count))
+        return;
+
+    for (i = 0; i < CORE_DICT_N; ++i)
+        core_dict_unref (dicts->dicts[i]);
+    g_free (dicts);
+}
+
+CoreDicts*
+core_dicts_apply_delta (CoreDicts       *dicts,
+                        const DictDelta *delta,
+                        GError         **error)
+{
+    CoreDict *new_dicts[CORE_DICT_N];
+    CoreDict *dict = NULL;
+    Dictionary *base, *result;
+    guint version = dict_delta_get_version (delta);
+    guint i;
+
+    // The delta says which dictionary it is for by its base only.
+    for (i = 0; i < CORE_DICT_N && dict == NULL; ++i) {
+        CoreDict *d = dicts->dicts[i];
+
+        if (d == NULL)
+            continue;
+
+        if (d->checksum == NULL) {
+            Dictionary *tmp = dict_trie_to_dictionary (d->trie);
+
+            // only the thread of the updates writes this
+            d->checksum = dictionary_get_checksum (tmp);
+            dictionary_delete (tmp);
+        }
+
+        if (strcmp (d->checksum, dict_delta_get_base (delta)) == 0)
+            dict = d;
+    }
+
+    if (dict == NULL) {
+        g_set_error (error, DICT_DELTA_ERROR, DICT_DELTA_ERROR_BASE,
+                     "version %u is for none of the dictionaries", version);
+        return NULL;
+    }
+
+    if (version <= dict->version) {
+        g_set_error (error, DICT_DELTA_ERROR, DICT_DELTA_ERROR_BASE,
+                     "version %u is not newer than %u", version,
+                     dict->version);
+        return NULL;
+    }
+
+    base = dict_trie_to_dictionary (dict->trie);
+    result = dict_delta_apply (delta, base, error);
+    dictionary_delete (base);
+    if (result == NULL)
+        return NULL;
+
+    for (i = 0; i < CORE_DICT_N; ++i) {
+        new_dicts[i] = dicts->dicts[i];
+        if (new_dicts[i] == dict) {
+            new_dicts[i] = core_dict_new (dict->kind,
+                                          dict_trie_new (result), version);
+        } else if (new_dicts[i] != NULL) {
+            g_atomic_int_inc (&new_dicts[i]->ref_count);
+        }
+    }
+    new_dicts[dict->kind]->checksum =
+        g_strdup (dict_delta_get_result (delta));
+    dictionary_delete (result);
+
+    return core_dicts_new (new_dicts);
+}
+
+guint
+core_dicts_get_version (const CoreDicts *dicts)
+{
+    guint version = 0;
+    guint i;
+
+    for (i = 0; i < CORE_DICT_N; ++i) {
+        if (dicts->dicts[i] != NULL)
+            version = MAX (version, dicts->dicts[i]->version);
+    }
+
+    return version;
+}
+
+static gboolean
+trie_source_next (CandidateSource *source,
+                  CandidateList   *list,
+                  CandidateEntry  *entry)
+{
+    TrieSource *self = (TrieSource *) source;
+    guint key_id, n, length;
+
+    if (self->has_first) {
+        self->has_first = FALSE;
+        key_id = self->first_key_id;
+        n = self->first_n;
+        length = self->first_length;
+    } else if (!dict_trie_search_next_entry (self->search,
+                                             &key_id, &n, &length)) {
+        return FALSE;
+    }
+
+    if (self->prefix == NULL || length != self->prefix_bytes) {
+        self->prefix = candidate_list_intern (list, self->key, length);
+        self->prefix_bytes = length;
+        self->prefix_length = g_utf8_strlen (self->prefix, -1);
+    }
+
+    entry->key = self->prefix;
+    entry->value = dict_trie_get_value (self->trie, key_id, n);
+    entry->comment = dict_trie_get_comment (self->trie, key_id, n);
+    entry->length = self->prefix_length;
+    entry->rank = self->key_length - self->prefix_length;
+
+    return TRUE;
+}
+
+static void
+trie_source_destroy (CandidateSource *source)
+{
+    TrieSource *self = (TrieSource *) source;
+
+    dict_trie_search_free (self->search);
+    core_filter_unref (self->filter);
+    core_dicts_unref (self->dicts);
+    g_slice_free (TrieSource, self);
+}
+
+/* Returns the prefix source of key in trie, or NULL if no entry of trie
+ * has a prefix of it. key belongs to the list being filled. */
+static CandidateSource*
+trie_source_new (CoreDicts      *dicts,
+                 CoreFilter     *filter,
+                 const DictTrie *trie,
+                 const DictMask *mask,
+                 const gchar    *key)
+{
+    TrieSource *self;
+    DictTrieSearch *search;
+    guint key_id, n, length;
+
+    if (trie == NULL)
+        return NULL;
+
+    // The first entry gives the bound of the source.
+    search = dict_trie_search_new (trie, mask, key);
+    if (!dict_trie_search_next_entry (search, &key_id, &n, &length)) {
+        dict_trie_search_free (search);
+        return NULL;
+    }
+
+    self = g_slice_new0 (TrieSource);
+    self->parent.next = trie_source_next;
+    self->parent.destroy = trie_source_destroy;
+    self->dicts = core_dicts_ref (dicts);
+    self->filter = filter != NULL ? core_filter_ref (filter) : NULL;
+    self->trie = trie;
+    self->search = search;
+    self->key = key;
+    self->key_length = g_utf8_strlen (key, -1);
+    self->has_first = TRUE;
+    self->first_key_id = key_id;
+    self->first_n = n;
+    self->first_length = length;
+    self->parent.min_rank = self->key_length - g_utf8_strlen (key, length);
+
+    return (CandidateSource *) self;
+}
+
+static gboolean
+fuzzy_source_next (CandidateSource *source,
+                   CandidateList   *list,
+                   CandidateEntry  *entry)
+{
+    FuzzySource *self = (FuzzySource *) source;
+    const gchar *key;
+
+    // The search is the expensive part, and only done if the list gets
+    // as far as the near misses.
+    if (self->matches == NULL) {
+        self->matches = candidate_list_new ();
+        fuzzy_index_search (self->dicts->fuzzy_index, self->mask,
+                            self->key, self->matches);
+    }
+
+    if (self->n >= candidate_list_get_size (self->matches))
+        return FALSE;
+
+    // The keys belong to our list, which goes before the one filled.
+    key = candidate_list_get_nth_key (self->matches, self->n);
+    if (key != self->last_key) {
+        self->last_key = key;
+        self->list_key = candidate_list_intern (list, key, -1);
+    }
+
+    entry->key = self->list_key;
+    entry->value = candidate_list_get_nth_value (self->matches, self->n);
+    entry->comment = candidate_list_get_nth_comment (self->matches, self->n);
+    entry->length = candidate_list_get_nth_length (self->matches, self->n);
+    entry->rank = source->min_rank;
+    self->n++;
+
+    return TRUE;
+}
+
+static void
+fuzzy_source_destroy (CandidateSource *source)
+{
+    FuzzySource *self = (FuzzySource *) source;
+
+    candidate_list_delete (self->matches);
+    g_free (self->key);
+    core_filter_unref (self->filter);
+    core_dicts_unref (self->dicts);
+    g_slice_free (FuzzySource, self);
+}
+
+static CandidateSource*
+fuzzy_source_new (CoreDicts      *dicts,
+                  CoreFilter     *filter,
+                  const DictMask *mask,
+                  const gchar    *key)
+{
+    FuzzySource *self;
+
+    self = g_slice_new0 (FuzzySource);
+    self->parent.next = fuzzy_source_next;
+    self->parent.destroy = fuzzy_source_destroy;
+    // below a prefix of a single character
+    self->parent.min_rank = g_utf8_strlen (key, -1);
+    self->dicts = core_dicts_ref (dicts);
+    self->filter = filter != NULL ? core_filter_ref (filter) : NULL;
+    self->mask = mask;
+    self->key = g_strdup (key);
+
+    return (CandidateSource *) self;
+}
+
+/* TRUE if key is in trie, with an entry that passes mask */
+static gboolean
+core_dicts_has_key (const DictTrie *trie,
+                    const DictMask *mask,
+                    const gchar    *key)
+{
+    gint key_id;
+    guint i, n;
+
+    if (trie == NULL)
+        return FALSE;
+
+    key_id = dict_trie_find_key (trie, key);
+    if (key_id < 0)
+        return FALSE;
+
+    n = dict_trie_get_n_entries (trie, key_id);
+    for (i = 0; i < n; ++i) {
+        if (dict_trie_entry_visible (trie, mask, key_id, i))
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+static void
+core_merge_add (CandidateMerge  *merge,
+                CandidateSource *source,
+                gint             priority)
+{
+    if (source != NULL)
+        candidate_merge_add (merge, source, priority);
+}
+
+CandidateList*
+core_dicts_search (CoreDicts   *dicts,
+                   CoreFilter  *filter,
+                   const gchar *key)
+{
+    CandidateList *list;
+    CandidateMerge *merge;
+    const DictMask *hanja_mask = NULL;
+    const DictMask *user_mask = NULL;
+    const DictMask *symbol_mask = NULL;
+    const gchar *list_key;
+
+    if (filter != NULL) {
+        g_return_val_if_fail (filter->dicts == dicts, NULL);
+        hanja_mask = filter->hanja_mask;
+        user_mask = filter->user_mask;
+        symbol_mask = filter->symbol_mask;
+    }
+
+    list = candidate_list_new ();
+
+    // ㄷㅎㅁㄱ: initial consonants of a word, e.g. 대한민국. This has to
+    // come before the symbol table, which matches the prefix ㄷ.
+    if (chosung_is_abbreviation (key)) {
+        chosung_index_search (dicts->chosung_index, hanja_mask, key, list);
+        if (candidate_list_get_size (list) > 0)
+            return list;
+    }
+
+    // The sources keep the key until the list is complete, so it goes
+    // into the list.
+    list_key = candidate_list_intern (list, key, -1);
+
+    // Longer matches come first, whatever dictionary they are from.
+    merge = candidate_merge_new ();
+    core_merge_add (merge, trie_source_new (dicts, filter, dicts->symbol_trie,
+                                            symbol_mask, list_key),
+                    CORE_PRIORITY_SYMBOL);
+    core_merge_add (merge, trie_source_new (dicts, filter, dicts->user_trie,
+                                            user_mask, list_key),
+                    CORE_PRIORITY_USER);
+    core_merge_add (merge, trie_source_new (dicts, filter, dicts->hanja_trie,
+                                            hanja_mask, list_key),
+                    CORE_PRIORITY_HANJA);
+
+    // If no word covers the whole reading, the reading may have a typo
+    // in it. A word whose entries are all filtered out doesn't count.
+    if (dicts->hanja_trie != NULL &&
+        !core_dicts_has_key (dicts->hanja_trie, hanja_mask, key) &&
+        !core_dicts_has_key (dicts->user_trie, user_mask, key))
+        candidate_merge_add (merge,
+                             fuzzy_source_new (dicts, filter, hanja_mask, key),
+                             CORE_PRIORITY_HANJA);
+
+    candidate_merge_attach (merge, list);
+
+    // Only the first page is made here; the rest as the cursor gets
+    // there, see core_fill_candidates().
+    if (candidate_list_fill (list, CORE_PAGE_SIZE) == 0) {
+        candidate_list_delete (list);
+        return NULL;
+    }
+
+    return list;
+}
+
+static gboolean
+core_filter_accept (const gchar *value, gpointer user_data)
+{
+    return char_filter_accepts ((const CharFilter *) user_data, value);
+}
+
+CoreFilter*
+core_filter_new (CoreDicts *dicts, CharFilter *chars)
+{
+    CoreFilter *filter;
+
+    filter = g_new (CoreFilter, 1);
+    filter->ref_count = 1;
+    filter->dicts = core_dicts_ref (dicts);
+    filter->chars = chars;
+    filter->hanja_mask = dicts->hanja_trie != NULL ?
+                dict_mask_new (dicts->hanja_trie, core_filter_accept, chars) :
+                NULL;
+    filter->user_mask = dicts->user_trie != NULL ?
+                dict_mask_new (dicts->user_trie, core_filter_accept, chars) :
+                NULL;
+    filter->symbol_mask = dicts->symbol_trie != NULL ?
+                dict_mask_new (dicts->symbol_trie, core_filter_accept, chars) :
+                NULL;
+
+    return filter;
+}
+
+CoreFilter*
+core_filter_ref (CoreFilter *filter)
+{
+    g_atomic_int_inc (&filter->ref_count);
+    return filter;
+}
+
+void
+core_filter_unref (CoreFilter *filter)
+{
+    if (filter == NULL)
+        return;
+
+    if (!g_atomic_int_dec_and_test (&filter->ref_count))
+        return;
+
+    dict_mask_delete (filter->hanja_mask);
+    dict_mask_delete (filter->user_mask);
+    dict_mask_delete (filter->symbol_mask);
+    char_filter_delete (filter->chars);
+    core_dicts_unref (filter->dicts);
+    g_free (filter);
+}
+
+Core*
+core_new (CoreDicts *dicts, const gchar *keyboard)
+{
+    Core *core;
+
+    core = g_new0 (Core, 1);
+    core->dicts = core_dicts_ref (dicts);
+    core->composer = composer_new (keyboard);
+    core->preedit = ustring_new ();
+    core->buffer = ustring_new ();
+    core->last_commit = g_string_new (NULL);
+    core->symbol_query = g_string_new (NULL);
+    core->snippet_key = -1;
+    core->snippet_tail = g_string_new (NULL);
+    core->callbacks = &no_callbacks;
+
+    return core;
+}
+
+void
+core_delete (Core *core)
+{
+    if (core == NULL)
+        return;
+
+    if (core->candidates != NULL)
+        candidate_list_delete (core->candidates);
+
+    g_string_free (core->snippet_tail, TRUE);
+    g_string_free (core->symbol_query, TRUE);
+    g_string_free (core->last_commit, TRUE);
+    ustring_delete (core->buffer);
+    ustring_delete (core->preedit);
+    composer_delete (core->composer);
+    snippet_table_unref (core->snippets);
+    core_filter_unref (core->filter);
+    core_dicts_unref (core->dicts);
+    g_free (core);
+}
+
+void
+core_set_callbacks (Core                *core,
+                    const CoreCallbacks *callbacks,
+                    gpointer             user_data)
+{
+    core->callbacks = callbacks != NULL ? callbacks : &no_callbacks;
+    core->user_data = user_data;
+}
+
+CoreDicts*
+core_get_dicts (const Core *core)
+{
+    return core->dicts;
+}
+
+void
+core_set_dicts (Core *core, CoreDicts *dicts)
+{
+    if (dicts == core->dicts)
+        return;
+
+    // The candidates and a search in flight point into the old
+    // dictionaries, and so does the filter.
+    if (core_has_candidates (core))
+        core_hide_candidates (core);
+    core_set_filter (core, NULL);
+
+    core_dicts_ref (dicts);
+    core_dicts_unref (core->dicts);
+    core->dicts = dicts;
+}
+
+void
+core_set_filter (Core *core, CoreFilter *filter)
+{
+    if (filter == core->filter)
+        return;
+
+    if (filter != NULL)
+        core_filter_ref (filter);
+    core_filter_unref (core->filter);
+    core->filter = filter;
+}
+
+CoreFilter*
+core_get_filter (const Core *core)
+{
+    return core->filter;
+}
+
+/* The text before the cursor is not known from here. */
+static void
+core_restart_snippets (Core *core)
+{
+    core->snippet_state = SNIPPET_STATE_START;
+    core->snippet_n_chars = 0;
+}
+
+void
+core_set_snippets (Core         *core,
+                   SnippetTable *snippets,
+                   gboolean      auto_commit)
+{
+    core->snippet_auto_commit = auto_commit;
+    if (snippets == core->snippets)
+        return;
+
+    if (core->snippet_offer)
+        core_hide_candidates (core);
+
+    // the states of one table mean nothing in another
+    if (snippets != NULL)
+        snippet_table_ref (snippets);
+    snippet_table_unref (core->snippets);
+    core->snippets = snippets;
+    core_restart_snippets (core);
+}
+
+void
+core_forget_text (Core *core)
+{
+    core_restart_snippets (core);
+    g_string_truncate (core->last_commit, 0);
+}
+
+void
+core_select_keyboard (Core *core, const gchar *keyboard)
+{
+    composer_select_keyboard (core->composer, keyboard);
+}
+
+gboolean
+core_get_hanja_mode (const Core *core)
+{
+    return core->hanja_mode;
+}
+
+void
+core_set_hanja_mode (Core *core, gboolean hanja_mode)
+{
+    core->hanja_mode = hanja_mode;
+}
+
+void
+core_set_vertical (Core *core, gboolean vertical)
+{
+    core->vertical = vertical;
+}
+
+const ucschar*
+core_get_preedit (Core *core, guint *n_fixed)
+{
+    ustring_clear (core->buffer);
+
+    // a symbol search shows what was typed of the name
+    if (core->symbol_search) {
+        ustring_append_utf8 (core->buffer, core->symbol_query->str);
+        if (n_fixed != NULL)
+            *n_fixed = ustring_length (core->buffer);
+        return ustring_begin (core->buffer);
+    }
+
+    // Our preedit string is made up of the text composed so far and
+    // libhangul's preedit string, which is one syllable at most.
+    ustring_append (core->buffer, core->preedit);
+    ustring_append_ucs4 (core->buffer,
+                         composer_get_preedit_string (core->composer), -1);
+
+    if (n_fixed != NULL)
+        *n_fixed = ustring_length (core->preedit);
+
+    return ustring_begin (core->buffer);
+}
+
+/* Returns TRUE if the text followed ends with key, a snippet key, that
+ * starts a word: "addr" is not typed in "paddr". A key that starts with
+ * a character other than a letter or a digit can go anywhere. */
+static gboolean
+core_snippet_at_boundary (Core *core, gint key)
+{
+    GString *str;
+    glong n_chars;
+    gunichar first;
+    gunichar before;
+
+    str = g_string_new (NULL);
+    dict_trie_get_key (snippet_table_get_trie (core->snippets), key, str);
+    n_chars = g_utf8_strlen (str->str, -1);
+    first = g_utf8_get_char (str->str);
+    g_string_free (str, TRUE);
+
+    if (!g_unichar_isalnum (first))
+        return TRUE;
+
+    // The text may start with the key; past what is kept, the key is
+    // let be.
+    if (core->snippet_n_chars <= n_chars || n_chars >= CORE_SNIPPET_CONTEXT)
+        return TRUE;
+
+    before = core->snippet_text[(core->snippet_n_chars - n_chars - 1) %
+                                CORE_SNIPPET_CONTEXT];
+    return !g_unichar_isalnum (before);
+}
+
+/* Follows the text in the snippets as it goes to the application, a
+ * step for each character. in_app is FALSE for a key the application
+ * inserts once we are done with it. */
+static void
+core_feed_snippets (Core *core, const ucschar *str, gboolean in_app)
+{
+    if (core->snippets == NULL)
+        return;
+
+    for (; *str != 0; ++str) {
+        gint key;
+
+        core->snippet_state = snippet_table_step (core->snippets,
+                                                  core->snippet_state, *str);
+        core->snippet_text[core->snippet_n_chars % CORE_SNIPPET_CONTEXT] =
+            *str;
+        core->snippet_n_chars++;
+
+        key = snippet_table_get_match (core->snippets, core->snippet_state);
+        if (key >= 0 && core_snippet_at_boundary (core, key)) {
+            core->snippet_key = key;
+            g_string_truncate (core->snippet_tail, 0);
+        } else if (core->snippet_key >= 0) {
+            g_string_append_unichar (core->snippet_tail, *str);
+        }
+        core->snippet_pending = !in_app;
+    }
+}
+
+/* Follows a key passed on to the application. */
+static void
+core_feed_key (Core *core, guint keyval)
+{
+    ucschar str[2] = { keyval, 0 };
+
+    // The keysyms of ASCII are its characters. Any other key may move
+    // the cursor, or change the text.
+    if (keyval >= 0x20 && keyval <= 0x7e) {
+        core_feed_snippets (core, str, FALSE);
+    } else {
+        core_restart_snippets (core);
+        core->snippet_key = -1;
+    }
+}
+
+static void
+core_commit (Core *core, const ucschar *str)
+{
+    core_feed_snippets (core, str, TRUE);
+
+    if (core->callbacks->commit != NULL)
+        core->callbacks->commit (core, str, core->user_data);
+}
+
+static void
+core_update_preedit (Core *core)
+{
+    const ucschar *str;
+    guint n_fixed;
+
+    if (core->callbacks->update_preedit == NULL)
+        return;
+
+    str = core_get_preedit (core, &n_fixed);
+    core->callbacks->update_preedit (core, str, n_fixed, core->user_data);
+}
+
+static void
+core_update_cursor (Core *core)
+{
+    if (core->callbacks->update_cursor != NULL)
+        core->callbacks->update_cursor (core, core->cursor, core->user_data);
+}
+
+static void
+core_set_candidates (Core *core, CandidateList *list)
+{
+    if (core->candidates != NULL)
+        candidate_list_delete (core->candidates);
+
+    core->candidates = list;
+    core->cursor = 0;
+    core->reconverting = FALSE;
+    core->snippet_offer = FALSE;
+    core->snippet_engaged = FALSE;
+}
+
+static void
+core_cancel_search (Core *core)
+{
+    if (!core->search_pending)
+        return;
+
+    core->search_pending = FALSE;
+    core->callbacks->search (core, NULL, core->user_data);
+}
+
+static void
+core_apply_candidates (Core *core, CandidateList *list)
+{
+    core_set_candidates (core, list);
+
+    if (list == NULL) {
+        core_hide_candidates (core);
+        return;
+    }
+
+    if (core->callbacks->update_candidates != NULL)
+        core->callbacks->update_candidates (core, list, core->user_data);
+}
+
+static void
+core_search_preedit (Core *core)
+{
+    CandidateList *list;
+    gchar *key = NULL;
+
+    // The candidates of the old preedit string must not be selectable
+    // while the new search is running. The user keeps seeing them
+    // until the result arrives, so that they do not flicker.
+    core_set_candidates (core, NULL);
+
+    core_get_preedit (core, NULL);
+    if (ustring_length (core->buffer) > 0)
+        key = ustring_to_utf8 (core->buffer, -1);
+
+    if (key == NULL) {
+        core_hide_candidates (core);
+        return;
+    }
+
+    if (core->callbacks->search != NULL) {
+        // this replaces any search in flight
+        core->search_pending = TRUE;
+        core->callbacks->search (core, key, core->user_data);
+        g_free (key);
+        return;
+    }
+
+    list = core_dicts_search (core->dicts, core->filter, key);
+    g_free (key);
+
+    core_apply_candidates (core, list);
+}
+
+static void
+core_search_symbols (Core *core)
+{
+    CandidateList *list;
+
+    core_update_preedit (core);
+
+    list = candidate_list_new ();
+    if (symbol_index_search (core->dicts->symbol_index,
+                             core->filter != NULL ?
+                             core->filter->symbol_mask : NULL,
+                             core->symbol_query->str, list) == 0) {
+        candidate_list_delete (list);
+        list = NULL;
+    }
+
+    core_apply_candidates (core, list);
+}
+
+void
+core_start_symbol_search (Core *core)
+{
+    if (core->symbol_search)
+        return;
+
+    core_flush (core);
+    core->symbol_search = TRUE;
+    core_update_preedit (core);
+}
+
+gboolean
+core_get_symbol_search (const Core *core)
+{
+    return core->symbol_search;
+}
+
+static void
+core_end_symbol_search (Core *core)
+{
+    core->symbol_search = FALSE;
+    g_string_truncate (core->symbol_query, 0);
+
+    core_hide_candidates (core);
+    core_update_preedit (core);
+}
+
+void
+core_show_candidates (Core *core)
+{
+    CandidateList *list;
+
+    if (core->symbol_search) {
+        core_search_symbols (core);
+        return;
+    }
+
+    core_get_preedit (core, NULL);
+    if (ustring_length (core->buffer) > 0 || core->last_commit->len == 0) {
+        core_search_preedit (core);
+        return;
+    }
+
+    // The readings are one lookup per character, so they are not worth
+    // a trip to the worker threads.
+    core_cancel_search (core);
+    list = candidate_list_new ();
+    reverse_index_search (core->dicts->reverse_index,
+                          core->last_commit->str, list);
+    if (candidate_list_get_size (list) == 0) {
+        candidate_list_delete (list);
+        list = NULL;
+    }
+
+    core_apply_candidates (core, list);
+    core->reconverting = list != NULL;
+}
+
+void
+core_hide_candidates (Core *core)
+{
+    core_cancel_search (core);
+    core_set_candidates (core, NULL);
+
+    if (core->callbacks->hide_candidates != NULL)
+        core->callbacks->hide_candidates (core, core->user_data);
+}
+
+void
+core_set_search_result (Core *core, CandidateList *list)
+{
+    if (!core->search_pending) {
+        if (list != NULL)
+            candidate_list_delete (list);
+        return;
+    }
+
+    core->search_pending = FALSE;
+    core_apply_candidates (core, list);
+}
+
+gboolean
+core_has_candidates (const Core *core)
+{
+    return core->candidates != NULL || core->search_pending;
+}
+
+const CandidateList*
+core_get_candidates (const Core *core)
+{
+    return core->candidates;
+}
+
+guint
+core_get_cursor (const Core *core)
+{
+    return core->cursor;
+}
+
+static gboolean
+core_move_cursor_up (Core *core)
+{
+    if (core->cursor == 0)
+        return FALSE;
+
+    core->cursor--;
+    return TRUE;
+}
+
+/* Has the candidates made up to the end of the page after that of the
+ * cursor, if they are made on demand. */
+static void
+core_fill_candidates (Core *core)
+{
+    guint n = candidate_list_get_size (core->candidates);
+    guint page_no = core->cursor / CORE_PAGE_SIZE;
+
+    if (candidate_list_fill (core->candidates,
+                             (page_no + 2) * CORE_PAGE_SIZE) == n)
+        return;
+
+    if (core->callbacks->extend_candidates != NULL)
+        core->callbacks->extend_candidates (core, core->candidates, n,
+                                            core->user_data);
+}
+
+static gboolean
+core_move_cursor_down (Core *core)
+{
+    if (core->cursor + 1 >= candidate_list_get_size (core->candidates))
+        core_fill_candidates (core);
+    if (core->cursor + 1 >= candidate_list_get_size (core->candidates))
+        return FALSE;
+
+    core->cursor++;
+    return TRUE;
+}
+
+static gboolean
+core_move_page_up (Core *core)
+{
+    if (core->cursor < CORE_PAGE_SIZE)
+        return FALSE;
+
+    core->cursor -= CORE_PAGE_SIZE;
+    return TRUE;
+}
+
+static gboolean
+core_move_page_down (Core *core)
+{
+    guint n;
+
+    core_fill_candidates (core);
+    n = candidate_list_get_size (core->candidates);
+
+    if (core->cursor / CORE_PAGE_SIZE == (n - 1) / CORE_PAGE_SIZE)
+        return FALSE;
+
+    core->cursor = MIN (core->cursor + CORE_PAGE_SIZE, n - 1);
+    return TRUE;
+}
+
+void
+core_cursor_up (Core *core)
+{
+    if (core->candidates != NULL && core_move_cursor_up (core))
+        core_update_cursor (core);
+}
+
+void
+core_cursor_down (Core *core)
+{
+    if (core->candidates != NULL && core_move_cursor_down (core))
+        core_update_cursor (core);
+}
+
+static gboolean
+core_can_delete_text (Core *core)
+{
+    return core->callbacks->delete_text != NULL &&
+           core->callbacks->delete_text (core, 0, core->user_data);
+}
+
+/* Replaces the last n_chars characters of the text with value and tail.
+ * Returns FALSE if the application can't delete them. */
+static gboolean
+core_expand_snippet (Core        *core,
+                     guint        n_chars,
+                     const gchar *value,
+                     const gchar *tail)
+{
+    gchar *text;
+    gunichar *str;
+
+    if (n_chars > 0 &&
+        (core->callbacks->delete_text == NULL ||
+         !core->callbacks->delete_text (core, n_chars, core->user_data)))
+        return FALSE;
+
+    // An expansion is not typed, so it doesn't go to the snippets.
+    text = g_strconcat (value, tail, NULL);
+    str = g_utf8_to_ucs4_fast (text, -1, NULL);
+    if (core->callbacks->commit != NULL)
+        core->callbacks->commit (core, str, core->user_data);
+    g_free (str);
+    g_free (text);
+
+    core_restart_snippets (core);
+    return TRUE;
+}
+
+static void
+core_commit_current_candidate (Core *core)
+{
+    const gchar *value;
+    gunichar *str;
+    guint key_len;
+    guint preedit_len;
+
+    value = candidate_list_get_nth_value (core->candidates, core->cursor);
+    if (value == NULL)
+        return;
+
+    if (core->symbol_search) {
+        core->symbol_search = FALSE;
+        g_string_truncate (core->symbol_query, 0);
+        core_update_preedit (core);
+
+        str = g_utf8_to_ucs4_fast (value, -1, NULL);
+        core_commit (core, str);
+        g_free (str);
+        return;
+    }
+
+    if (core->snippet_offer) {
+        core_expand_snippet (core, core->snippet_chars, value,
+                             core->snippet_tail->str);
+        return;
+    }
+
+    if (core->reconverting) {
+        guint n_chars = g_utf8_strlen (core->last_commit->str, -1);
+
+        g_string_truncate (core->last_commit, 0);
+        if (core->callbacks->delete_text == NULL ||
+            !core->callbacks->delete_text (core, n_chars, core->user_data))
+            return;
+
+        str = g_utf8_to_ucs4_fast (value, -1, NULL);
+        core_commit (core, str);
+        g_free (str);
+        return;
+    }
+
+    key_len = candidate_list_get_nth_length (core->candidates, core->cursor);
+    preedit_len = ustring_length (core->preedit);
+
+    ustring_erase (core->preedit, 0, MIN (key_len, preedit_len));
+    if (key_len > preedit_len)
+        composer_reset (core->composer);
+
+    core_update_preedit (core);
+
+    str = g_utf8_to_ucs4_fast (value, -1, NULL);
+    core_commit (core, str);
+    g_free (str);
+
+    g_string_assign (core->last_commit, value);
+}
+
+/* After a candidate is taken, hanja mode goes on with the rest of the
+ * preedit string. */
+static void
+core_candidate_done (Core *core)
+{
+    if (core->hanja_mode && !core->reconverting && !core->snippet_offer)
+        core_search_preedit (core);
+    else
+        core_hide_candidates (core);
+}
+
+void
+core_select_candidate (Core *core, guint n)
+{
+    if (core->candidates == NULL)
+        return;
+
+    core->cursor = n;
+    core_commit_current_candidate (core);
+    core_candidate_done (core);
+}
+
+static gboolean
+core_process_candidate_key (Core *core, guint keyval)
+{
+    gboolean (*move) (Core *core) = NULL;
+
+    // An offer of snippets comes up as the text is typed, so the keys
+    // that take from it are the application's until the user moves in
+    // it.
+    if (core->snippet_offer && !core->snippet_engaged &&
+        (keyval == KEY_Return || (keyval >= '1' && keyval <= '9')))
+        return FALSE;
+
+    if (keyval == KEY_Escape) {
+        core_hide_candidates (core);
+        return TRUE;
+    } else if (keyval == KEY_Return) {
+        core_commit_current_candidate (core);
+        core_candidate_done (core);
+        return TRUE;
+    } else if (keyval >= '1' && keyval <= '9') {
+        guint page_no = core->cursor / CORE_PAGE_SIZE;
+
+        core->cursor = page_no * CORE_PAGE_SIZE + (keyval - '1');
+        core_commit_current_candidate (core);
+        core_candidate_done (core);
+        return TRUE;
+    } else if (keyval == KEY_Page_Up) {
+        move = core_move_page_up;
+    } else if (keyval == KEY_Page_Down) {
+        move = core_move_page_down;
+    } else if (keyval == KEY_Left) {
+        move = core->vertical ? core_move_page_up : core_move_cursor_up;
+    } else if (keyval == KEY_Right) {
+        move = core->vertical ? core_move_page_down : core_move_cursor_down;
+    } else if (keyval == KEY_Up) {
+        move = core->vertical ? core_move_cursor_up : core_move_page_up;
+    } else if (keyval == KEY_Down) {
+        move = core->vertical ? core_move_cursor_down : core_move_page_down;
+    } else if (!core->hanja_mode && !core->snippet_offer) {
+        // vi keys, when the letters are not being typed
+        if (keyval == 'h')
+            move = core->vertical ? core_move_page_up : core_move_cursor_up;
+        else if (keyval == 'l')
+            move = core->vertical ? core_move_page_down : core_move_cursor_down;
+        else if (keyval == 'k')
+            move = core->vertical ? core_move_cursor_up : core_move_page_up;
+        else if (keyval == 'j')
+            move = core->vertical ? core_move_cursor_down : core_move_page_down;
+    }
+
+    if (move == NULL)
+        return FALSE;
+
+    core->snippet_engaged = core->snippet_offer;
+    if (move (core))
+        core_update_cursor (core);
+    return TRUE;
+}
+
+static gboolean
+core_process_symbol_key (Core *core, guint keyval)
+{
+    if (keyval == KEY_Escape ||
+        (keyval == KEY_Return && core->candidates == NULL)) {
+        core_end_symbol_search (core);
+        return TRUE;
+    }
+
+    if (keyval == KEY_BackSpace) {
+        if (core->symbol_query->len == 0) {
+            core_end_symbol_search (core);
+            return TRUE;
+        }
+
+        g_string_truncate (core->symbol_query, core->symbol_query->len - 1);
+        core_search_symbols (core);
+        return TRUE;
+    }
+
+    // Printable keys go to the name, but for the digits that select
+    // from the list.
+    if (keyval >= 0x20 && keyval < 0x7f &&
+        !(core->candidates != NULL && keyval >= '1' && keyval <= '9')) {
+        g_string_append_c (core->symbol_query, keyval);
+        core_search_symbols (core);
+        return TRUE;
+    }
+
+    if (core->candidates != NULL && core_process_candidate_key (core, keyval))
+        return TRUE;
+
+    core_end_symbol_search (core);
+    return FALSE;
+}
+
+static gboolean
+core_handle_key (Core *core, guint keyval)
+{
+    const ucschar *str;
+    gboolean retval;
+
+    if (core->symbol_search)
+        return core_process_symbol_key (core, keyval);
+
+    // Outside hanja mode nothing searches again after the key, so the
+    // result of a search in flight would be of the old preedit string.
+    if (core->search_pending && !core->hanja_mode)
+        core_hide_candidates (core);
+
+    if (core->candidates != NULL) {
+        retval = core_process_candidate_key (core, keyval);
+        if (retval)
+            return TRUE;
+
+        // In hanja mode the list stays up while typing, so only the
+        // keys that act on it are taken. Snippets are offered as the
+        // text goes by, and typing on leaves them.
+        if (core->snippet_offer)
+            core_hide_candidates (core);
+        else if (!core->hanja_mode)
+            return TRUE;
+    }
+
+    // the cursor moves away from what was committed
+    g_string_truncate (core->last_commit, 0);
+
+    if (keyval == KEY_BackSpace)
+        retval = composer_backspace (core->composer);
+    else
+        retval = composer_process (core->composer, keyval);
+
+    str = composer_get_commit_string (core->composer);
+    if (core->hanja_mode) {
+        const ucschar *hic_preedit;
+
+        // Keep the composed text for the conversion, until the
+        // composition stops.
+        ustring_append_ucs4 (core->preedit, str, -1);
+        hic_preedit = composer_get_preedit_string (core->composer);
+        if (hic_preedit == NULL || hic_preedit[0] == 0) {
+            if (ustring_length (core->preedit) > 0)
+                core_commit (core, ustring_begin (core->preedit));
+            ustring_clear (core->preedit);
+        }
+    } else if (str != NULL && str[0] != 0) {
+        core_commit (core, str);
+    }
+
+    core_update_preedit (core);
+
+    if (core->hanja_mode)
+        core_search_preedit (core);
+
+    if (!retval) {
+        core_flush_preedit (core);
+        core_feed_key (core, keyval);
+    }
+
+    return retval;
+}
+
+/* Acts on the snippet key the text ends with after a key event that
+ * returned retval, and returns the new retval. */
+static gboolean
+core_apply_snippet (Core *core, gboolean retval)
+{
+    const DictTrie *trie = snippet_table_get_trie (core->snippets);
+    GString *key;
+    guint key_chars;
+    guint tail_chars;
+
+    // The key typed can't be taken back without it.
+    if (!core_can_delete_text (core))
+        return retval;
+
+    key = g_string_new (NULL);
+    dict_trie_get_key (trie, core->snippet_key, key);
+    key_chars = g_utf8_strlen (key->str, -1);
+    tail_chars = g_utf8_strlen (core->snippet_tail->str, -1);
+
+    if (!core->snippet_auto_commit) {
+        CandidateList *list;
+
+        // The hanja of the preedit string come first.
+        if (core->hanja_mode || core_has_candidates (core)) {
+            g_string_free (key, TRUE);
+            return retval;
+        }
+
+        list = candidate_list_new ();
+        dict_trie_append_entries (trie, NULL, core->snippet_key, key->str,
+                                  key_chars, list);
+        core_apply_candidates (core, list);
+
+        // the application has the key passed on by the time one of the
+        // expansions is taken
+        core->snippet_offer = TRUE;
+        core->snippet_chars = key_chars + tail_chars;
+        g_string_free (key, TRUE);
+        return retval;
+    }
+
+    // A key passed on to the application is taken instead if it ends the
+    // snippet key, and comes after the expansion otherwise.
+    if (!core->snippet_pending) {
+        core_expand_snippet (core, key_chars + tail_chars,
+                             dict_trie_get_value (trie, core->snippet_key, 0),
+                             core->snippet_tail->str);
+    } else if (tail_chars == 0) {
+        if (core_expand_snippet (core, key_chars - 1,
+                                 dict_trie_get_value (trie,
+                                                      core->snippet_key, 0),
+                                 ""))
+            retval = TRUE;
+    } else {
+        // the key is ASCII, one byte
+        g_string_truncate (core->snippet_tail, core->snippet_tail->len - 1);
+        core_expand_snippet (core, key_chars + tail_chars - 1,
+                             dict_trie_get_value (trie, core->snippet_key, 0),
+                             core->snippet_tail->str);
+    }
+
+    g_string_free (key, TRUE);
+    return retval;
+}
+
+gboolean
+core_process_key (Core *core, guint keyval)
+{
+    gboolean retval;
+
+    core->snippet_key = -1;
+    retval = core_handle_key (core, keyval);
+    if (core->snippet_key >= 0) {
+        retval = core_apply_snippet (core, retval);
+        core->snippet_key = -1;
+    }
+
+    return retval;
+}
+
+
+static void
+core_flush_preedit (Core *core)
+{
+    const ucschar *str;
+
+    // the name typed so far is not text
+    if (core->symbol_search) {
+        core_end_symbol_search (core);
+        return;
+    }
+
+    core_hide_candidates (core);
+
+    str = composer_flush (core->composer);
+    ustring_append_ucs4 (core->preedit, str, -1);
+
+    if (ustring_length (core->preedit) > 0) {
+        core_feed_snippets (core, ustring_begin (core->preedit), TRUE);
+        if (core->callbacks->end_preedit != NULL)
+            core->callbacks->end_preedit (core, ustring_begin (core->preedit),
+                                          core->user_data);
+    }
+
+    ustring_clear (core->preedit);
+    g_string_truncate (core->last_commit, 0);
+}
+
+void
+core_flush (Core *core)
+{
+    core_flush_preedit (core);
+
+    // the cursor may go anywhere from here
+    core_restart_snippets (core);
+}
+
+void
+core_reset (Core *core)
+{
+    core_cancel_search (core);
+    core_set_candidates (core, NULL);
+    composer_reset (core->composer);
+    ustring_clear (core->preedit);
+    g_string_truncate (core->last_commit, 0);
+    core->symbol_search = FALSE;
+    g_string_truncate (core->symbol_query, 0);
+    core->hanja_mode = FALSE;
+    core_restart_snippets (core);
+}
@@ -0,0 +1,187 @@
+/* vim:set et sts=4: */
+#ifndef __CORE_H__
+#define __CORE_H__
+
+#include <glib.h>
+#include <hangul.h>
+
+#include "candidate.h"
+#include "charfilter.h"
+#include "dictdelta.h"
+#include "snippet.h"
+
+/* The input method without IBus: composition, the preedit string, hanja
+ * mode and the candidate list of one input context. The IBus engine is
+ * an adapter over it, and benchmarks and batch tools can drive it
+ * directly.
+ *
+ * A Core is used from the thread it was made on, but any number of
+ * them can run on different threads, see composer.h. The dictionaries
+ * are shared between them: a CoreDicts is read only once loaded, and
+ * can be searched from several threads at once. */
+typedef struct _Core Core;
+typedef struct _CoreDicts CoreDicts;
+typedef struct _CoreFilter CoreFilter;
+typedef struct _CoreCallbacks CoreCallbacks;
+
+/* What a Core tells its user. Any of them can be NULL. Strings are only
+ * valid during the call. */
+struct _CoreCallbacks {
+    /* str goes to the application */
+    void (*commit)             (Core                *core,
+                                const ucschar       *str,
+                                gpointer             user_data);
+    /* The whole preedit string. Its first n_fixed characters are
+     * composed already, and are kept for a hanja conversion. */
+    void (*update_preedit)     (Core                *core,
+                                const ucschar       *str,
+                                guint                n_fixed,
+                                gpointer             user_data);
+    /* The preedit string is done with: the application keeps str as it
+     * is shown. */
+    void (*end_preedit)        (Core                *core,
+                                const ucschar       *str,
+                                gpointer             user_data);
+    /* A new candidate list, with the cursor on the first candidate. */
+    void (*update_candidates)  (Core                *core,
+                                const CandidateList *list,
+                                gpointer             user_data);
+    void (*update_cursor)      (Core                *core,
+                                guint                cursor,
+                                gpointer             user_data);
+    void (*hide_candidates)    (Core                *core,
+                                gpointer             user_data);
+    /* Searches key in the background, for core_set_search_result().
+     * A new search replaces the one in flight; key is NULL if that is
+     * only cancelled. Without this callback searches are done in place
+     * with core_dicts_search(). */
+    void (*search)             (Core                *core,
+                                const gchar         *key,
+                                gpointer             user_data);
+    /* Deletes the n_chars characters before the cursor, for a
+     * reconversion. Returns FALSE if the application can't; with
+     * n_chars 0 it only tells that. */
+    gboolean (*delete_text)    (Core                *core,
+                                guint                n_chars,
+                                gpointer             user_data);
+    /* The candidates from first on were made as the cursor got to
+     * them, and are added to list. The cursor comes next. */
+    void (*extend_candidates)  (Core                *core,
+                                const CandidateList *list,
+                                guint                first,
+                                gpointer             user_data);
+};
+
+/* Loads the dictionaries; files that can't be read are left out.
+ * user_file has words of the user's own, in the format of hanja_file. */
+CoreDicts*     core_dicts_load          (const gchar         *hanja_file,
+                                         const gchar         *user_file,
+                                         const gchar         *symbol_file);
+CoreDicts*     core_dicts_ref           (CoreDicts           *dicts);
+void           core_dicts_unref         (CoreDicts           *dicts);
+/* Returns dicts with delta applied to the dictionary it is for, which
+ * dicts shares the others with, or NULL. A delta for a dictionary
+ * updated to its version already is refused. Reads the dictionaries
+ * back out of their tries, so it is slow: run it off the main thread,
+ * one update at a time. */
+CoreDicts*     core_dicts_apply_delta   (CoreDicts           *dicts,
+                                         const DictDelta     *delta,
+                                         GError             **error);
+/* the version of the last delta applied to any of the dictionaries */
+guint          core_dicts_get_version   (const CoreDicts     *dicts);
+/* Returns the candidates of key that pass filter, or NULL. filter can
+ * be NULL. The symbols, the user's words and the hanja are merged,
+ * longer matches first. Only the first page is made; the list makes the
+ * rest on demand, see candidate_list_fill(), and can then only be used
+ * from one thread at a time. Thread safe. */
+CandidateList* core_dicts_search        (CoreDicts           *dicts,
+                                         CoreFilter          *filter,
+                                         const gchar         *key);
+
+/* Keeps the hanja and symbols of dicts made of the characters of chars
+ * only, e.g. those an old application can show. The filter takes chars,
+ * and is read only once made; the entries are sorted out here, so
+ * searches don't slow down. */
+CoreFilter*    core_filter_new          (CoreDicts           *dicts,
+                                         CharFilter          *chars);
+CoreFilter*    core_filter_ref          (CoreFilter          *filter);
+void           core_filter_unref        (CoreFilter          *filter);
+
+Core*          core_new                 (CoreDicts           *dicts,
+                                         const gchar         *keyboard);
+void           core_delete              (Core                *core);
+void           core_set_callbacks       (Core                *core,
+                                         const CoreCallbacks *callbacks,
+                                         gpointer             user_data);
+
+/* Switches core to dicts, e.g. updated ones. The candidates shown are
+ * hidden, and the filter is dropped: make a new one for dicts. */
+void           core_set_dicts           (Core                *core,
+                                         CoreDicts           *dicts);
+CoreDicts*     core_get_dicts           (const Core          *core);
+void           core_select_keyboard     (Core                *core,
+                                         const gchar         *keyboard);
+gboolean       core_get_hanja_mode      (const Core          *core);
+void           core_set_hanja_mode      (Core                *core,
+                                         gboolean             hanja_mode);
+/* The filter of the candidates, NULL for all of them. It has to be
+ * made for the dicts of core. */
+void           core_set_filter          (Core                *core,
+                                         CoreFilter          *filter);
+CoreFilter*    core_get_filter          (const Core          *core);
+/* The user's snippets, expanded as their keys are typed; NULL for none.
+ * With auto_commit a key is replaced with its first expansion at once,
+ * else its expansions are offered as candidates, outside hanja mode. */
+void           core_set_snippets        (Core                *core,
+                                         SnippetTable        *snippets,
+                                         gboolean             auto_commit);
+/* The text around the cursor changed without core, e.g. with a key it
+ * didn't see: nothing typed before goes on to a snippet key. */
+void           core_forget_text         (Core                *core);
+/* whether the candidates are shown in a column, which changes the
+ * arrow keys */
+void           core_set_vertical        (Core                *core,
+                                         gboolean             vertical);
+
+/* Handles a key press. keyval is an X keysym, and is expected without
+ * Control or Alt, and with Caps Lock already undone. Returns FALSE if
+ * the key is left to the application; the preedit string has been
+ * ended then. */
+gboolean       core_process_key         (Core                *core,
+                                         guint                keyval);
+/* Ends the preedit string and hides the candidates. */
+void           core_flush               (Core                *core);
+/* Forgets everything, without any callback. */
+void           core_reset               (Core                *core);
+
+/* Returns the preedit string, and the number of composed characters at
+ * its start. Valid until the Core changes. */
+const ucschar* core_get_preedit         (Core                *core,
+                                         guint               *n_fixed);
+
+/* Starts looking up symbols by name: the keys that follow are the
+ * words of the name, and the candidates the symbols that match them.
+ * Escape, or BackSpace with nothing typed, ends it. */
+void           core_start_symbol_search (Core                *core);
+gboolean       core_get_symbol_search   (const Core          *core);
+
+/* Searches the candidates of the preedit string. Without one, the
+ * readings of the candidate committed last are shown instead, which
+ * replace it if the application lets us delete it. */
+void           core_show_candidates     (Core                *core);
+void           core_hide_candidates     (Core                *core);
+/* TRUE if candidates are shown or being searched */
+gboolean       core_has_candidates      (const Core          *core);
+const CandidateList*
+               core_get_candidates      (const Core          *core);
+guint          core_get_cursor          (const Core          *core);
+void           core_cursor_up           (Core                *core);
+void           core_cursor_down         (Core                *core);
+/* Commits candidate n. */
+void           core_select_candidate    (Core                *core,
+                                         guint                n);
+/* Takes the result of the search callback; list can be NULL. */
+void           core_set_search_result   (Core                *core,
+                                         CandidateList       *list);
+
+#endif
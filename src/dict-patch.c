@@ -0,0 +1,146 @@
+/* vim:set et sts=4: */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <locale.h>
+
+#include "dictionary.h"
+#include "dictdelta.h"
+
+/* Makes and applies dictionary deltas offline, see dictdelta.h. A
+ * release ships the deltas since the last full dictionary; the engine
+ * applies them at startup, and a packager can merge them into a new
+ * full dictionary with "apply" once they pile up. */
+
+static void
+usage (void)
+{
+    fprintf (stderr,
+             "usage: ibus-hangul-dict-patch diff OLD NEW VERSION DELTA\n"
+             "       ibus-hangul-dict-patch apply DICT DELTA... OUTPUT\n"
+             "       ibus-hangul-dict-patch checksum DICT\n");
+    exit (2);
+}
+
+static Dictionary*
+load_dictionary (const gchar *filename)
+{
+    Dictionary *dict;
+
+    dict = dictionary_load (filename);
+    if (dict == NULL) {
+        fprintf (stderr, "can't read %s\n", filename);
+        exit (1);
+    }
+
+    return dict;
+}
+
+static gint
+patch_diff (gint argc, gchar **argv)
+{
+    Dictionary *old_dict, *new_dict;
+    GError *error = NULL;
+    gboolean res;
+
+    if (argc != 4)
+        usage ();
+
+    old_dict = load_dictionary (argv[0]);
+    new_dict = load_dictionary (argv[1]);
+    res = dict_delta_diff (old_dict, new_dict, atoi (argv[2]), argv[3],
+                           &error);
+    dictionary_delete (old_dict);
+    dictionary_delete (new_dict);
+
+    if (!res) {
+        fprintf (stderr, "%s\n", error->message);
+        g_error_free (error);
+        return 1;
+    }
+
+    return 0;
+}
+
+static gint
+patch_apply (gint argc, gchar **argv)
+{
+    Dictionary *dict;
+    gint i;
+
+    if (argc < 3)
+        usage ();
+
+    dict = load_dictionary (argv[0]);
+
+    // the deltas in the order given, each for the result of the last
+    for (i = 1; i < argc - 1; i++) {
+        DictDelta *delta;
+        Dictionary *next;
+        GError *error = NULL;
+
+        delta = dict_delta_load (argv[i], &error);
+        next = delta != NULL ? dict_delta_apply (delta, dict, &error) : NULL;
+        dict_delta_free (delta);
+        if (next == NULL) {
+            fprintf (stderr, "%s: %s\n", argv[i], error->message);
+            g_error_free (error);
+            dictionary_delete (dict);
+            return 1;
+        }
+
+        dictionary_delete (dict);
+        dict = next;
+    }
+
+    if (!dictionary_save (dict, argv[argc - 1])) {
+        fprintf (stderr, "can't write %s\n", argv[argc - 1]);
+        dictionary_delete (dict);
+        return 1;
+    }
+
+    dictionary_delete (dict);
+    return 0;
+}
+
+static gint
+patch_checksum (gint argc, gchar **argv)
+{
+    Dictionary *dict;
+    gchar *checksum;
+
+    if (argc != 1)
+        usage ();
+
+    dict = load_dictionary (argv[0]);
+    checksum = dictionary_get_checksum (dict);
+    printf ("%s\n", checksum);
+    g_free (checksum);
+    dictionary_delete (dict);
+
+    return 0;
+}
+
+int
+main (gint argc, gchar **argv)
+{
+    setlocale (LC_ALL, "");
+
+    if (argc < 2)
+        usage ();
+
+    if (strcmp (argv[1], "diff") == 0)
+        return patch_diff (argc - 2, argv + 2);
+    if (strcmp (argv[1], "apply") == 0)
+        return patch_apply (argc - 2, argv + 2);
+    if (strcmp (argv[1], "checksum") == 0)
+        return patch_checksum (argc - 2, argv + 2);
+
+    usage ();
+    return 2;
+}
@@ -0,0 +1,467 @@
+/* vim:set et sts=4: */
+#include <stdlib.h>
+#include <string.h>
+
+#include "dictdelta.h"
+
+typedef struct _DictChange DictChange;
+
+struct _DictChange {
+    /* '+', '-' or '=' */
+    gchar        op;
+    const gchar *key;
+    const gchar *value;
+    /* of an entry added */
+    const gchar *comment;
+    /* where an entry is moved to */
+    guint        place;
+    guint        line;
+};
+
+struct _DictDelta {
+    /* the file, split in place; the strings below point into it */
+    gchar       *contents;
+    guint        version;
+    const gchar *base;
+    const gchar *result;
+    GArray      *changes;
+};
+
+GQuark
+dict_delta_error_quark (void)
+{
+    return g_quark_from_static_string ("dict-delta-error-quark");
+}
+
+/* Splits the next field off str at ':'. Returns the rest, or NULL if it
+ * was the last field. */
+static gchar*
+next_field (gchar *str)
+{
+    gchar *p = strchr (str, ':');
+
+    if (p != NULL)
+        *p++ = '\0';
+    return p;
+}
+
+static gboolean
+dict_delta_parse_line (DictDelta *delta, gchar *line, guint line_no)
+{
+    DictChange change = { 0, };
+    gchar *rest;
+
+    if (line[0] == '@') {
+        gchar *value = strchr (line, ' ');
+
+        if (value == NULL)
+            return FALSE;
+        *value++ = '\0';
+
+        if (strcmp (line, "@version") == 0)
+            delta->version = strtoul (value, NULL, 10);
+        else if (strcmp (line, "@base") == 0)
+            delta->base = value;
+        else if (strcmp (line, "@result") == 0)
+            delta->result = value;
+        else
+            return FALSE;
+        return TRUE;
+    }
+
+    change.op = line[0];
+    change.key = line + 1;
+    change.line = line_no;
+
+    rest = next_field (line + 1);
+    if (rest == NULL || change.key[0] == '\0')
+        return FALSE;
+    change.value = rest;
+    rest = next_field (rest);
+    if (change.value[0] == '\0')
+        return FALSE;
+
+    switch (change.op) {
+    case '+':
+        change.comment = rest != NULL ? rest : "";
+        break;
+    case '-':
+        break;
+    case '=':
+        if (rest == NULL || !g_ascii_isdigit (rest[0]))
+            return FALSE;
+        change.place = strtoul (rest, NULL, 10);
+        break;
+    default:
+        return FALSE;
+    }
+
+    g_array_append_val (delta->changes, change);
+    return TRUE;
+}
+
+/* Makes the delta of contents, which it takes. */
+static DictDelta*
+dict_delta_parse (gchar *contents, const gchar *filename, GError **error)
+{
+    DictDelta *delta;
+    gchar *line;
+    gchar *next;
+    guint line_no = 0;
+
+    delta = g_new0 (DictDelta, 1);
+    delta->contents = contents;
+    delta->changes = g_array_new (FALSE, FALSE, sizeof (DictChange));
+
+    for (line = contents; line != NULL && *line != '\0'; line = next) {
+        next = strchr (line, '\n');
+        if (next != NULL)
+            *next++ = '\0';
+        line_no++;
+
+        if (line[0] == '#' || line[0] == '\0')
+            continue;
+
+        if (!dict_delta_parse_line (delta, line, line_no)) {
+            g_set_error (error, DICT_DELTA_ERROR, DICT_DELTA_ERROR_PARSE,
+                         "%s:%u: bad line", filename, line_no);
+            dict_delta_free (delta);
+            return NULL;
+        }
+    }
+
+    if (delta->version == 0 || delta->base == NULL || delta->result == NULL) {
+        g_set_error (error, DICT_DELTA_ERROR, DICT_DELTA_ERROR_PARSE,
+                     "%s: no @version, @base or @result", filename);
+        dict_delta_free (delta);
+        return NULL;
+    }
+
+    return delta;
+}
+
+DictDelta*
+dict_delta_load (const gchar *filename, GError **error)
+{
+    gchar *contents;
+
+    if (!g_file_get_contents (filename, &contents, NULL, error))
+        return NULL;
+
+    return dict_delta_parse (contents, filename, error);
+}
+
+void
+dict_delta_free (DictDelta *delta)
+{
+    if (delta == NULL)
+        return;
+
+    g_array_free (delta->changes, TRUE);
+    g_free (delta->contents);
+    g_free (delta);
+}
+
+guint
+dict_delta_get_version (const DictDelta *delta)
+{
+    return delta->version;
+}
+
+const gchar*
+dict_delta_get_base (const DictDelta *delta)
+{
+    return delta->base;
+}
+
+const gchar*
+dict_delta_get_result (const DictDelta *delta)
+{
+    return delta->result;
+}
+
+/* Returns the place of value in entries, or -1. */
+static gint
+find_value (const GArray *entries, const gchar *value)
+{
+    guint i;
+
+    for (i = 0; i < entries->len; ++i) {
+        if (strcmp (g_array_index (entries, DictEntry, i).value, value) == 0)
+            return i;
+    }
+
+    return -1;
+}
+
+static void
+entries_free (gpointer data)
+{
+    g_array_free ((GArray *) data, TRUE);
+}
+
+/* the entries of every key of dict, in a table by key */
+static GHashTable*
+entries_by_key (const Dictionary *dict)
+{
+    GHashTable *table;
+    guint i, n_keys;
+
+    table = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+                                   entries_free);
+
+    n_keys = dictionary_get_n_keys (dict);
+    for (i = 0; i < n_keys; ++i) {
+        const DictEntry *entries;
+        GArray *array;
+        guint n;
+
+        entries = dictionary_get_entries (dict, i, &n);
+        array = g_array_sized_new (FALSE, FALSE, sizeof (DictEntry), n);
+        g_array_append_vals (array, entries, n);
+        g_hash_table_insert (table, (gpointer) entries[0].key, array);
+    }
+
+    return table;
+}
+
+static gboolean
+apply_change (GHashTable *table, const DictChange *change)
+{
+    GArray *entries;
+    DictEntry entry;
+    gint i;
+
+    entries = g_hash_table_lookup (table, change->key);
+    if (entries == NULL) {
+        if (change->op != '+')
+            return FALSE;
+        entries = g_array_new (FALSE, FALSE, sizeof (DictEntry));
+        g_hash_table_insert (table, (gpointer) change->key, entries);
+    }
+
+    i = find_value (entries, change->value);
+
+    switch (change->op) {
+    case '+':
+        if (i >= 0)
+            return FALSE;
+        entry.key = change->key;
+        entry.value = change->value;
+        entry.comment = change->comment;
+        g_array_append_val (entries, entry);
+        break;
+    case '-':
+        if (i < 0)
+            return FALSE;
+        g_array_remove_index (entries, i);
+        break;
+    case '=':
+        if (i < 0)
+            return FALSE;
+        entry = g_array_index (entries, DictEntry, i);
+        g_array_remove_index (entries, i);
+        g_array_insert_val (entries, MIN (change->place, entries->len),
+                            entry);
+        break;
+    }
+
+    return TRUE;
+}
+
+static void
+append_entries (gpointer key, gpointer value, gpointer user_data)
+{
+    GArray *entries = value;
+    GArray *all = user_data;
+
+    g_array_append_vals (all, entries->data, entries->len);
+}
+
+Dictionary*
+dict_delta_apply (const DictDelta  *delta,
+                  const Dictionary *base,
+                  GError          **error)
+{
+    Dictionary *dict;
+    GHashTable *table;
+    GArray *all;
+    gchar *checksum;
+    guint i;
+
+    checksum = dictionary_get_checksum (base);
+    if (strcmp (checksum, delta->base) != 0) {
+        g_set_error (error, DICT_DELTA_ERROR, DICT_DELTA_ERROR_BASE,
+                     "version %u is for another dictionary", delta->version);
+        g_free (checksum);
+        return NULL;
+    }
+    g_free (checksum);
+
+    // The strings point into base and delta, until the new dictionary
+    // copies them.
+    table = entries_by_key (base);
+    for (i = 0; i < delta->changes->len; ++i) {
+        const DictChange *change = &g_array_index (delta->changes,
+                                                   DictChange, i);
+
+        if (!apply_change (table, change)) {
+            g_set_error (error, DICT_DELTA_ERROR, DICT_DELTA_ERROR_RESULT,
+                         "version %u, line %u: no such entry, or one "
+                         "already there", delta->version, change->line);
+            g_hash_table_destroy (table);
+            return NULL;
+        }
+    }
+
+    all = g_array_new (FALSE, FALSE, sizeof (DictEntry));
+    g_hash_table_foreach (table, append_entries, all);
+    dict = dictionary_new ((const DictEntry *) all->data, all->len);
+    g_array_free (all, TRUE);
+    g_hash_table_destroy (table);
+
+    checksum = dictionary_get_checksum (dict);
+    if (strcmp (checksum, delta->result) != 0) {
+        g_set_error (error, DICT_DELTA_ERROR, DICT_DELTA_ERROR_RESULT,
+                     "version %u doesn't give the dictionary expected",
+                     delta->version);
+        dictionary_delete (dict);
+        dict = NULL;
+    }
+    g_free (checksum);
+
+    return dict;
+}
+
+/* Appends the changes that make the entries of a key in old_entries
+ * into those in new_entries to str. Either can be empty. */
+static void
+diff_key (GString         *str,
+          const DictEntry *old_entries,
+          guint            n_old,
+          const DictEntry *new_entries,
+          guint            n_new)
+{
+    GArray *entries;
+    guint i;
+    gint j;
+
+    entries = g_array_new (FALSE, FALSE, sizeof (DictEntry));
+
+    // removed, or with a new comment
+    for (i = 0; i < n_old; ++i) {
+        const DictEntry *e = &old_entries[i];
+
+        for (j = 0; j < (gint) n_new; ++j) {
+            if (strcmp (new_entries[j].value, e->value) == 0)
+                break;
+        }
+
+        if (j == (gint) n_new || strcmp (new_entries[j].comment,
+                                         e->comment) != 0)
+            g_string_append_printf (str, "-%s:%s\n", e->key, e->value);
+        else
+            g_array_append_val (entries, *e);
+    }
+
+    // added, at the end
+    for (i = 0; i < n_new; ++i) {
+        const DictEntry *e = &new_entries[i];
+
+        if (find_value (entries, e->value) >= 0)
+            continue;
+        g_string_append_printf (str, "+%s:%s:%s\n",
+                                e->key, e->value, e->comment);
+        g_array_append_val (entries, *e);
+    }
+
+    // then moved into place, one at a time
+    for (i = 0; i < n_new; ++i) {
+        DictEntry e;
+
+        j = find_value (entries, new_entries[i].value);
+        if (j == (gint) i)
+            continue;
+
+        e = g_array_index (entries, DictEntry, j);
+        g_array_remove_index (entries, j);
+        g_array_insert_val (entries, i, e);
+        g_string_append_printf (str, "=%s:%s:%u\n", e.key, e.value, i);
+    }
+
+    g_array_free (entries, TRUE);
+}
+
+gboolean
+dict_delta_diff (const Dictionary *old_dict,
+                 const Dictionary *new_dict,
+                 guint             version,
+                 const gchar      *filename,
+                 GError          **error)
+{
+    GString *str;
+    DictDelta *delta;
+    Dictionary *check;
+    gchar *checksum;
+    guint n_old = dictionary_get_n_keys (old_dict);
+    guint n_new = dictionary_get_n_keys (new_dict);
+    guint i = 0, j = 0;
+    gboolean res;
+
+    str = g_string_new (NULL);
+    g_string_append_printf (str, "@version %u\n", MAX (version, 1));
+    checksum = dictionary_get_checksum (old_dict);
+    g_string_append_printf (str, "@base %s\n", checksum);
+    g_free (checksum);
+    checksum = dictionary_get_checksum (new_dict);
+    g_string_append_printf (str, "@result %s\n", checksum);
+    g_free (checksum);
+
+    // the keys of both are sorted
+    while (i < n_old || j < n_new) {
+        const DictEntry *old_entries = NULL;
+        const DictEntry *new_entries = NULL;
+        guint n_old_entries = 0;
+        guint n_new_entries = 0;
+        gint res;
+
+        if (i == n_old)
+            res = 1;
+        else if (j == n_new)
+            res = -1;
+        else
+            res = strcmp (dictionary_get_key (old_dict, i),
+                          dictionary_get_key (new_dict, j));
+
+        if (res <= 0)
+            old_entries = dictionary_get_entries (old_dict, i++,
+                                                  &n_old_entries);
+        if (res >= 0)
+            new_entries = dictionary_get_entries (new_dict, j++,
+                                                  &n_new_entries);
+
+        diff_key (str, old_entries, n_old_entries,
+                  new_entries, n_new_entries);
+    }
+
+    // A value twice in one key can't be told apart, so the delta is
+    // checked before it is written.
+    delta = dict_delta_parse (g_strdup (str->str), filename, error);
+    if (delta == NULL) {
+        g_string_free (str, TRUE);
+        return FALSE;
+    }
+
+    check = dict_delta_apply (delta, old_dict, error);
+    dict_delta_free (delta);
+    if (check == NULL) {
+        g_string_free (str, TRUE);
+        return FALSE;
+    }
+    dictionary_delete (check);
+
+    res = g_file_set_contents (filename, str->str, str->len, error);
+    g_string_free (str, TRUE);
+
+    return res;
+}
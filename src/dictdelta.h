@@ -0,0 +1,59 @@
+/* vim:set et sts=4: */
+#ifndef __DICT_DELTA_H__
+#define __DICT_DELTA_H__
+
+#include <glib.h>
+
+#include "dictionary.h"
+
+/* DictDelta is a patch to a dictionary, so a refreshed dictionary can be
+ * shipped as the lines that change rather than a whole file. It is
+ * text, one change to a line:
+ *
+ *   @version 3                 the version the delta makes
+ *   @base <sha1>               dictionary_get_checksum() of the base
+ *   @result <sha1>             and of the result, to verify it
+ *   +key:value:comment         adds an entry, after those of key
+ *   -key:value                 removes an entry
+ *   =key:value:n               moves an entry to place n of key
+ *
+ * Lines starting with # are comments. The changes are applied in the
+ * order of the file. A delta only applies to the dictionary it was made
+ * from, and gives the one it was made for, or nothing. */
+typedef struct _DictDelta DictDelta;
+
+#define DICT_DELTA_ERROR (dict_delta_error_quark ())
+
+typedef enum {
+    /* the file can't be read, or a line is not understood */
+    DICT_DELTA_ERROR_PARSE,
+    /* the dictionary is not the base of the delta */
+    DICT_DELTA_ERROR_BASE,
+    /* a change doesn't apply, or the result is not the one expected */
+    DICT_DELTA_ERROR_RESULT,
+} DictDeltaError;
+
+GQuark       dict_delta_error_quark   (void);
+
+DictDelta*   dict_delta_load          (const gchar      *filename,
+                                       GError          **error);
+void         dict_delta_free          (DictDelta        *delta);
+
+guint        dict_delta_get_version   (const DictDelta  *delta);
+const gchar* dict_delta_get_base      (const DictDelta  *delta);
+const gchar* dict_delta_get_result    (const DictDelta  *delta);
+
+/* Returns base with the changes of delta, or NULL. */
+Dictionary*  dict_delta_apply         (const DictDelta  *delta,
+                                       const Dictionary *base,
+                                       GError          **error);
+
+/* Writes the delta that makes new_dict out of old_dict to filename,
+ * as version. */
+gboolean     dict_delta_diff          (const Dictionary *old_dict,
+                                       const Dictionary *new_dict,
+                                       guint             version,
+                                       const gchar      *filename,
+                                       GError          **error);
+
+#endif
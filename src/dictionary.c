@@ -0,0 +1,263 @@
+/* vim:set et sts=4: */
+#include <string.h>
+
+#include "dictionary.h"
+
+typedef struct _DictKey DictKey;
+
+struct _DictKey {
+    guint first;
+    guint n;
+};
+
+struct _Dictionary {
+    gchar     *contents;
+    GArray    *entries;
+    GArray    *keys;
+};
+
+static gint
+dict_entry_compare (gconstpointer a, gconstpointer b)
+{
+    const DictEntry *e1 = (const DictEntry *) a;
+    const DictEntry *e2 = (const DictEntry *) b;
+    gint res;
+
+    res = strcmp (e1->key, e2->key);
+    if (res != 0)
+        return res;
+
+    // The strings point into the file buffer, so comparing the
+    // addresses keeps the file order of entries with the same key.
+    if (e1->key < e2->key)
+        return -1;
+    return e1->key > e2->key;
+}
+
+/* Sorts the entries and finds the keys. */
+static void
+dictionary_index (Dictionary *dict)
+{
+    guint i;
+
+    g_array_sort (dict->entries, dict_entry_compare);
+
+    for (i = 0; i < dict->entries->len; ++i) {
+        DictEntry *entry = &g_array_index (dict->entries, DictEntry, i);
+        DictKey *last = NULL;
+
+        if (dict->keys->len > 0)
+            last = &g_array_index (dict->keys, DictKey, dict->keys->len - 1);
+
+        if (last != NULL &&
+            strcmp (g_array_index (dict->entries, DictEntry, last->first).key,
+                    entry->key) == 0) {
+            last->n++;
+        } else {
+            DictKey key = { i, 1 };
+            g_array_append_val (dict->keys, key);
+        }
+    }
+}
+
+Dictionary*
+dictionary_new (const DictEntry *entries, guint n_entries)
+{
+    Dictionary *dict;
+    gsize size = 0;
+    gchar *p;
+    guint i;
+
+    for (i = 0; i < n_entries; ++i) {
+        size += strlen (entries[i].key) + strlen (entries[i].value) +
+                strlen (entries[i].comment) + 3;
+    }
+
+    dict = g_new (Dictionary, 1);
+    dict->contents = g_malloc (MAX (size, 1));
+    dict->entries = g_array_sized_new (FALSE, FALSE, sizeof (DictEntry),
+                                       n_entries);
+    dict->keys = g_array_new (FALSE, FALSE, sizeof (DictKey));
+
+    // The strings are copied in order into one buffer, as if read from
+    // a file, so the sort keeps the order of entries with the same key.
+    p = dict->contents;
+    for (i = 0; i < n_entries; ++i) {
+        DictEntry entry;
+
+        entry.key = p;
+        p = g_stpcpy (p, entries[i].key) + 1;
+        entry.value = p;
+        p = g_stpcpy (p, entries[i].value) + 1;
+        entry.comment = p;
+        p = g_stpcpy (p, entries[i].comment) + 1;
+
+        if (entry.key[0] == '\0' || entry.value[0] == '\0')
+            continue;
+
+        g_array_append_val (dict->entries, entry);
+    }
+
+    dictionary_index (dict);
+
+    return dict;
+}
+
+Dictionary*
+dictionary_load (const gchar *filename)
+{
+    Dictionary *dict;
+    gchar *contents;
+    gchar *line;
+    gchar *next;
+
+    if (!g_file_get_contents (filename, &contents, NULL, NULL))
+        return NULL;
+
+    dict = g_new (Dictionary, 1);
+    dict->contents = contents;
+    dict->entries = g_array_new (FALSE, FALSE, sizeof (DictEntry));
+    dict->keys = g_array_new (FALSE, FALSE, sizeof (DictKey));
+
+    // The file is split in place, so the entries don't need
+    // a copy of their strings.
+    for (line = contents; line != NULL && *line != '\0'; line = next) {
+        DictEntry entry;
+        gchar *p;
+
+        next = strchr (line, '\n');
+        if (next != NULL)
+            *next++ = '\0';
+
+        if (line[0] == '#' || line[0] == '\0')
+            continue;
+
+        p = strchr (line, ':');
+        if (p == NULL)
+            continue;
+        *p++ = '\0';
+        entry.key = line;
+        entry.value = p;
+
+        p = strchr (p, ':');
+        if (p != NULL) {
+            *p++ = '\0';
+            entry.comment = p;
+        } else {
+            entry.comment = "";
+        }
+
+        if (entry.key[0] == '\0' || entry.value[0] == '\0')
+            continue;
+
+        g_array_append_val (dict->entries, entry);
+    }
+
+    dictionary_index (dict);
+
+    return dict;
+}
+
+gboolean
+dictionary_save (const Dictionary *dict, const gchar *filename)
+{
+    GString *str;
+    gboolean res;
+    guint i;
+
+    str = g_string_new (NULL);
+    for (i = 0; i < dict->entries->len; ++i) {
+        const DictEntry *entry = &g_array_index (dict->entries, DictEntry, i);
+
+        g_string_append_printf (str, "%s:%s:%s\n",
+                                entry->key, entry->value, entry->comment);
+    }
+
+    res = g_file_set_contents (filename, str->str, str->len, NULL);
+    g_string_free (str, TRUE);
+
+    return res;
+}
+
+gchar*
+dictionary_get_checksum (const Dictionary *dict)
+{
+    GChecksum *checksum;
+    gchar *res;
+    guint i;
+
+    // the lines dictionary_save() writes, so a file and its dictionary
+    // have the same checksum if the file is sorted
+    checksum = g_checksum_new (G_CHECKSUM_SHA1);
+    for (i = 0; i < dict->entries->len; ++i) {
+        const DictEntry *entry = &g_array_index (dict->entries, DictEntry, i);
+
+        g_checksum_update (checksum, (const guchar *) entry->key, -1);
+        g_checksum_update (checksum, (const guchar *) ":", 1);
+        g_checksum_update (checksum, (const guchar *) entry->value, -1);
+        g_checksum_update (checksum, (const guchar *) ":", 1);
+        g_checksum_update (checksum, (const guchar *) entry->comment, -1);
+        g_checksum_update (checksum, (const guchar *) "\n", 1);
+    }
+
+    res = g_strdup (g_checksum_get_string (checksum));
+    g_checksum_free (checksum);
+
+    return res;
+}
+
+void
+dictionary_delete (Dictionary *dict)
+{
+    if (dict == NULL)
+        return;
+
+    g_array_free (dict->keys, TRUE);
+    g_array_free (dict->entries, TRUE);
+    g_free (dict->contents);
+    g_free (dict);
+}
+
+guint
+dictionary_get_n_keys (const Dictionary *dict)
+{
+    return dict->keys->len;
+}
+
+const gchar*
+dictionary_get_key (const Dictionary *dict, guint key_id)
+{
+    const DictKey *key = &g_array_index (dict->keys, DictKey, key_id);
+    return g_array_index (dict->entries, DictEntry, key->first).key;
+}
+
+const DictEntry*
+dictionary_get_entries (const Dictionary *dict, guint key_id, guint *n_entries)
+{
+    const DictKey *key = &g_array_index (dict->keys, DictKey, key_id);
+
+    if (n_entries != NULL)
+        *n_entries = key->n;
+    return &g_array_index (dict->entries, DictEntry, key->first);
+}
+
+gint
+dictionary_find_key (const Dictionary *dict, const gchar *key)
+{
+    guint low = 0;
+    guint high = dict->keys->len;
+
+    while (low < high) {
+        guint mid = low + (high - low) / 2;
+        gint res = strcmp (dictionary_get_key (dict, mid), key);
+
+        if (res == 0)
+            return mid;
+        else if (res < 0)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    return -1;
+}
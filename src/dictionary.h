@@ -0,0 +1,44 @@
+/* vim:set et sts=4: */
+#ifndef __DICTIONARY_H__
+#define __DICTIONARY_H__
+
+#include <glib.h>
+
+typedef struct _Dictionary Dictionary;
+typedef struct _DictEntry DictEntry;
+
+/* One line of a dictionary file in the "key:value:comment" format used
+ * by libhangul's hanja.txt and our symbol.txt. All strings are owned by
+ * the Dictionary. */
+struct _DictEntry {
+    const gchar *key;
+    const gchar *value;
+    const gchar *comment;
+};
+
+Dictionary*      dictionary_load          (const gchar      *filename);
+/* A dictionary of copies of entries, in any order. */
+Dictionary*      dictionary_new           (const DictEntry  *entries,
+                                           guint             n_entries);
+void             dictionary_delete        (Dictionary       *dict);
+/* Writes the entries in the file format, sorted by key. Returns FALSE
+ * if the file can't be written. */
+gboolean         dictionary_save          (const Dictionary *dict,
+                                           const gchar      *filename);
+/* The SHA-1 of the entries, in hex, to be freed. It only depends on the
+ * entries and their order, not on the comments and blank lines of the
+ * file they come from. */
+gchar*           dictionary_get_checksum  (const Dictionary *dict);
+
+/* Entries are sorted by key; entries with the same key keep the order of
+ * the file. Every distinct key has an id in [0, n_keys). */
+guint            dictionary_get_n_keys    (const Dictionary *dict);
+const gchar*     dictionary_get_key       (const Dictionary *dict,
+                                           guint             key_id);
+const DictEntry* dictionary_get_entries   (const Dictionary *dict,
+                                           guint             key_id,
+                                           guint            *n_entries);
+gint             dictionary_find_key      (const Dictionary *dict,
+                                           const gchar      *key);
+
+#endif
@@ -0,0 +1,874 @@
+/* vim:set et sts=4: */
+#include <string.h>
+
+#include "dicttrie.h"
+
+/* The rank directory keeps the number of ones before every block. */
+#define BLOCK_BITS      512
+#define BLOCK_WORDS     (BLOCK_BITS / 64)
+
+typedef struct _BitVector BitVector;
+typedef struct _TrieRange TrieRange;
+typedef struct _TrieFrame TrieFrame;
+
+struct _BitVector {
+    guint64 *words;
+    guint32 *ranks;
+    guint    n_bits;
+    guint    n_blocks;
+};
+
+/* keys [first, last) of the dictionary below a node at depth bytes */
+struct _TrieRange {
+    guint first;
+    guint last;
+    guint depth;
+};
+
+struct _TrieFrame {
+    guint node;
+    guint depth;
+};
+
+/* The trie is stored in level order. Node ids are numbered in that
+ * order, the root being 0. louds is "10" followed, for every node, by
+ * a 1 for each of its children and a 0. So node x is the x-th 1, and its
+ * children are the 1s after the x-th 0. */
+struct _DictTrie {
+    BitVector  louds;
+    BitVector  terminal;
+    guint8    *labels;
+    guint      n_nodes;
+
+    // key_id is the rank of the node in terminal
+    guint      n_keys;
+    guint32   *offsets;
+    guint32   *entries;
+    guint      n_entries;
+
+    gchar     *pool;
+    gsize      pool_size;
+};
+
+/* a bit for each entry of the trie */
+struct _DictMask {
+    guint64   *bits;
+    guint      n_entries;
+};
+
+struct _DictTrieSearch {
+    const DictTrie *trie;
+    const DictMask *mask;
+    gchar          *key;
+    /* the prefixes, longest first, and their lengths in bytes */
+    GArray         *key_ids;
+    GArray         *lengths;
+    /* the next entry is entry n of prefix i */
+    guint           i;
+    guint           n;
+    /* prefix i in prefix_list, NULL until it is needed */
+    const CandidateList *prefix_list;
+    const gchar    *prefix;
+    guint           prefix_length;
+    /* -1 until counted */
+    gint            total;
+};
+
+static void
+bit_vector_push (GArray *words, guint *n_bits, gboolean bit)
+{
+    if (*n_bits % 64 == 0) {
+        guint64 zero = 0;
+        g_array_append_val (words, zero);
+    }
+    if (bit)
+        g_array_index (words, guint64, *n_bits / 64) |=
+            G_GUINT64_CONSTANT (1) << (*n_bits % 64);
+    (*n_bits)++;
+}
+
+static void
+bit_vector_init (BitVector *bv, GArray *words, guint n_bits)
+{
+    guint32 rank = 0;
+    guint i;
+
+    // pad to whole blocks, so rank and select never read past the end
+    g_array_set_size (words, (n_bits / BLOCK_BITS + 1) * BLOCK_WORDS);
+
+    bv->n_bits = n_bits;
+    bv->n_blocks = n_bits / BLOCK_BITS + 1;
+    bv->ranks = g_new (guint32, bv->n_blocks);
+    for (i = 0; i < bv->n_blocks; ++i) {
+        guint j;
+
+        bv->ranks[i] = rank;
+        for (j = 0; j < BLOCK_WORDS; ++j)
+            rank += __builtin_popcountll (g_array_index (words, guint64,
+                                                 i * BLOCK_WORDS + j));
+    }
+    bv->words = (guint64 *) g_array_free (words, FALSE);
+}
+
+static void
+bit_vector_clear (BitVector *bv)
+{
+    g_free (bv->words);
+    g_free (bv->ranks);
+}
+
+static gsize
+bit_vector_get_size (const BitVector *bv)
+{
+    return bv->n_blocks * (BLOCK_WORDS * sizeof (guint64) + sizeof (guint32));
+}
+
+static inline gboolean
+bit_vector_get (const BitVector *bv, guint pos)
+{
+    return (bv->words[pos / 64] >> (pos % 64)) & 1;
+}
+
+/* number of ones in [0, pos) */
+static guint
+bit_vector_rank (const BitVector *bv, guint pos)
+{
+    guint rank = bv->ranks[pos / BLOCK_BITS];
+    guint i;
+
+    for (i = pos / BLOCK_BITS * BLOCK_WORDS; i < pos / 64; ++i)
+        rank += __builtin_popcountll (bv->words[i]);
+    if (pos % 64 != 0)
+        rank += __builtin_popcountll (bv->words[pos / 64] &
+                    ((G_GUINT64_CONSTANT (1) << (pos % 64)) - 1));
+
+    return rank;
+}
+
+/* position of the n-th (from 0) bit equal to bit, which must exist */
+static guint
+bit_vector_select (const BitVector *bv, guint n, gboolean bit)
+{
+    guint low = 0;
+    guint high = bv->n_blocks;
+    guint i;
+
+    // the last block with at most n such bits before it
+    while (low + 1 < high) {
+        guint mid = low + (high - low) / 2;
+        guint count = bit ? bv->ranks[mid] : mid * BLOCK_BITS - bv->ranks[mid];
+
+        if (count <= n)
+            low = mid;
+        else
+            high = mid;
+    }
+
+    n -= bit ? bv->ranks[low] : low * BLOCK_BITS - bv->ranks[low];
+    for (i = low * BLOCK_WORDS; ; ++i) {
+        guint64 word = bit ? bv->words[i] : ~bv->words[i];
+        guint count = __builtin_popcountll (word);
+
+        if (n < count) {
+            while (n-- > 0)
+                word &= word - 1;
+            return i * 64 + __builtin_ctzll (word);
+        }
+        n -= count;
+    }
+}
+
+static guint32
+string_pool_add (GString *pool, GHashTable *strings, const gchar *str)
+{
+    gpointer offset;
+
+    // offset 0 is the empty string
+    if (str[0] == '\0')
+        return 0;
+
+    offset = g_hash_table_lookup (strings, str);
+    if (offset == NULL) {
+        offset = GUINT_TO_POINTER (pool->len);
+        g_string_append_len (pool, str, strlen (str) + 1);
+        g_hash_table_insert (strings, (gpointer) str, offset);
+    }
+
+    return GPOINTER_TO_UINT (offset);
+}
+
+DictTrie*
+dict_trie_new (const Dictionary *dict)
+{
+    DictTrie *trie;
+    GArray *queue;
+    GArray *louds;
+    GArray *terminal;
+    GByteArray *labels;
+    GArray *offsets;
+    GArray *entries;
+    GString *pool;
+    GHashTable *strings;
+    guint n_louds = 0;
+    guint n_terminal = 0;
+    guint head;
+
+    if (dict == NULL)
+        return NULL;
+
+    queue = g_array_new (FALSE, FALSE, sizeof (TrieRange));
+    louds = g_array_new (FALSE, TRUE, sizeof (guint64));
+    terminal = g_array_new (FALSE, TRUE, sizeof (guint64));
+    labels = g_byte_array_new ();
+    offsets = g_array_new (FALSE, FALSE, sizeof (guint32));
+    entries = g_array_new (FALSE, FALSE, sizeof (guint32));
+    pool = g_string_new_len ("", 1);
+    strings = g_hash_table_new (g_str_hash, g_str_equal);
+
+    {
+        TrieRange root = { 0, dictionary_get_n_keys (dict), 0 };
+        guint8 none = 0;
+
+        g_array_append_val (queue, root);
+        g_byte_array_append (labels, &none, 1);
+        bit_vector_push (louds, &n_louds, TRUE);
+        bit_vector_push (louds, &n_louds, FALSE);
+    }
+
+    // The keys are sorted, so the keys below a node are a range of them,
+    // and a key that ends at the node is the first one of its range.
+    for (head = 0; head < queue->len; ++head) {
+        TrieRange range = g_array_index (queue, TrieRange, head);
+        guint i = range.first;
+        gboolean is_terminal = FALSE;
+
+        if (i < range.last &&
+            dictionary_get_key (dict, i)[range.depth] == '\0') {
+            const DictEntry *dict_entries;
+            guint32 offset = entries->len / 2;
+            guint j, n;
+
+            g_array_append_val (offsets, offset);
+            dict_entries = dictionary_get_entries (dict, i, &n);
+            for (j = 0; j < n; ++j) {
+                guint32 value = string_pool_add (pool, strings,
+                                                 dict_entries[j].value);
+                guint32 comment = string_pool_add (pool, strings,
+                                                   dict_entries[j].comment);
+                g_array_append_val (entries, value);
+                g_array_append_val (entries, comment);
+            }
+
+            is_terminal = TRUE;
+            i++;
+        }
+        bit_vector_push (terminal, &n_terminal, is_terminal);
+
+        while (i < range.last) {
+            guint8 c = dictionary_get_key (dict, i)[range.depth];
+            TrieRange child = { i, i + 1, range.depth + 1 };
+
+            while (child.last < range.last &&
+                   (guint8) dictionary_get_key (dict, child.last)[range.depth] == c)
+                child.last++;
+
+            g_array_append_val (queue, child);
+            g_byte_array_append (labels, &c, 1);
+            bit_vector_push (louds, &n_louds, TRUE);
+            i = child.last;
+        }
+        bit_vector_push (louds, &n_louds, FALSE);
+    }
+
+    trie = g_new (DictTrie, 1);
+    trie->n_nodes = queue->len;
+    trie->n_keys = offsets->len;
+    trie->n_entries = entries->len / 2;
+
+    {
+        guint32 end = trie->n_entries;
+        g_array_append_val (offsets, end);
+    }
+
+    bit_vector_init (&trie->louds, louds, n_louds);
+    bit_vector_init (&trie->terminal, terminal, n_terminal);
+    trie->labels = g_byte_array_free (labels, FALSE);
+    trie->offsets = (guint32 *) g_array_free (offsets, FALSE);
+    trie->entries = (guint32 *) g_array_free (entries, FALSE);
+    trie->pool_size = pool->len;
+    trie->pool = g_string_free (pool, FALSE);
+
+    g_hash_table_destroy (strings);
+    g_array_free (queue, TRUE);
+
+    return trie;
+}
+
+DictTrie*
+dict_trie_load (const gchar *filename)
+{
+    Dictionary *dict;
+    DictTrie *trie;
+
+    dict = dictionary_load (filename);
+    if (dict == NULL)
+        return NULL;
+
+    trie = dict_trie_new (dict);
+    dictionary_delete (dict);
+
+    return trie;
+}
+
+void
+dict_trie_delete (DictTrie *trie)
+{
+    if (trie == NULL)
+        return;
+
+    bit_vector_clear (&trie->louds);
+    bit_vector_clear (&trie->terminal);
+    g_free (trie->labels);
+    g_free (trie->offsets);
+    g_free (trie->entries);
+    g_free (trie->pool);
+    g_free (trie);
+}
+
+guint
+dict_trie_get_n_keys (const DictTrie *trie)
+{
+    return trie->n_keys;
+}
+
+gsize
+dict_trie_get_size (const DictTrie *trie)
+{
+    return sizeof (DictTrie) +
+           bit_vector_get_size (&trie->louds) +
+           bit_vector_get_size (&trie->terminal) +
+           trie->n_nodes +
+           (trie->n_keys + 1) * sizeof (guint32) +
+           trie->n_entries * 2 * sizeof (guint32) +
+           trie->pool_size;
+}
+
+/* the position in louds of the first child of node */
+static inline guint
+dict_trie_first_child (const DictTrie *trie, guint node)
+{
+    return bit_vector_select (&trie->louds, node, FALSE) + 1;
+}
+
+static gint
+dict_trie_child (const DictTrie *trie, guint node, guint8 c)
+{
+    guint pos = dict_trie_first_child (trie, node);
+    guint child = pos - node - 1;
+
+    // the labels of the children are sorted
+    for (; bit_vector_get (&trie->louds, pos); ++pos, ++child) {
+        if (trie->labels[child] == c)
+            return child;
+        if (trie->labels[child] > c)
+            break;
+    }
+
+    return -1;
+}
+
+static inline guint
+dict_trie_parent (const DictTrie *trie, guint node)
+{
+    guint pos = bit_vector_select (&trie->louds, node, TRUE);
+
+    // there is one 0 for every node before the parent, and the root's
+    return pos - node - 1;
+}
+
+void
+dict_trie_get_key (const DictTrie *trie, guint key_id, GString *key)
+{
+    guint node = bit_vector_select (&trie->terminal, key_id, TRUE);
+
+    g_string_truncate (key, 0);
+    while (node != 0) {
+        g_string_append_c (key, trie->labels[node]);
+        node = dict_trie_parent (trie, node);
+    }
+    g_strreverse (key->str);
+}
+
+gint
+dict_trie_find_key (const DictTrie *trie, const gchar *key)
+{
+    gint node = 0;
+
+    for (; *key != '\0'; ++key) {
+        node = dict_trie_child (trie, node, *key);
+        if (node < 0)
+            return -1;
+    }
+
+    if (!bit_vector_get (&trie->terminal, node))
+        return -1;
+    return bit_vector_rank (&trie->terminal, node);
+}
+
+guint
+dict_trie_get_n_nodes (const DictTrie *trie)
+{
+    return trie->n_nodes;
+}
+
+guint
+dict_trie_get_parent (const DictTrie *trie, guint node)
+{
+    return dict_trie_parent (trie, node);
+}
+
+guint8
+dict_trie_get_label (const DictTrie *trie, guint node)
+{
+    return trie->labels[node];
+}
+
+gint
+dict_trie_get_node_key (const DictTrie *trie, guint node)
+{
+    if (!bit_vector_get (&trie->terminal, node))
+        return -1;
+    return bit_vector_rank (&trie->terminal, node);
+}
+
+guint
+dict_trie_get_n_entries (const DictTrie *trie, guint key_id)
+{
+    return trie->offsets[key_id + 1] - trie->offsets[key_id];
+}
+
+const gchar*
+dict_trie_get_value (const DictTrie *trie, guint key_id, guint n)
+{
+    guint entry = trie->offsets[key_id] + n;
+    return trie->pool + trie->entries[entry * 2];
+}
+
+const gchar*
+dict_trie_get_comment (const DictTrie *trie, guint key_id, guint n)
+{
+    guint entry = trie->offsets[key_id] + n;
+    return trie->pool + trie->entries[entry * 2 + 1];
+}
+
+Dictionary*
+dict_trie_to_dictionary (const DictTrie *trie)
+{
+    Dictionary *dict;
+    GStringChunk *keys;
+    GArray *entries;
+    GString *key;
+    guint i, j;
+
+    keys = g_string_chunk_new (4096);
+    entries = g_array_sized_new (FALSE, FALSE, sizeof (DictEntry),
+                                 trie->n_entries);
+    key = g_string_new (NULL);
+
+    for (i = 0; i < trie->n_keys; ++i) {
+        DictEntry entry;
+
+        dict_trie_get_key (trie, i, key);
+        entry.key = g_string_chunk_insert_len (keys, key->str, key->len);
+        for (j = trie->offsets[i]; j < trie->offsets[i + 1]; ++j) {
+            entry.value = trie->pool + trie->entries[j * 2];
+            entry.comment = trie->pool + trie->entries[j * 2 + 1];
+            g_array_append_val (entries, entry);
+        }
+    }
+
+    dict = dictionary_new ((const DictEntry *) entries->data, entries->len);
+
+    g_string_free (key, TRUE);
+    g_array_free (entries, TRUE);
+    g_string_chunk_free (keys);
+
+    return dict;
+}
+
+DictMask*
+dict_mask_new (const DictTrie     *trie,
+               DictTrieAcceptFunc  accept,
+               gpointer            user_data)
+{
+    DictMask *mask;
+    GHashTable *values;
+    guint i;
+
+    mask = g_new (DictMask, 1);
+    mask->n_entries = trie->n_entries;
+    mask->bits = g_new0 (guint64, trie->n_entries / 64 + 1);
+
+    // Values are pool offsets, and many entries share one, e.g. a
+    // hanja with several readings. Each is only tested once.
+    values = g_hash_table_new (g_direct_hash, g_direct_equal);
+    for (i = 0; i < trie->n_entries; ++i) {
+        guint32 value = trie->entries[i * 2];
+        gpointer result;
+
+        if (!g_hash_table_lookup_extended (values, GUINT_TO_POINTER (value),
+                                           NULL, &result)) {
+            result = GINT_TO_POINTER (accept (trie->pool + value, user_data));
+            g_hash_table_insert (values, GUINT_TO_POINTER (value), result);
+        }
+
+        if (GPOINTER_TO_INT (result))
+            mask->bits[i / 64] |= G_GUINT64_CONSTANT (1) << (i % 64);
+    }
+    g_hash_table_destroy (values);
+
+    return mask;
+}
+
+void
+dict_mask_delete (DictMask *mask)
+{
+    if (mask == NULL)
+        return;
+
+    g_free (mask->bits);
+    g_free (mask);
+}
+
+static inline gboolean
+dict_mask_get (const DictMask *mask, guint entry)
+{
+    return mask == NULL || (mask->bits[entry / 64] >> (entry % 64)) & 1;
+}
+
+gboolean
+dict_trie_entry_visible (const DictTrie *trie,
+                         const DictMask *mask,
+                         guint           key_id,
+                         guint           n)
+{
+    return dict_mask_get (mask, trie->offsets[key_id] + n);
+}
+
+guint
+dict_trie_append_entries (const DictTrie *trie,
+                          const DictMask *mask,
+                          guint           key_id,
+                          const gchar    *key,
+                          guint           length,
+                          CandidateList  *list)
+{
+    guint first = trie->offsets[key_id];
+    guint last = trie->offsets[key_id + 1];
+    guint n = 0;
+    guint i;
+
+    // nothing is copied for a key without any entry to show
+    if (mask != NULL) {
+        for (i = first; i < last && !dict_mask_get (mask, i); ++i)
+            continue;
+        if (i == last)
+            return 0;
+    }
+
+    if (key == NULL) {
+        GString *str = g_string_new (NULL);
+
+        dict_trie_get_key (trie, key_id, str);
+        key = candidate_list_intern (list, str->str, str->len);
+        g_string_free (str, TRUE);
+    } else {
+        key = candidate_list_intern (list, key, -1);
+    }
+
+    for (i = first; i < last; ++i) {
+        if (!dict_mask_get (mask, i))
+            continue;
+        candidate_list_append (list, key,
+                               trie->pool + trie->entries[i * 2],
+                               trie->pool + trie->entries[i * 2 + 1],
+                               length);
+        n++;
+    }
+
+    return n;
+}
+
+guint
+dict_trie_find_prefixes (const DictTrie *trie,
+                         const gchar    *key,
+                         GArray         *key_ids,
+                         GArray         *lengths)
+{
+    GArray *matches;
+    gint node = 0;
+    guint depth;
+    guint i;
+
+    // (node, depth) of the keys on the way down
+    matches = g_array_new (FALSE, FALSE, sizeof (TrieFrame));
+    for (depth = 0; key[depth] != '\0'; ++depth) {
+        node = dict_trie_child (trie, node, key[depth]);
+        if (node < 0)
+            break;
+
+        if (bit_vector_get (&trie->terminal, node)) {
+            TrieFrame match = { node, depth + 1 };
+            g_array_append_val (matches, match);
+        }
+    }
+
+    for (i = matches->len; i > 0; --i) {
+        TrieFrame *match = &g_array_index (matches, TrieFrame, i - 1);
+        guint key_id = bit_vector_rank (&trie->terminal, match->node);
+        guint length = match->depth;
+
+        g_array_append_val (key_ids, key_id);
+        g_array_append_val (lengths, length);
+    }
+
+    i = matches->len;
+    g_array_free (matches, TRUE);
+
+    return i;
+}
+
+DictTrieSearch*
+dict_trie_search_new (const DictTrie *trie,
+                      const DictMask *mask,
+                      const gchar    *key)
+{
+    DictTrieSearch *search;
+
+    search = g_slice_new0 (DictTrieSearch);
+    search->trie = trie;
+    search->mask = mask;
+    search->key = g_strdup (key);
+    search->key_ids = g_array_new (FALSE, FALSE, sizeof (guint));
+    search->lengths = g_array_new (FALSE, FALSE, sizeof (guint));
+    search->total = -1;
+
+    // Finding the prefixes is a walk down the key, which is cheap. The
+    // entries are only looked at as they are taken.
+    dict_trie_find_prefixes (trie, key, search->key_ids, search->lengths);
+
+    return search;
+}
+
+void
+dict_trie_search_free (DictTrieSearch *search)
+{
+    if (search == NULL)
+        return;
+
+    g_array_free (search->key_ids, TRUE);
+    g_array_free (search->lengths, TRUE);
+    g_free (search->key);
+    g_slice_free (DictTrieSearch, search);
+}
+
+gboolean
+dict_trie_search_next_entry (DictTrieSearch *search,
+                             guint          *key_id,
+                             guint          *n,
+                             guint          *length)
+{
+    const DictTrie *trie = search->trie;
+
+    for (; search->i < search->key_ids->len; search->i++) {
+        guint id = g_array_index (search->key_ids, guint, search->i);
+        guint first = trie->offsets[id];
+        guint last = trie->offsets[id + 1];
+
+        for (; first + search->n < last; search->n++) {
+            if (dict_mask_get (search->mask, first + search->n))
+                break;
+        }
+
+        if (first + search->n < last) {
+            *key_id = id;
+            *n = search->n++;
+            *length = g_array_index (search->lengths, guint, search->i);
+            return TRUE;
+        }
+
+        search->n = 0;
+        search->prefix = NULL;
+    }
+
+    return FALSE;
+}
+
+guint
+dict_trie_search_next (DictTrieSearch *search,
+                       guint           limit,
+                       CandidateList  *list)
+{
+    guint key_id, n, length;
+    guint count = 0;
+
+    while (count < limit &&
+           dict_trie_search_next_entry (search, &key_id, &n, &length)) {
+        // the prefix is copied into the list once
+        if (search->prefix == NULL || search->prefix_list != list) {
+            search->prefix = candidate_list_intern (list, search->key,
+                                                    length);
+            search->prefix_list = list;
+            search->prefix_length = g_utf8_strlen (search->prefix, -1);
+        }
+
+        candidate_list_append (list, search->prefix,
+                               dict_trie_get_value (search->trie, key_id, n),
+                               dict_trie_get_comment (search->trie,
+                                                      key_id, n),
+                               search->prefix_length);
+        count++;
+    }
+
+    return count;
+}
+
+guint
+dict_trie_search_get_total (DictTrieSearch *search)
+{
+    const DictTrie *trie = search->trie;
+    guint total = 0;
+    guint i;
+
+    if (search->total >= 0)
+        return search->total;
+
+    for (i = 0; i < search->key_ids->len; ++i) {
+        guint id = g_array_index (search->key_ids, guint, i);
+        guint first = trie->offsets[id];
+        guint last = trie->offsets[id + 1];
+
+        if (search->mask == NULL) {
+            total += last - first;
+            continue;
+        }
+
+        // a word of the mask at a time
+        while (first < last) {
+            guint end = MIN (last, (first / 64 + 1) * 64);
+            guint64 word = search->mask->bits[first / 64] >> (first % 64);
+
+            if (end - first < 64)
+                word &= (G_GUINT64_CONSTANT (1) << (end - first)) - 1;
+            total += __builtin_popcountll (word);
+            first = end;
+        }
+    }
+
+    search->total = total;
+    return total;
+}
+
+guint
+dict_trie_match_prefix (const DictTrie *trie,
+                        const DictMask *mask,
+                        const gchar    *key,
+                        CandidateList  *list)
+{
+    GArray *key_ids;
+    GArray *lengths;
+    guint n = 0;
+    guint i;
+
+    key_ids = g_array_new (FALSE, FALSE, sizeof (guint));
+    lengths = g_array_new (FALSE, FALSE, sizeof (guint));
+    dict_trie_find_prefixes (trie, key, key_ids, lengths);
+
+    for (i = 0; i < key_ids->len; ++i) {
+        gchar *prefix = g_strndup (key, g_array_index (lengths, guint, i));
+
+        if (dict_trie_append_entries (trie, mask,
+                                      g_array_index (key_ids, guint, i),
+                                      prefix,
+                                      g_utf8_strlen (prefix, -1),
+                                      list) > 0)
+            n++;
+        g_free (prefix);
+    }
+
+    g_array_free (key_ids, TRUE);
+    g_array_free (lengths, TRUE);
+
+    return n;
+}
+
+guint
+dict_trie_complete (const DictTrie *trie,
+                    const DictMask *mask,
+                    const gchar    *prefix,
+                    guint           max_keys,
+                    CandidateList  *list)
+{
+    GArray *stack;
+    GString *key;
+    gint node = 0;
+    guint prefix_len;
+    guint length;
+    guint n = 0;
+    const gchar *p;
+
+    for (p = prefix; *p != '\0'; ++p) {
+        node = dict_trie_child (trie, node, *p);
+        if (node < 0)
+            return 0;
+    }
+
+    prefix_len = p - prefix;
+    length = g_utf8_strlen (prefix, -1);
+    key = g_string_new (prefix);
+
+    // depth first, the children pushed in reverse, gives sorted order
+    stack = g_array_new (FALSE, FALSE, sizeof (TrieFrame));
+    {
+        TrieFrame frame = { node, prefix_len };
+        g_array_append_val (stack, frame);
+    }
+
+    while (stack->len > 0 && n < max_keys) {
+        TrieFrame frame = g_array_index (stack, TrieFrame, stack->len - 1);
+        guint first;
+        guint last;
+
+        g_array_set_size (stack, stack->len - 1);
+
+        if (frame.depth > prefix_len) {
+            g_string_truncate (key, frame.depth - 1);
+            g_string_append_c (key, trie->labels[frame.node]);
+        }
+
+        if (bit_vector_get (&trie->terminal, frame.node) &&
+            dict_trie_append_entries (trie, mask,
+                                      bit_vector_rank (&trie->terminal,
+                                                       frame.node),
+                                      key->str, length, list) > 0)
+            n++;
+
+        first = dict_trie_first_child (trie, frame.node);
+        for (last = first; bit_vector_get (&trie->louds, last); ++last)
+            continue;
+
+        while (last > first) {
+            TrieFrame child;
+
+            last--;
+            child.node = last - frame.node - 1;
+            child.depth = frame.depth + 1;
+            g_array_append_val (stack, child);
+        }
+    }
+
+    g_array_free (stack, TRUE);
+    g_string_free (key, TRUE);
+
+    return n;
+}
@@ -0,0 +1,151 @@
+/* vim:set et sts=4: */
+#ifndef __DICT_TRIE_H__
+#define __DICT_TRIE_H__
+
+#include <glib.h>
+
+#include "dictionary.h"
+#include "candidate.h"
+
+/* DictTrie is the compact, read only form of a Dictionary that the
+ * engine keeps in memory. The keys are stored as a LOUDS trie, one byte
+ * per edge and about three bits of structure per node, so a reading is
+ * stored once however many words start with it. Values and comments are
+ * kept once each in a string pool, however often they occur.
+ *
+ * Every key has an id in [0, n_keys). Key strings are not stored as such;
+ * dict_trie_get_key() rebuilds them, and the search functions copy them
+ * into the CandidateList they fill. A DictTrie can be searched from
+ * several threads at once. */
+typedef struct _DictTrie DictTrie;
+
+/* DictMask marks the entries of a trie that may be shown, e.g. those
+ * made of the characters of a CharFilter. It is made once, so the
+ * search functions below skip the other entries without looking at
+ * their strings; a NULL mask lets every entry through. */
+typedef struct _DictMask DictMask;
+
+typedef gboolean (*DictTrieAcceptFunc) (const gchar *value,
+                                        gpointer     user_data);
+
+/* DictTrieSearch is dict_trie_match_prefix() made a few entries at a
+ * time. It only keeps where it stopped, so a search costs the entries
+ * taken from it, however many keys match: a one syllable reading can
+ * have hundreds of hanja, of which the user sees a page. */
+typedef struct _DictTrieSearch DictTrieSearch;
+
+/* The dictionary is not needed any more once the trie is built. */
+DictTrie*    dict_trie_new            (const Dictionary *dict);
+/* Builds the trie of a dictionary file, or returns NULL. */
+DictTrie*    dict_trie_load           (const gchar      *filename);
+void         dict_trie_delete         (DictTrie         *trie);
+/* Makes the Dictionary the trie was built from, e.g. to change it. */
+Dictionary*  dict_trie_to_dictionary  (const DictTrie   *trie);
+
+guint        dict_trie_get_n_keys     (const DictTrie   *trie);
+/* bytes of memory used by the trie */
+gsize        dict_trie_get_size       (const DictTrie   *trie);
+
+void         dict_trie_get_key        (const DictTrie   *trie,
+                                       guint             key_id,
+                                       GString          *key);
+/* Returns the id of key, or -1 if it is not in the trie. */
+gint         dict_trie_find_key       (const DictTrie   *trie,
+                                       const gchar      *key);
+
+/* Appends the ids of the keys that are a prefix of key to key_ids, and
+ * their lengths in bytes to lengths, longest first. Both are arrays of
+ * guint. Returns the number of keys. */
+guint        dict_trie_find_prefixes  (const DictTrie   *trie,
+                                       const gchar      *key,
+                                       GArray           *key_ids,
+                                       GArray           *lengths);
+
+/* Walking the trie a node at a time. Nodes are numbered in level order
+ * from the root, 0, so a node comes after its parent, and the children
+ * of a node come right after those of the node before it. Every node
+ * but the root has a parent and the byte of the edge from it. */
+guint        dict_trie_get_n_nodes    (const DictTrie   *trie);
+guint        dict_trie_get_parent     (const DictTrie   *trie,
+                                       guint             node);
+guint8       dict_trie_get_label      (const DictTrie   *trie,
+                                       guint             node);
+/* Returns the id of the key that ends at node, or -1. */
+gint         dict_trie_get_node_key   (const DictTrie   *trie,
+                                       guint             node);
+
+/* Entries of a key are in the order of the dictionary file. */
+guint        dict_trie_get_n_entries  (const DictTrie   *trie,
+                                       guint             key_id);
+const gchar* dict_trie_get_value      (const DictTrie   *trie,
+                                       guint             key_id,
+                                       guint             n);
+const gchar* dict_trie_get_comment    (const DictTrie   *trie,
+                                       guint             key_id,
+                                       guint             n);
+
+/* Marks the entries whose value accept takes. */
+DictMask*    dict_mask_new            (const DictTrie   *trie,
+                                       DictTrieAcceptFunc accept,
+                                       gpointer          user_data);
+void         dict_mask_delete         (DictMask         *mask);
+/* TRUE if entry n of key_id passes mask, which can be NULL */
+gboolean     dict_trie_entry_visible  (const DictTrie   *trie,
+                                       const DictMask   *mask,
+                                       guint             key_id,
+                                       guint             n);
+
+/* The search functions append only the entries that pass mask, and
+ * count only the keys that have any. */
+
+/* Appends the entries of key_id to list. key is the key string, or NULL
+ * to have it rebuilt; length is the candidates' length. Returns the
+ * number of entries appended. */
+guint        dict_trie_append_entries (const DictTrie   *trie,
+                                       const DictMask   *mask,
+                                       guint             key_id,
+                                       const gchar      *key,
+                                       guint             length,
+                                       CandidateList    *list);
+
+/* Starts a search for the entries of the keys that are a prefix of key,
+ * in the order of dict_trie_match_prefix(). trie and mask must outlive
+ * the search; key is copied. */
+DictTrieSearch* dict_trie_search_new  (const DictTrie   *trie,
+                                       const DictMask   *mask,
+                                       const gchar      *key);
+void         dict_trie_search_free    (DictTrieSearch   *search);
+/* Appends the next limit entries at most to list. Returns the number
+ * appended, which is less than limit at the end. */
+guint        dict_trie_search_next    (DictTrieSearch   *search,
+                                       guint             limit,
+                                       CandidateList    *list);
+/* Takes the next entry: entry n of key_id, whose key is the first
+ * length bytes of the search key. Returns FALSE at the end. */
+gboolean     dict_trie_search_next_entry
+                                      (DictTrieSearch   *search,
+                                       guint            *key_id,
+                                       guint            *n,
+                                       guint            *length);
+/* the number of entries of the whole search, taken or not. They are
+ * counted, not made, on the first call. */
+guint        dict_trie_search_get_total
+                                      (DictTrieSearch   *search);
+
+/* Appends the entries of every key that is a prefix of key, longest
+ * first, like hanja_table_match_prefix(). Returns the number of keys. */
+guint        dict_trie_match_prefix   (const DictTrie   *trie,
+                                       const DictMask   *mask,
+                                       const gchar      *key,
+                                       CandidateList    *list);
+
+/* Appends the entries of the first max_keys keys, in sorted order, that
+ * start with prefix. They replace the prefix. Returns the number of
+ * keys. */
+guint        dict_trie_complete       (const DictTrie   *trie,
+                                       const DictMask   *mask,
+                                       const gchar      *prefix,
+                                       guint             max_keys,
+                                       CandidateList    *list);
+
+#endif
@@ -5,12 +5,20 @@
 
 #include <ibus.h>
 #include <hangul.h>
+#include <glib/gstdio.h>
 #include <string.h>
 #include <ctype.h>
+#include <unistd.h>
 
 #include "i18n.h"
 #include "engine.h"
+#include "core.h"
+#include "composer.h"
+#include "eventlog.h"
+#include "keytrace.h"
+#include "layoutdetect.h"
 #include "ustring.h"
+#include "watchdog.h"
 
 
 typedef struct _IBusHangulEngine IBusHangulEngine;
@@ -20,14 +28,41 @@ struct _IBusHangulEngine {
     IBusEngine parent;
 
     /* members */
-    HangulInputContext *context;
-    UString* preedit;
+    Core *core;
+    /* FALSE while the keys go to the application as Latin letters */
     gboolean hangul_mode;
-    gboolean hanja_mode;
-    HanjaList* hanja_list;
+    GPtrArray* hanja_comments;
+    guint keyboard_index;
+
+    /* asynchronous hanja search */
+    volatile gint hanja_search_generation;
+
+    /* key event trace, NULL unless enabled */
+    KeyTrace *trace;
+    gchar *trace_file;
+
+    /* panel updates held back while keys come in a burst */
+    guint update_id;
+    gboolean preedit_pending;
+    /* the client shows a preedit string */
+    gboolean preedit_shown;
+    guint lookup_table_pending;
+
+    /* the word typed so far, to catch it typed in the wrong mode; NULL
+     * without a layout model */
+    LayoutDetector *layout;
+    /* characters of the word the application has got in Hangul mode */
+    guint layout_committed;
+    /* the key ended the word */
+    gboolean layout_word_end;
+    /* the word looks typed in the wrong mode: the mode it is for */
+    LayoutGuess layout_guess;
+    /* the lookup table offers the word in that mode */
+    gboolean layout_offer;
 
     IBusLookupTable *table;
 
+    IBusProperty    *prop_hangul_mode;
     IBusProperty    *prop_hanja_mode;
     IBusPropList    *prop_list;
 };
@@ -41,6 +76,48 @@ struct KeyEvent {
     guint modifiers;
 };
 
+/* what an update held back has to send of the lookup table */
+enum {
+    LOOKUP_TABLE_PENDING_NONE,
+    LOOKUP_TABLE_PENDING_CURSOR,
+    LOOKUP_TABLE_PENDING_ALL,
+};
+
+typedef struct _ConfigKey ConfigKey;
+
+struct _ConfigKey {
+    const gchar *section;
+    const gchar *name;
+    GType        type;
+    /* the value of an unset key, as kept in the snapshot; it is what
+     * ibus_hangul_init() sets up */
+    const gchar *default_value;
+};
+
+/* the parts of an engine that are expensive to build, see
+ * ibus_hangul_engine_init() */
+typedef struct _EngineState EngineState;
+
+struct _EngineState {
+    Core               *core;
+    IBusPropList       *prop_list;
+    IBusProperty       *prop_hangul_mode;
+    IBusProperty       *prop_hanja_mode;
+    IBusLookupTable    *table;
+};
+
+typedef struct _HanjaSearch HanjaSearch;
+
+struct _HanjaSearch {
+    IBusHangulEngine *hangul;
+    gint generation;
+    gchar *key;
+    /* those of the engine when the search was started */
+    CoreDicts *dicts;
+    CoreFilter *filter;
+    CandidateList *result;
+};
+
 /* functions prototype */
 static void     ibus_hangul_engine_class_init
                                             (IBusHangulEngineClass  *klass);
@@ -96,35 +173,208 @@ static void ibus_hangul_engine_candidate_clicked
                                              guint                   state);
 
 static void ibus_hangul_engine_flush        (IBusHangulEngine       *hangul);
+static void ibus_hangul_engine_clear_comments
+                                            (IBusHangulEngine       *hangul);
+static void ibus_hangul_engine_start_trace  (IBusHangulEngine       *hangul);
+static void ibus_hangul_engine_stop_trace   (IBusHangulEngine       *hangul);
 static void ibus_hangul_engine_update_preedit_text
                                             (IBusHangulEngine       *hangul);
+static void ibus_hangul_engine_send_updates (IBusHangulEngine       *hangul);
 
-static void ibus_hangul_engine_update_lookup_table
-                                            (IBusHangulEngine       *hangul);
+static void core_commit_cb                  (Core                   *core,
+                                             const ucschar          *str,
+                                             gpointer                user_data);
+static void core_update_preedit_cb          (Core                   *core,
+                                             const ucschar          *str,
+                                             guint                   n_fixed,
+                                             gpointer                user_data);
+static void core_end_preedit_cb             (Core                   *core,
+                                             const ucschar          *str,
+                                             gpointer                user_data);
+static void core_update_candidates_cb       (Core                   *core,
+                                             const CandidateList    *list,
+                                             gpointer                user_data);
+static void core_update_cursor_cb           (Core                   *core,
+                                             guint                   cursor,
+                                             gpointer                user_data);
+static void core_hide_candidates_cb         (Core                   *core,
+                                             gpointer                user_data);
+static void core_search_cb                  (Core                   *core,
+                                             const gchar            *key,
+                                             gpointer                user_data);
+static gboolean core_delete_text_cb         (Core                   *core,
+                                             guint                   n_chars,
+                                             gpointer                user_data);
+static void core_extend_candidates_cb       (Core                   *core,
+                                             const CandidateList    *list,
+                                             guint                   first,
+                                             gpointer                user_data);
 static void ibus_config_value_changed       (IBusConfig             *config,
                                              const gchar            *section,
                                              const gchar            *name,
                                              GValue                 *value,
                                              gpointer                user_data);
 
+static void     ibus_hangul_config_set_value(const gchar            *section,
+                                             const gchar            *name,
+                                             const GValue           *value);
+static void     config_snapshot_load        (void);
+static void     config_snapshot_save        (void);
+static gboolean config_fetch_all            (gpointer                user_data);
+static void     config_fetch_cancel         (guint                   i);
+
 static void        lookup_table_set_visible (IBusLookupTable        *table,
                                              gboolean                flag);
 static gboolean        lookup_table_is_visible
                                             (IBusLookupTable        *table);
 
+static void     engine_state_free           (EngineState            *state);
+
+static void     ibus_hangul_engine_register_properties
+                                            (IBusHangulEngine       *hangul);
+
 static void     key_event_list_set          (GArray                 *list,
                                              const gchar            *str);
 static gboolean key_event_list_match        (GArray                 *list,
                                              guint                   keyval,
                                              guint                   modifiers);
 
+static void     keyboard_list_set           (GPtrArray              *list,
+                                             const gchar            *str);
+
+static KeyTraceRedact trace_redact_from_string
+                                            (const gchar            *str);
+
+static void     hanja_search_func           (gpointer                data,
+                                             gpointer                user_data);
+static gboolean hanja_search_done           (gpointer                data);
+static void     dict_update_check           (void);
+static gpointer dict_update_func            (gpointer                data);
+static gboolean dict_update_done            (gpointer                data);
+static void     snippet_check               (void);
+static gpointer snippet_load_func           (gpointer                data);
+static gboolean snippet_load_done           (gpointer                data);
+
 static IBusEngineClass *parent_class = NULL;
-static HanjaTable *hanja_table = NULL;
-static HanjaTable *symbol_table = NULL;
+static CoreDicts  *dicts = NULL;
+/* the candidates shown, NULL for all of them */
+static CoreFilter *candidate_filter = NULL;
+static gchar      *candidate_filter_str = NULL;
+/* applies dictionary deltas in the background, NULL once done */
+static GThread    *dict_update_thread = NULL;
+/* of the user's delta directory and ours when they were read last */
+static time_t      dict_update_mtimes[2] = { 0, 0 };
+/* catches words typed in the wrong mode, NULL without a model */
+static LayoutModel *layout_model = NULL;
+static gboolean    layout_detect = TRUE;
+static gboolean    layout_auto_correct = FALSE;
+/* composes the keys of a word for an offer, on the main thread */
+static Composer   *layout_composer = NULL;
+/* the user's snippets, NULL for none */
+static SnippetTable *snippets = NULL;
+static gboolean    snippet_auto_commit = FALSE;
+static gchar      *snippet_file = NULL;
+/* reads snippet_file in the background, NULL once done */
+static GThread    *snippet_load_thread = NULL;
+/* of snippet_file when it was read last, to see it changed */
+static time_t      snippet_mtime = 0;
+static goffset     snippet_size = -1;
 static IBusConfig *config = NULL;
 static GString    *hangul_keyboard = NULL;
 static GArray     *hanja_keys = NULL;
+static GArray     *hangul_mode_keys = NULL;
+static GArray     *symbol_search_keys = NULL;
+static GPtrArray  *keyboard_list = NULL;
+static GString    *keyboard_list_str = NULL;
+static GArray     *switch_keyboard_keys = NULL;
+static GThreadPool *hanja_search_pool = NULL;
+static gboolean    trace_enabled = FALSE;
+static KeyTraceRedact trace_redact = KEY_TRACE_REDACT_NONE;
+static guint       trace_serial = 0;
+/* reports callbacks that hold up the main loop, NULL if disabled */
+static Watchdog   *watchdog = NULL;
+
+/* number of events kept in a trace, about 100KB */
+#define TRACE_CAPACITY  4096
+/* number of trace files kept, the newest; about 2MB at most */
+#define TRACE_MAX_FILES 20
 static int lookup_table_orientation = 0;
+static guint       update_delay = 0;
+static GList      *engine_list = NULL;
+static GSList     *engine_state_pool = NULL;
+static guint       engine_state_pool_length = 0;
+static guint       engine_state_pool_size = 16;
+static IBusText   *hangul_mode_label = NULL;
+static IBusText   *hangul_mode_tooltip = NULL;
+static IBusText   *hanja_mode_label = NULL;
+static IBusText   *hanja_mode_tooltip = NULL;
+static IBusProperty *prop_setup = NULL;
+/* what the panel was last told about the properties */
+static IBusHangulEngine *panel_engine = NULL;
+static guint       panel_n_registrations = 0;
+static gboolean    panel_hangul_mode = TRUE;
+static gboolean    panel_hanja_mode = FALSE;
+/* the property lists, by hanja mode and Latin mode */
+static IBusMessage *prop_list_messages[4] = { NULL, };
+
+/* how the engines hear from their Core */
+static const CoreCallbacks core_callbacks = {
+    core_commit_cb,
+    core_update_preedit_cb,
+    core_end_preedit_cb,
+    core_update_candidates_cb,
+    core_update_cursor_cb,
+    core_hide_candidates_cb,
+    core_search_cb,
+    core_delete_text_cb,
+    core_extend_candidates_cb,
+};
+
+/* every config key the engine uses */
+static const ConfigKey config_keys[] = {
+    { "engine/Hangul", "HangulKeyboard",           G_TYPE_STRING,
+      "2" },
+    { "engine/Hangul", "HangulKeyboardList",       G_TYPE_STRING,
+      "" },
+    { "engine/Hangul", "HanjaKeys",                G_TYPE_STRING,
+      "Hangul_Hanja,F9" },
+    // Shift+space still types a space; "Hangul,Shift+space" opts in
+    { "engine/Hangul", "HangulModeKeys",           G_TYPE_STRING,
+      "Hangul" },
+    // Shift+F9 stays the application's; "Shift+Hangul_Hanja,Shift+F9"
+    // opts in
+    { "engine/Hangul", "SymbolSearchKeys",         G_TYPE_STRING,
+      "Shift+Hangul_Hanja" },
+    { "engine/Hangul", "SwitchKeyboardKeys",       G_TYPE_STRING,
+      "Control+Hangul" },
+    { "engine/Hangul", "TraceKeyEvents",           G_TYPE_BOOLEAN,
+      "false" },
+    { "engine/Hangul", "TraceRedact",              G_TYPE_STRING,
+      "none" },
+    { "engine/Hangul", "UpdateDelay",              G_TYPE_INT,
+      "0" },
+    { "engine/Hangul", "FastPath",                 G_TYPE_BOOLEAN,
+      "false" },
+    { "engine/Hangul", "StallThreshold",           G_TYPE_INT,
+      "0" },
+    { "engine/Hangul", "CandidateFilter",          G_TYPE_STRING,
+      "none" },
+    { "engine/Hangul", "SnippetAutoCommit",        G_TYPE_BOOLEAN,
+      "false" },
+    { "engine/Hangul", "LayoutDetect",             G_TYPE_BOOLEAN,
+      "true" },
+    { "engine/Hangul", "LayoutAutoCorrect",        G_TYPE_BOOLEAN,
+      "false" },
+    { "panel",         "lookup_table_orientation", G_TYPE_INT,
+      "0" },
+};
+static GKeyFile   *config_snapshot = NULL;
+static gchar      *config_snapshot_file = NULL;
+static gboolean    config_snapshot_dirty = FALSE;
+static guint       config_fetch_id = 0;
+/* the GetValue calls in flight, by key, see config_fetch_all() */
+static IBusPendingCall *config_fetch_calls[G_N_ELEMENTS (config_keys)];
+static guint       config_fetch_n_pending = 0;
 
 GType
 ibus_hangul_engine_get_type (void)
@@ -156,60 +406,205 @@ ibus_hangul_engine_get_type (void)
 void
 ibus_hangul_init (IBusBus *bus)
 {
-    gboolean res;
-    GValue value = { 0, };
+    gchar *user_file;
+
+    // The user's own words are merged with the system dictionary.
+    user_file = g_build_filename (g_get_user_config_dir (), "ibus-hangul",
+                                  "hanja.txt", NULL);
+    dicts = core_dicts_load (LIBHANGUL_HANJA_FILE, user_file,
+                             IBUSHANGUL_DATADIR "/data/symbol.txt");
+    g_free (user_file);
+    dict_update_check ();
+
+    snippet_file = g_build_filename (g_get_user_config_dir (), "ibus-hangul",
+                                     "snippets.txt", NULL);
+    snippet_check ();
+
+    // Words typed in the wrong mode are caught with this model, if one
+    // was made; see layoutdetect.h.
+    layout_model = layout_model_load (IBUSHANGUL_DATADIR
+                                      "/data/layout.model");
+
+    // Dictionary searches run in worker threads, so a slow lookup in a big
+    // dictionary does not hold up the key events behind it. If no thread
+    // can be created, the search is done in place as before.
+    hanja_search_pool = g_thread_pool_new (hanja_search_func, NULL,
+                                           2, FALSE, NULL);
 
-    hanja_table = hanja_table_load (NULL);
+    hangul_keyboard = g_string_new_len ("2", 8);
 
-    symbol_table = hanja_table_load (IBUSHANGUL_DATADIR "/data/symbol.txt");
+    keyboard_list = g_ptr_array_new ();
+    keyboard_list_str = g_string_new ("");
+    keyboard_list_set (keyboard_list, keyboard_list_str->str);
 
-    config = ibus_bus_get_config (bus);
-    if (config)
+    hanja_keys = g_array_sized_new(FALSE, TRUE, sizeof(struct KeyEvent), 4);
+    key_event_list_set(hanja_keys, "Hangul_Hanja,F9");
+
+    hangul_mode_keys = g_array_sized_new(FALSE, TRUE,
+                                         sizeof(struct KeyEvent), 2);
+    key_event_list_set(hangul_mode_keys, "Hangul");
+
+    symbol_search_keys = g_array_sized_new(FALSE, TRUE,
+                                           sizeof(struct KeyEvent), 2);
+    key_event_list_set(symbol_search_keys, "Shift+Hangul_Hanja");
+
+    switch_keyboard_keys = g_array_sized_new(FALSE, TRUE,
+                                             sizeof(struct KeyEvent), 1);
+    key_event_list_set(switch_keyboard_keys, "Control+Hangul");
+
+    // Start with the settings of the last session, so no engine has to
+    // wait for the config service. The real values are fetched once the
+    // main loop runs, and any difference is applied then.
+    config_snapshot_load ();
+
+    // The bus is NULL when the engine is run offline, e.g. to replay
+    // a key trace. The default settings are used then.
+    if (bus != NULL)
+        config = ibus_bus_get_config (bus);
+    if (config) {
         g_object_ref_sink (config);
+        g_signal_connect (config, "value-changed",
+                          G_CALLBACK(ibus_config_value_changed), NULL);
+        config_fetch_id = g_idle_add (config_fetch_all, NULL);
+    }
+}
 
-    hangul_keyboard = g_string_new_len ("2", 8);
-    res = ibus_config_get_value (config, "engine/Hangul",
-                                         "HangulKeyboard", &value);
-    if (res) {
-        const gchar* str = g_value_get_string (&value);
-        g_string_assign (hangul_keyboard, str);
-        g_value_unset(&value);
+void
+ibus_hangul_exit (void)
+{
+    guint i;
+
+    if (dict_update_thread != NULL) {
+        core_dicts_unref (g_thread_join (dict_update_thread));
+        dict_update_thread = NULL;
+        g_idle_remove_by_data (&dict_update_thread);
     }
 
-    hanja_keys = g_array_sized_new(FALSE, TRUE, sizeof(struct KeyEvent), 4);
-    res = ibus_config_get_value (config, "engine/Hangul",
-                                         "HanjaKeys", &value);
-    if (res) {
-        const gchar* str = g_value_get_string (&value);
-        key_event_list_set(hanja_keys, str);
-        g_value_unset(&value);
-    } else {
-        struct KeyEvent ev;
+    if (snippet_load_thread != NULL) {
+        snippet_table_unref (g_thread_join (snippet_load_thread));
+        snippet_load_thread = NULL;
+        g_idle_remove_by_data (&snippet_load_thread);
+    }
 
-        ev.keyval = IBUS_Hangul_Hanja;
-        ev.modifiers = 0;
-        g_array_append_val(hanja_keys, ev);
+    if (hanja_search_pool != NULL) {
+        g_thread_pool_free (hanja_search_pool, TRUE, TRUE);
+        hanja_search_pool = NULL;
+    }
 
-        ev.keyval = IBUS_F9;
-        ev.modifiers = 0;
-        g_array_append_val(hanja_keys, ev);
+    if (config_fetch_id != 0) {
+        g_source_remove (config_fetch_id);
+        config_fetch_id = 0;
     }
-}
 
-void
-ibus_hangul_exit (void)
-{
-    hanja_table_delete (hanja_table);
-    hanja_table = NULL;
+    for (i = 0; i < G_N_ELEMENTS (config_keys); i++)
+        config_fetch_cancel (i);
+
+    if (config != NULL) {
+        g_signal_handlers_disconnect_by_func (config,
+                                    G_CALLBACK(ibus_config_value_changed),
+                                    NULL);
+        g_object_unref (config);
+        config = NULL;
+    }
+
+    config_snapshot_save ();
+    g_key_file_free (config_snapshot);
+    config_snapshot = NULL;
+    g_free (config_snapshot_file);
+    config_snapshot_file = NULL;
+
+    g_array_free (hanja_keys, TRUE);
+    hanja_keys = NULL;
+
+    g_array_free (hangul_mode_keys, TRUE);
+    hangul_mode_keys = NULL;
+
+    g_array_free (symbol_search_keys, TRUE);
+    symbol_search_keys = NULL;
+
+    ibus_hangul_engine_set_pool_size (0);
+    if (layout_composer != NULL) {
+        composer_delete (layout_composer);
+        layout_composer = NULL;
+    }
+    composer_cleanup ();
+
+    layout_model_delete (layout_model);
+    layout_model = NULL;
 
-    hanja_table_delete (symbol_table);
-    symbol_table = NULL;
+    watchdog_log_histogram (watchdog);
+    watchdog_delete (watchdog);
+    watchdog = NULL;
 
-    g_object_unref (config);
-    config = NULL;
+    core_filter_unref (candidate_filter);
+    candidate_filter = NULL;
+    g_free (candidate_filter_str);
+    candidate_filter_str = NULL;
+
+    core_dicts_unref (dicts);
+    dicts = NULL;
+
+    snippet_table_unref (snippets);
+    snippets = NULL;
+    g_free (snippet_file);
+    snippet_file = NULL;
+
+    for (i = 0; i < G_N_ELEMENTS (prop_list_messages); i++) {
+        if (prop_list_messages[i] != NULL) {
+            ibus_message_unref (prop_list_messages[i]);
+            prop_list_messages[i] = NULL;
+        }
+    }
+
+    if (prop_setup != NULL) {
+        g_object_unref (prop_setup);
+        prop_setup = NULL;
+    }
+
+    if (hanja_mode_label != NULL) {
+        g_object_unref (hangul_mode_label);
+        hangul_mode_label = NULL;
+        g_object_unref (hangul_mode_tooltip);
+        hangul_mode_tooltip = NULL;
+        g_object_unref (hanja_mode_label);
+        hanja_mode_label = NULL;
+        g_object_unref (hanja_mode_tooltip);
+        hanja_mode_tooltip = NULL;
+    }
 
     g_string_free (hangul_keyboard, TRUE);
     hangul_keyboard = NULL;
+
+    g_ptr_array_foreach (keyboard_list, (GFunc) g_free, NULL);
+    g_ptr_array_free (keyboard_list, TRUE);
+    keyboard_list = NULL;
+
+    g_string_free (keyboard_list_str, TRUE);
+    keyboard_list_str = NULL;
+
+    g_array_free (switch_keyboard_keys, TRUE);
+    switch_keyboard_keys = NULL;
+}
+
+guint
+ibus_hangul_engine_get_n_registrations (void)
+{
+    return panel_n_registrations;
+}
+
+void
+ibus_hangul_engine_set_pool_size (guint size)
+{
+    engine_state_pool_size = size;
+
+    while (engine_state_pool_length > engine_state_pool_size) {
+        EngineState *state = engine_state_pool->data;
+
+        engine_state_pool = g_slist_delete_link (engine_state_pool,
+                                                 engine_state_pool);
+        engine_state_pool_length--;
+        engine_state_free (state);
+    }
 }
 
 static void
@@ -244,49 +639,141 @@ ibus_hangul_engine_class_init (IBusHangulEngineClass *klass)
     engine_class->candidate_clicked = ibus_hangul_engine_candidate_clicked;
 }
 
+static EngineState*
+engine_state_new (void)
+{
+    EngineState *state;
+
+    // The labels are translated and built once, and shared by the
+    // mode properties of all engines. The setup property has no state
+    // at all, so every prop list holds the same object.
+    if (hanja_mode_label == NULL) {
+        hangul_mode_label = ibus_text_new_from_string (_("Hangul"));
+        g_object_ref_sink (hangul_mode_label);
+        hangul_mode_tooltip =
+            ibus_text_new_from_string (_("Switch between Hangul and Latin"));
+        g_object_ref_sink (hangul_mode_tooltip);
+        hanja_mode_label = ibus_text_new_from_string (_("Hanja lock"));
+        g_object_ref_sink (hanja_mode_label);
+        hanja_mode_tooltip =
+            ibus_text_new_from_string (_("Enable/Disable Hanja mode"));
+        g_object_ref_sink (hanja_mode_tooltip);
+    }
+
+    if (prop_setup == NULL) {
+        IBusText* label;
+        IBusText* tooltip;
+
+        label = ibus_text_new_from_string (_("Setup"));
+        tooltip = ibus_text_new_from_string (_("Configure hangul engine"));
+        prop_setup = ibus_property_new ("setup",
+                                        PROP_TYPE_NORMAL,
+                                        label,
+                                        "gtk-preferences",
+                                        tooltip,
+                                        TRUE, TRUE, PROP_STATE_UNCHECKED,
+                                        NULL);
+        g_object_ref_sink (prop_setup);
+    }
+
+    state = g_slice_new (EngineState);
+    state->core = core_new (dicts, hangul_keyboard->str);
+
+    state->prop_list = ibus_prop_list_new ();
+    g_object_ref_sink (state->prop_list);
+
+    state->prop_hangul_mode = ibus_property_new ("hangul_mode",
+                                                 PROP_TYPE_TOGGLE,
+                                                 hangul_mode_label,
+                                                 NULL,
+                                                 hangul_mode_tooltip,
+                                                 TRUE, TRUE,
+                                                 PROP_STATE_CHECKED, NULL);
+    g_object_ref_sink (state->prop_hangul_mode);
+    ibus_prop_list_append (state->prop_list, state->prop_hangul_mode);
+
+    state->prop_hanja_mode = ibus_property_new ("hanja_mode",
+                                                PROP_TYPE_TOGGLE,
+                                                hanja_mode_label,
+                                                NULL,
+                                                hanja_mode_tooltip,
+                                                TRUE, TRUE,
+                                                PROP_STATE_UNCHECKED, NULL);
+    g_object_ref_sink (state->prop_hanja_mode);
+    ibus_prop_list_append (state->prop_list, state->prop_hanja_mode);
+    ibus_prop_list_append (state->prop_list, prop_setup);
+
+    state->table = ibus_lookup_table_new (9, 0, TRUE, FALSE);
+    g_object_ref_sink (state->table);
+
+    return state;
+}
+
+static void
+engine_state_free (EngineState *state)
+{
+    g_object_unref (state->prop_hangul_mode);
+    g_object_unref (state->prop_hanja_mode);
+    g_object_unref (state->prop_list);
+    g_object_unref (state->table);
+    core_delete (state->core);
+    g_slice_free (EngineState, state);
+}
+
 static void
 ibus_hangul_engine_init (IBusHangulEngine *hangul)
 {
-    IBusProperty* prop;
-    IBusText* label;
-    IBusText* tooltip;
+    EngineState *state;
+
+    // Input contexts come and go all the time in browsers and
+    // terminals, so the state of destroyed engines is kept for reuse.
+    if (engine_state_pool != NULL) {
+        state = engine_state_pool->data;
+        engine_state_pool = g_slist_delete_link (engine_state_pool,
+                                                 engine_state_pool);
+        engine_state_pool_length--;
+        core_select_keyboard (state->core, hangul_keyboard->str);
+    } else {
+        state = engine_state_new ();
+    }
 
-    hangul->context = hangul_ic_new (hangul_keyboard->str);
-    hangul->preedit = ustring_new();
-    hangul->hanja_list = NULL;
+    hangul->core = state->core;
+    hangul->prop_list = state->prop_list;
+    hangul->prop_hangul_mode = state->prop_hangul_mode;
+    hangul->prop_hanja_mode = state->prop_hanja_mode;
+    hangul->table = state->table;
+    g_slice_free (EngineState, state);
+
+    core_set_callbacks (hangul->core, &core_callbacks, hangul);
+    core_set_vertical (hangul->core, lookup_table_orientation != 0);
+    core_set_filter (hangul->core, candidate_filter);
+    // pooled states may have the snippets that were replaced since
+    core_set_snippets (hangul->core, snippets, snippet_auto_commit);
+
+    hangul->hanja_comments = NULL;
+    hangul->keyboard_index = 0;
+    hangul->hanja_search_generation = 0;
     hangul->hangul_mode = TRUE;
-    hangul->hanja_mode = FALSE;
-
-    hangul->prop_list = ibus_prop_list_new ();
-    g_object_ref_sink (hangul->prop_list);
-
-    label = ibus_text_new_from_string (_("Hanja lock"));
-    tooltip = ibus_text_new_from_string (_("Enable/Disable Hanja mode"));
-    prop = ibus_property_new ("hanja_mode",
-                              PROP_TYPE_TOGGLE,
-                              label,
-                              NULL,
-                              tooltip,
-                              TRUE, TRUE, PROP_STATE_UNCHECKED, NULL);
-    g_object_ref_sink (prop);
-    ibus_prop_list_append (hangul->prop_list, prop);
-    hangul->prop_hanja_mode = prop;
-
-    label = ibus_text_new_from_string (_("Setup"));
-    tooltip = ibus_text_new_from_string (_("Configure hangul engine"));
-    prop = ibus_property_new ("setup",
-                              PROP_TYPE_NORMAL,
-                              label,
-                              "gtk-preferences",
-                              tooltip,
-                              TRUE, TRUE, PROP_STATE_UNCHECKED, NULL);
-    ibus_prop_list_append (hangul->prop_list, prop);
-
-    hangul->table = ibus_lookup_table_new (9, 0, TRUE, FALSE);
-    g_object_ref_sink (hangul->table);
-
-    g_signal_connect (config, "value-changed",
-                      G_CALLBACK(ibus_config_value_changed), hangul);
+
+    hangul->trace = NULL;
+    hangul->trace_file = NULL;
+    if (trace_enabled)
+        ibus_hangul_engine_start_trace (hangul);
+
+    hangul->update_id = 0;
+    hangul->preedit_pending = FALSE;
+    hangul->preedit_shown = FALSE;
+    hangul->lookup_table_pending = LOOKUP_TABLE_PENDING_NONE;
+
+    hangul->layout = NULL;
+    if (layout_model != NULL)
+        hangul->layout = layout_detector_new (layout_model);
+    hangul->layout_committed = 0;
+    hangul->layout_word_end = FALSE;
+    hangul->layout_guess = LAYOUT_UNSURE;
+    hangul->layout_offer = FALSE;
+
+    engine_list = g_list_prepend (engine_list, hangul);
 }
 
 static GObject*
@@ -307,50 +794,78 @@ ibus_hangul_engine_constructor (GType                   type,
 static void
 ibus_hangul_engine_destroy (IBusHangulEngine *hangul)
 {
-    if (hangul->prop_hanja_mode) {
-        g_object_unref (hangul->prop_hanja_mode);
-        hangul->prop_hanja_mode = NULL;
+    // Drop the results of searches still in flight.
+    g_atomic_int_inc (&hangul->hanja_search_generation);
+
+    ibus_hangul_engine_clear_comments (hangul);
+
+    if (hangul->update_id != 0) {
+        g_source_remove (hangul->update_id);
+        hangul->update_id = 0;
     }
 
-    if (hangul->prop_list) {
-        g_object_unref (hangul->prop_list);
-        hangul->prop_list = NULL;
+    if (hangul->layout != NULL) {
+        layout_detector_delete (hangul->layout);
+        hangul->layout = NULL;
     }
 
-    if (hangul->table) {
-        g_object_unref (hangul->table);
+    if (hangul->core) {
+        EngineState *state = g_slice_new (EngineState);
+
+        state->core = hangul->core;
+        state->prop_list = hangul->prop_list;
+        state->prop_hangul_mode = hangul->prop_hangul_mode;
+        state->prop_hanja_mode = hangul->prop_hanja_mode;
+        state->table = hangul->table;
+
+        if (engine_state_pool_length < engine_state_pool_size) {
+            core_reset (state->core);
+            core_set_callbacks (state->core, NULL, NULL);
+            ibus_lookup_table_clear (state->table);
+            lookup_table_set_visible (state->table, FALSE);
+            state->prop_hangul_mode->state = PROP_STATE_CHECKED;
+            state->prop_hanja_mode->state = PROP_STATE_UNCHECKED;
+
+            engine_state_pool = g_slist_prepend (engine_state_pool, state);
+            engine_state_pool_length++;
+        } else {
+            engine_state_free (state);
+        }
+
+        hangul->core = NULL;
+        hangul->prop_list = NULL;
+        hangul->prop_hangul_mode = NULL;
+        hangul->prop_hanja_mode = NULL;
         hangul->table = NULL;
     }
 
-    if (hangul->context) {
-        hangul_ic_delete (hangul->context);
-        hangul->context = NULL;
-    }
+    ibus_hangul_engine_stop_trace (hangul);
+
+    if (panel_engine == hangul)
+        panel_engine = NULL;
+
+    engine_list = g_list_remove (engine_list, hangul);
 
     IBUS_OBJECT_CLASS (parent_class)->destroy ((IBusObject *)hangul);
 }
 
 static void
-ibus_hangul_engine_update_preedit_text (IBusHangulEngine *hangul)
+ibus_hangul_engine_send_preedit_text (IBusHangulEngine *hangul)
 {
-    const ucschar *hic_preedit;
+    const ucschar *preedit;
     IBusText *text;
-    UString *preedit;
-    gint preedit_len;
-
-    // ibus-hangul's preedit string is made up of ibus context's
-    // internal preedit string and libhangul's preedit string.
-    // libhangul only supports one syllable preedit string.
-    // In order to make longer preedit string, ibus-hangul maintains
-    // internal preedit string.
-    hic_preedit = hangul_ic_get_preedit_string (hangul->context);
-
-    preedit = ustring_dup (hangul->preedit);
-    preedit_len = ustring_length(preedit);
-    ustring_append_ucs4 (preedit, hic_preedit, -1);
-
-    if (ustring_length(preedit) > 0) {
-        text = ibus_text_new_from_ucs4 ((gunichar*)preedit->data);
+    guint preedit_len;
+
+    // The first part of the preedit string is the text composed so far
+    // in hanja mode; the rest is the syllable libhangul is composing.
+    // whatever was held back, this is the current one
+    hangul->preedit_pending = FALSE;
+
+    preedit = core_get_preedit (hangul->core, &preedit_len);
+    hangul->preedit_shown = preedit[0] != 0;
+
+    if (preedit[0] != 0) {
+        text = ibus_text_new_from_ucs4 ((gunichar*)preedit);
         // ibus-hangul's internal preedit string
         ibus_text_append_attribute (text, IBUS_ATTR_TYPE_UNDERLINE,
                 IBUS_ATTR_UNDERLINE_SINGLE, 0, preedit_len);
@@ -360,294 +875,837 @@ ibus_hangul_engine_update_preedit_text (IBusHangulEngine *hangul)
                 0x00ffffff, preedit_len, -1);
         ibus_text_append_attribute (text, IBUS_ATTR_TYPE_BACKGROUND,
                 0x00000000, preedit_len, -1);
+        event_log_add (EVENT_PREEDIT, ibus_text_get_length (text),
+                       preedit_len, 0);
         ibus_engine_update_preedit_text_with_mode ((IBusEngine *)hangul,
                                                    text,
                                                    ibus_text_get_length (text),
                                                    TRUE,
                                                    IBUS_ENGINE_PREEDIT_COMMIT);
     } else {
+        event_log_add (EVENT_PREEDIT, 0, 0, 0);
         text = ibus_text_new_from_static_string ("");
         ibus_engine_update_preedit_text ((IBusEngine *)hangul, text, 0, FALSE);
     }
+}
+
+static void
+ibus_hangul_engine_clear_comments (IBusHangulEngine *hangul)
+{
+    if (hangul->hanja_comments != NULL) {
+        g_ptr_array_foreach (hangul->hanja_comments,
+                             (GFunc) g_object_unref, NULL);
+        g_ptr_array_free (hangul->hanja_comments, TRUE);
+        hangul->hanja_comments = NULL;
+    }
+}
+
+static IBusText*
+ibus_hangul_engine_get_comment_text (IBusHangulEngine *hangul, guint pos)
+{
+    const CandidateList *list;
+    IBusText *text;
+    guint page_size;
+    guint start, end;
+    guint i, n;
+
+    // The comment texts are built one page at a time, when the cursor
+    // first enters the page, and are kept until the list changes.
+    // Moving the cursor afterwards costs no allocation.
+    list = core_get_candidates (hangul->core);
+    n = list != NULL ? candidate_list_get_size (list) : 0;
+    if (pos >= n)
+        return NULL;
+
+    if (hangul->hanja_comments == NULL) {
+        hangul->hanja_comments = g_ptr_array_sized_new (n);
+        g_ptr_array_set_size (hangul->hanja_comments, n);
+    }
+
+    text = g_ptr_array_index (hangul->hanja_comments, pos);
+    if (text != NULL)
+        return text;
+
+    page_size = ibus_lookup_table_get_page_size (hangul->table);
+    start = pos - pos % page_size;
+    end = MIN (start + page_size, n);
+    for (i = start; i < end; i++) {
+        const char* comment;
+
+        comment = candidate_list_get_nth_comment (list, i);
+        text = ibus_text_new_from_string (comment);
+        g_object_ref_sink (text);
+        g_ptr_array_index (hangul->hanja_comments, i) = text;
+    }
 
-    ustring_delete(preedit);
+    return g_ptr_array_index (hangul->hanja_comments, pos);
 }
 
 static void
-ibus_hangul_engine_update_lookup_table_ui (IBusHangulEngine *hangul)
+ibus_hangul_engine_update_auxiliary_text (IBusHangulEngine *hangul)
 {
     guint cursor_pos;
-    const char* comment;
     IBusText* text;
 
-    // update aux text
     cursor_pos = ibus_lookup_table_get_cursor_pos (hangul->table);
-    comment = hanja_list_get_nth_comment (hangul->hanja_list, cursor_pos);
+    text = ibus_hangul_engine_get_comment_text (hangul, cursor_pos);
+    if (text != NULL)
+        ibus_engine_update_auxiliary_text ((IBusEngine *)hangul, text, TRUE);
+}
+
+static void
+ibus_hangul_engine_send_lookup_table (IBusHangulEngine *hangul)
+{
+    event_log_add (EVENT_LOOKUP_TABLE,
+                   ibus_lookup_table_get_number_of_candidates (hangul->table),
+                   ibus_lookup_table_get_cursor_pos (hangul->table), 0);
 
-    text = ibus_text_new_from_string (comment);
-    ibus_engine_update_auxiliary_text ((IBusEngine *)hangul, text, TRUE);
+    // update aux text
+    ibus_hangul_engine_update_auxiliary_text (hangul);
 
     // update lookup table
     ibus_engine_update_lookup_table ((IBusEngine *)hangul, hangul->table, TRUE);
 }
 
 static void
-ibus_hangul_engine_commit_current_candidate (IBusHangulEngine *hangul)
+ibus_hangul_engine_send_lookup_table_cursor (IBusHangulEngine *hangul)
 {
-    guint cursor_pos;
-    const char* key;
-    const char* value;
-    int key_len;
-    int preedit_len;
-    int len;
+    // Only the cursor or the page has changed. The panel already has
+    // the candidates, so the fast variant sends just the visible page
+    // instead of the whole table.
+    event_log_add (EVENT_LOOKUP_CURSOR,
+                   ibus_lookup_table_get_cursor_pos (hangul->table), 0, 0);
+    ibus_hangul_engine_update_auxiliary_text (hangul);
+    ibus_engine_update_lookup_table_fast ((IBusEngine *)hangul,
+                                          hangul->table, TRUE);
+}
 
-    IBusText* text;
+static gboolean
+ibus_hangul_engine_send_updates_cb (gpointer data)
+{
+    IBusHangulEngine *hangul = (IBusHangulEngine *) data;
 
-    cursor_pos = ibus_lookup_table_get_cursor_pos (hangul->table);
-    key = hanja_list_get_nth_key (hangul->hanja_list, cursor_pos);
-    value = hanja_list_get_nth_value (hangul->hanja_list, cursor_pos);
+    hangul->update_id = 0;
+    ibus_hangul_engine_send_updates (hangul);
+
+    return FALSE;
+}
 
-    key_len = g_utf8_strlen(key, -1);
-    preedit_len = ustring_length(hangul->preedit);
+/* Sends the preedit and lookup table updates held back, if any. They
+ * are computed from the current state, so only the last state of a
+ * burst of keys reaches the panel. */
+static void
+ibus_hangul_engine_send_updates (IBusHangulEngine *hangul)
+{
+    if (hangul->update_id != 0) {
+        g_source_remove (hangul->update_id);
+        hangul->update_id = 0;
+    }
 
-    len = MIN(key_len, preedit_len);
-    ustring_erase (hangul->preedit, 0, len);
-    if (key_len > preedit_len)
-        hangul_ic_reset (hangul->context);
+    if (hangul->preedit_pending)
+        ibus_hangul_engine_send_preedit_text (hangul);
 
-    ibus_hangul_engine_update_preedit_text (hangul);
+    if (core_get_candidates (hangul->core) == NULL)
+        hangul->lookup_table_pending = LOOKUP_TABLE_PENDING_NONE;
 
-    text = ibus_text_new_from_string (value);
-    ibus_engine_commit_text ((IBusEngine *)hangul, text);
+    switch (hangul->lookup_table_pending) {
+    case LOOKUP_TABLE_PENDING_ALL:
+        ibus_hangul_engine_send_lookup_table (hangul);
+        break;
+    case LOOKUP_TABLE_PENDING_CURSOR:
+        ibus_hangul_engine_send_lookup_table_cursor (hangul);
+        break;
+    }
+    hangul->lookup_table_pending = LOOKUP_TABLE_PENDING_NONE;
 }
 
 static void
-ibus_hangul_engine_update_hanja_list (IBusHangulEngine *hangul)
+ibus_hangul_engine_schedule_updates (IBusHangulEngine *hangul)
 {
-    char* utf8;
-    const ucschar* hic_preedit;
-    UString* preedit;
+    if (hangul->update_id != 0)
+        return;
+
+    // Under a millisecond, wait only for the events that are already
+    // queued: an idle source runs once the bus has nothing more for us.
+    if (update_delay < 1000)
+        hangul->update_id = g_idle_add (ibus_hangul_engine_send_updates_cb,
+                                        hangul);
+    else
+        hangul->update_id = g_timeout_add (update_delay / 1000,
+                                           ibus_hangul_engine_send_updates_cb,
+                                           hangul);
+}
 
-    if (hangul->hanja_list != NULL) {
-        hanja_list_delete (hangul->hanja_list);
-        hangul->hanja_list = NULL;
+static void
+ibus_hangul_engine_update_preedit_text (IBusHangulEngine *hangul)
+{
+    if (update_delay == 0) {
+        ibus_hangul_engine_send_preedit_text (hangul);
+        return;
     }
 
-    hic_preedit = hangul_ic_get_preedit_string (hangul->context);
+    hangul->preedit_pending = TRUE;
+    ibus_hangul_engine_schedule_updates (hangul);
+}
 
-    preedit = ustring_dup (hangul->preedit);
-    ustring_append_ucs4 (preedit, hic_preedit, -1);
-    if (ustring_length(preedit) > 0) {
-        utf8 = ustring_to_utf8 (preedit, -1);
-        if (utf8 != NULL) {
-            if (symbol_table != NULL)
-                hangul->hanja_list = hanja_table_match_prefix (symbol_table, utf8);
-            if (hangul->hanja_list == NULL)
-                hangul->hanja_list = hanja_table_match_prefix (hanja_table, utf8);
-            g_free (utf8);
-        }
+static void
+ibus_hangul_engine_update_lookup_table_ui (IBusHangulEngine *hangul)
+{
+    if (update_delay == 0) {
+        ibus_hangul_engine_send_lookup_table (hangul);
+        return;
     }
 
-    ustring_delete (preedit);
+    hangul->lookup_table_pending = LOOKUP_TABLE_PENDING_ALL;
+    ibus_hangul_engine_schedule_updates (hangul);
 }
 
+static void
+ibus_hangul_engine_update_lookup_table_cursor (IBusHangulEngine *hangul)
+{
+    if (update_delay == 0) {
+        ibus_hangul_engine_send_lookup_table_cursor (hangul);
+        return;
+    }
+
+    // a whole table update already carries the cursor
+    if (hangul->lookup_table_pending == LOOKUP_TABLE_PENDING_NONE)
+        hangul->lookup_table_pending = LOOKUP_TABLE_PENDING_CURSOR;
+    ibus_hangul_engine_schedule_updates (hangul);
+}
 
 static void
-ibus_hangul_engine_apply_hanja_list (IBusHangulEngine *hangul)
+core_commit_cb (Core *core, const ucschar *str, gpointer user_data)
 {
-    HanjaList* list = hangul->hanja_list;
-    if (list != NULL) {
-        int i, n;
-        n = hanja_list_get_size (list);
+    IBusHangulEngine *hangul = (IBusHangulEngine *) user_data;
+    IBusText *text;
 
-        ibus_lookup_table_clear (hangul->table);
-        for (i = 0; i < n; i++) {
-            const char* value = hanja_list_get_nth_value (list, i);
-            IBusText* text = ibus_text_new_from_string (value);
-            ibus_lookup_table_append_candidate (hangul->table, text);
+    // With updates held back, the preedit string the client shows may
+    // still hold str, and in IBUS_ENGINE_PREEDIT_COMMIT mode the client
+    // would commit it again, so it is cleared first. The current one
+    // follows with the other updates held back. Without a delay the
+    // client is up to date already.
+    if (update_delay != 0) {
+        hangul->preedit_pending = FALSE;
+        ibus_hangul_engine_send_updates (hangul);
+        if (hangul->preedit_shown) {
+            IBusText *empty = ibus_text_new_from_static_string ("");
+
+            ibus_engine_update_preedit_text ((IBusEngine *) hangul, empty,
+                                             0, FALSE);
+            hangul->preedit_shown = FALSE;
         }
+        hangul->preedit_pending = TRUE;
+        ibus_hangul_engine_schedule_updates (hangul);
+    }
 
-        ibus_lookup_table_set_cursor_pos (hangul->table, 0);
-        ibus_hangul_engine_update_lookup_table_ui (hangul);
-        lookup_table_set_visible (hangul->table, TRUE);
+    text = ibus_text_new_from_ucs4 ((gunichar*)str);
+    event_log_add (EVENT_COMMIT, ibus_text_get_length (text), 0, 0);
+    hangul->layout_committed += ibus_text_get_length (text);
+    ibus_engine_commit_text ((IBusEngine *) hangul, text);
+}
+
+static void
+core_update_preedit_cb (Core          *core,
+                        const ucschar *str,
+                        guint          n_fixed,
+                        gpointer       user_data)
+{
+    ibus_hangul_engine_update_preedit_text ((IBusHangulEngine *) user_data);
+}
+
+static void
+core_end_preedit_cb (Core *core, const ucschar *str, gpointer user_data)
+{
+    IBusHangulEngine *hangul = (IBusHangulEngine *) user_data;
+
+    // The client keeps the preedit it was last shown, so that has to
+    // be up to date before it goes.
+    ibus_hangul_engine_send_updates (hangul);
+    ibus_engine_hide_preedit_text ((IBusEngine *) hangul);
+    hangul->preedit_shown = FALSE;
+}
+
+static void
+core_update_candidates_cb (Core                *core,
+                           const CandidateList *list,
+                           gpointer             user_data)
+{
+    IBusHangulEngine *hangul = (IBusHangulEngine *) user_data;
+    guint i, n;
+
+    ibus_hangul_engine_clear_comments (hangul);
+    hangul->layout_offer = FALSE;
+
+    n = candidate_list_get_size (list);
+    ibus_lookup_table_clear (hangul->table);
+    for (i = 0; i < n; i++) {
+        const char* value = candidate_list_get_nth_value (list, i);
+        IBusText* text = ibus_text_new_from_string (value);
+        ibus_lookup_table_append_candidate (hangul->table, text);
+    }
+
+    ibus_lookup_table_set_cursor_pos (hangul->table, 0);
+    ibus_hangul_engine_update_lookup_table_ui (hangul);
+    lookup_table_set_visible (hangul->table, TRUE);
+}
+
+static void
+core_extend_candidates_cb (Core                *core,
+                           const CandidateList *list,
+                           guint                first,
+                           gpointer             user_data)
+{
+    IBusHangulEngine *hangul = (IBusHangulEngine *) user_data;
+    guint i, n;
+
+    n = candidate_list_get_size (list);
+    for (i = first; i < n; i++) {
+        const char* value = candidate_list_get_nth_value (list, i);
+        IBusText* text = ibus_text_new_from_string (value);
+        ibus_lookup_table_append_candidate (hangul->table, text);
     }
+
+    // the comments of the new candidates are made when shown
+    if (hangul->hanja_comments != NULL)
+        g_ptr_array_set_size (hangul->hanja_comments, n);
+
+    ibus_hangul_engine_update_lookup_table_ui (hangul);
+}
+
+static void
+core_update_cursor_cb (Core *core, guint cursor, gpointer user_data)
+{
+    IBusHangulEngine *hangul = (IBusHangulEngine *) user_data;
+
+    ibus_lookup_table_set_cursor_pos (hangul->table, cursor);
+    ibus_hangul_engine_update_lookup_table_cursor (hangul);
 }
 
 static void
-ibus_hangul_engine_hide_lookup_table (IBusHangulEngine *hangul)
+core_hide_candidates_cb (Core *core, gpointer user_data)
 {
-    gboolean is_visible;
-    is_visible = lookup_table_is_visible (hangul->table);
+    IBusHangulEngine *hangul = (IBusHangulEngine *) user_data;
+
+    ibus_hangul_engine_clear_comments (hangul);
+    hangul->layout_offer = FALSE;
 
     // Sending hide lookup table message when the lookup table
     // is not visible results wrong behavior. So I have to check
     // whether the table is visible or not before to hide.
-    if (is_visible) {
+    if (lookup_table_is_visible (hangul->table)) {
+        event_log_add (EVENT_LOOKUP_HIDE, 0, 0, 0);
         ibus_engine_hide_lookup_table ((IBusEngine *)hangul);
         ibus_engine_hide_auxiliary_text ((IBusEngine *)hangul);
         lookup_table_set_visible (hangul->table, FALSE);
     }
-
-    if (hangul->hanja_list != NULL) {
-        hanja_list_delete (hangul->hanja_list);
-        hangul->hanja_list = NULL;
-    }
+    hangul->lookup_table_pending = LOOKUP_TABLE_PENDING_NONE;
 }
 
 static void
-ibus_hangul_engine_update_lookup_table (IBusHangulEngine *hangul)
+core_search_cb (Core *core, const gchar *key, gpointer user_data)
 {
-    ibus_hangul_engine_update_hanja_list (hangul);
+    IBusHangulEngine *hangul = (IBusHangulEngine *) user_data;
+    HanjaSearch *search;
+    gint generation;
 
-    if (hangul->hanja_list != NULL) {
-        ibus_hangul_engine_apply_hanja_list (hangul);
-    } else {
-        ibus_hangul_engine_hide_lookup_table (hangul);
+    // Any search started for an older preedit string is stale now.
+    generation = g_atomic_int_exchange_and_add (
+                        &hangul->hanja_search_generation, 1) + 1;
+    if (key == NULL)
+        return;
+
+    if (hanja_search_pool == NULL) {
+        core_set_search_result (core,
+                core_dicts_search (core_get_dicts (core),
+                                   core_get_filter (core), key));
+        return;
     }
+
+    search = g_slice_new (HanjaSearch);
+    search->hangul = g_object_ref (hangul);
+    search->generation = generation;
+    search->key = g_strdup (key);
+    search->dicts = core_dicts_ref (core_get_dicts (core));
+    search->filter = core_get_filter (core);
+    if (search->filter != NULL)
+        core_filter_ref (search->filter);
+    search->result = NULL;
+
+    g_thread_pool_push (hanja_search_pool, search, NULL);
 }
 
 static gboolean
-ibus_hangul_engine_process_candidate_key_event (IBusHangulEngine    *hangul,
-                                                guint                keyval,
-                                                guint                modifiers)
+core_delete_text_cb (Core *core, guint n_chars, gpointer user_data)
 {
-    if (keyval == IBUS_Escape) {
-        ibus_hangul_engine_hide_lookup_table (hangul);
-        return TRUE;
-    } else if (keyval == IBUS_Return) {
-        ibus_hangul_engine_commit_current_candidate (hangul);
-
-        if (hangul->hanja_mode) {
-            ibus_hangul_engine_update_lookup_table (hangul);
-        } else {
-            ibus_hangul_engine_hide_lookup_table (hangul);
-        }
-        return TRUE;
-    } else if (keyval >= IBUS_1 && keyval <= IBUS_9) {
-        guint page_no;
-        guint page_size;
-        guint cursor_pos;
+    IBusEngine *engine = (IBusEngine *) user_data;
 
-        page_size = ibus_lookup_table_get_page_size (hangul->table);
-        cursor_pos = ibus_lookup_table_get_cursor_pos (hangul->table);
-        page_no = cursor_pos / page_size;
+    // We can't read the text around the cursor, but the client can
+    // delete what we committed there just before.
+    if (!(engine->client_capabilities & IBUS_CAP_SURROUNDING_TEXT))
+        return FALSE;
 
-        cursor_pos = page_no * page_size + (keyval - IBUS_1);
-        ibus_lookup_table_set_cursor_pos (hangul->table, cursor_pos);
+    if (n_chars > 0)
+        ibus_engine_delete_surrounding_text (engine, -(gint) n_chars,
+                                             n_chars);
+    return TRUE;
+}
 
-        ibus_hangul_engine_commit_current_candidate (hangul);
+static KeyTraceRedact
+trace_redact_from_string (const gchar *str)
+{
+    if (strcmp (str, "text") == 0)
+        return KEY_TRACE_REDACT_TEXT;
+    else if (strcmp (str, "all") == 0)
+        return KEY_TRACE_REDACT_ALL;
+    return KEY_TRACE_REDACT_NONE;
+}
 
-        if (hangul->hanja_mode) {
-            ibus_hangul_engine_update_lookup_table (hangul);
-        } else {
-            ibus_hangul_engine_hide_lookup_table (hangul);
-        }
-        return TRUE;
-    } else if (keyval == IBUS_Page_Up) {
-        ibus_lookup_table_page_up (hangul->table);
-        ibus_hangul_engine_update_lookup_table_ui (hangul);
-        return TRUE;
-    } else if (keyval == IBUS_Page_Down) {
-        ibus_lookup_table_page_down (hangul->table);
-        ibus_hangul_engine_update_lookup_table_ui (hangul);
-        return TRUE;
-    } else {
-        if (lookup_table_orientation == 0) {
-            // horizontal
-            if (keyval == IBUS_Left) {
-                ibus_lookup_table_cursor_up (hangul->table);
-                ibus_hangul_engine_update_lookup_table_ui (hangul);
-                return TRUE;
-            } else if (keyval == IBUS_Right) {
-                ibus_lookup_table_cursor_down (hangul->table);
-                ibus_hangul_engine_update_lookup_table_ui (hangul);
-                return TRUE;
-            } else if (keyval == IBUS_Up) {
-                ibus_lookup_table_page_up (hangul->table);
-                ibus_hangul_engine_update_lookup_table_ui (hangul);
-                return TRUE;
-            } else if (keyval == IBUS_Down) {
-                ibus_lookup_table_page_down (hangul->table);
-                ibus_hangul_engine_update_lookup_table_ui (hangul);
-                return TRUE;
-            }
-        } else {
-            // vertical
-            if (keyval == IBUS_Left) {
-                ibus_lookup_table_page_up (hangul->table);
-                ibus_hangul_engine_update_lookup_table_ui (hangul);
-                return TRUE;
-            } else if (keyval == IBUS_Right) {
-                ibus_lookup_table_page_down (hangul->table);
-                ibus_hangul_engine_update_lookup_table_ui (hangul);
-                return TRUE;
-            } else if (keyval == IBUS_Up) {
-                ibus_lookup_table_cursor_up (hangul->table);
-                ibus_hangul_engine_update_lookup_table_ui (hangul);
-                return TRUE;
-            } else if (keyval == IBUS_Down) {
-                ibus_lookup_table_cursor_down (hangul->table);
-                ibus_hangul_engine_update_lookup_table_ui (hangul);
-                return TRUE;
-            }
-        }
-    }
+typedef struct {
+    gchar  *filename;
+    time_t  mtime;
+} TraceFile;
 
-    if (!hangul->hanja_mode) {
-        if (lookup_table_orientation == 0) {
-            // horizontal
-            if (keyval == IBUS_h) {
-                ibus_lookup_table_cursor_up (hangul->table);
-                ibus_hangul_engine_update_lookup_table_ui (hangul);
-                return TRUE;
-            } else if (keyval == IBUS_l) {
-                ibus_lookup_table_cursor_down (hangul->table);
-                ibus_hangul_engine_update_lookup_table_ui (hangul);
-                return TRUE;
-            } else if (keyval == IBUS_k) {
-                ibus_lookup_table_page_up (hangul->table);
-                ibus_hangul_engine_update_lookup_table_ui (hangul);
-                return TRUE;
-            } else if (keyval == IBUS_j) {
-                ibus_lookup_table_page_down (hangul->table);
-                ibus_hangul_engine_update_lookup_table_ui (hangul);
-                return TRUE;
-            }
-        } else {
-            // vertical
-            if (keyval == IBUS_h) {
-                ibus_lookup_table_page_up (hangul->table);
-                ibus_hangul_engine_update_lookup_table_ui (hangul);
-                return TRUE;
-            } else if (keyval == IBUS_l) {
-                ibus_lookup_table_page_down (hangul->table);
-                ibus_hangul_engine_update_lookup_table_ui (hangul);
-                return TRUE;
-            } else if (keyval == IBUS_k) {
-                ibus_lookup_table_cursor_up (hangul->table);
-                ibus_hangul_engine_update_lookup_table_ui (hangul);
-                return TRUE;
-            } else if (keyval == IBUS_j) {
-                ibus_lookup_table_cursor_down (hangul->table);
-                ibus_hangul_engine_update_lookup_table_ui (hangul);
-                return TRUE;
-            }
-        }
-    }
+static gint
+trace_file_compare (gconstpointer a, gconstpointer b)
+{
+    time_t ma = ((const TraceFile *) a)->mtime;
+    time_t mb = ((const TraceFile *) b)->mtime;
 
-    return FALSE;
+    // the newest first
+    return ma > mb ? -1 : ma < mb;
 }
 
-static gboolean
-ibus_hangul_engine_process_key_event (IBusEngine     *engine,
-                                      guint           keyval,
-                                      guint           keycode,
-                                      guint           modifiers)
+/* Removes the oldest traces in dirname but the newest keep. Every
+ * engine writes a file of its own, so they would pile up otherwise. */
+static void
+trace_dir_prune (const gchar *dirname, guint keep)
 {
-    IBusHangulEngine *hangul = (IBusHangulEngine *) engine;
+    GArray *files;
+    GDir *dir;
+    const gchar *name;
+    guint i;
 
-    gboolean retval;
-    const ucschar *str;
+    dir = g_dir_open (dirname, 0, NULL);
+    if (dir == NULL)
+        return;
+
+    files = g_array_new (FALSE, FALSE, sizeof (TraceFile));
+    while ((name = g_dir_read_name (dir)) != NULL) {
+        TraceFile file;
+        struct stat st;
+
+        if (!g_str_has_suffix (name, ".trace"))
+            continue;
+
+        file.filename = g_build_filename (dirname, name, NULL);
+        if (g_stat (file.filename, &st) != 0) {
+            g_free (file.filename);
+            continue;
+        }
+        file.mtime = st.st_mtime;
+        g_array_append_val (files, file);
+    }
+    g_dir_close (dir);
+
+    g_array_sort (files, trace_file_compare);
+    for (i = 0; i < files->len; i++) {
+        TraceFile *file = &g_array_index (files, TraceFile, i);
+
+        if (i >= keep)
+            g_unlink (file->filename);
+        g_free (file->filename);
+    }
+    g_array_free (files, TRUE);
+}
+
+static void
+ibus_hangul_engine_start_trace (IBusHangulEngine *hangul)
+{
+    gchar *dir;
+    gchar *name;
+
+    if (hangul->trace != NULL)
+        return;
+
+    dir = g_build_filename (g_get_user_cache_dir (), "ibus-hangul",
+                            "trace", NULL);
+    g_mkdir_with_parents (dir, 0700);
+    // room for the one started here
+    trace_dir_prune (dir, TRACE_MAX_FILES - 1);
+
+    name = g_strdup_printf ("%d-%u.trace", (int) getpid (), ++trace_serial);
+    hangul->trace_file = g_build_filename (dir, name, NULL);
+    hangul->trace = key_trace_new (TRACE_CAPACITY, trace_redact,
+                                   keyboard_list != NULL ?
+                                   g_ptr_array_index (keyboard_list,
+                                                      hangul->keyboard_index) :
+                                   hangul_keyboard->str);
+
+    g_free (name);
+    g_free (dir);
+}
+
+static void
+ibus_hangul_engine_stop_trace (IBusHangulEngine *hangul)
+{
+    if (hangul->trace == NULL)
+        return;
+
+    key_trace_save (hangul->trace, hangul->trace_file);
+    key_trace_delete (hangul->trace);
+    hangul->trace = NULL;
+
+    g_free (hangul->trace_file);
+    hangul->trace_file = NULL;
+}
+
+static void
+ibus_hangul_engine_watch (IBusHangulEngine *hangul, WatchdogPhase phase)
+{
+    const ucschar *preedit;
+    const CandidateList *candidates;
+    guint n;
+
+    if (watchdog == NULL)
+        return;
+
+    preedit = core_get_preedit (hangul->core, NULL);
+    for (n = 0; preedit[n] != 0; n++)
+        continue;
+    candidates = core_get_candidates (hangul->core);
+
+    watchdog_enter (watchdog, phase, n, candidates != NULL ?
+                    candidate_list_get_size (candidates) : 0);
+}
+
+static guint64
+ibus_hangul_engine_trace_start (IBusHangulEngine *hangul)
+{
+    return hangul->trace != NULL ? key_trace_now () : 0;
+}
+
+static void
+ibus_hangul_engine_trace (IBusHangulEngine  *hangul,
+                          KeyTraceEventType  type,
+                          guint              arg,
+                          guint64            start)
+{
+    if (hangul->trace != NULL)
+        key_trace_append (hangul->trace, type, arg, 0, 0, TRUE, start);
+}
+
+/* Points the keyboard index of hangul at keyboard in keyboard_list, or
+ * switches to the default keyboard if it is gone. */
+static void
+ibus_hangul_engine_find_keyboard (IBusHangulEngine *hangul,
+                                  const gchar      *keyboard)
+{
+    guint i;
+
+    for (i = 0; i < keyboard_list->len; i++) {
+        if (strcmp (g_ptr_array_index (keyboard_list, i), keyboard) == 0) {
+            hangul->keyboard_index = i;
+            return;
+        }
+    }
+
+    hangul->keyboard_index = 0;
+    core_select_keyboard (hangul->core, g_ptr_array_index (keyboard_list, 0));
+}
+
+static void
+ibus_hangul_engine_switch_keyboard (IBusHangulEngine *hangul)
+{
+    const gchar *keyboard;
+
+    if (keyboard_list->len < 2)
+        return;
+
+    // libhangul keeps the composing syllable when the keyboard changes,
+    // so we don't flush here. The next key is composed with the new
+    // layout from the current state.
+    hangul->keyboard_index = (hangul->keyboard_index + 1) % keyboard_list->len;
+    keyboard = g_ptr_array_index (keyboard_list, hangul->keyboard_index);
+    core_select_keyboard (hangul->core, keyboard);
+}
+
+static void
+ibus_hangul_engine_set_hangul_mode (IBusHangulEngine *hangul,
+                                    gboolean          hangul_mode)
+{
+    if (hangul->hangul_mode == hangul_mode)
+        return;
+
+    // what is composed goes to the application as it is
+    if (!hangul_mode)
+        ibus_hangul_engine_flush (hangul);
+
+    hangul->hangul_mode = hangul_mode;
+    event_log_add (EVENT_HANGUL_MODE, hangul_mode, 0, 0);
+    if (hangul_mode) {
+        hangul->prop_hangul_mode->state = PROP_STATE_CHECKED;
+    } else {
+        hangul->prop_hangul_mode->state = PROP_STATE_UNCHECKED;
+    }
+
+    ibus_engine_update_property ((IBusEngine *) hangul,
+                                 hangul->prop_hangul_mode);
+    if (panel_engine == hangul)
+        panel_hangul_mode = hangul_mode;
+}
+
+/* Whether the word being typed can be caught in the wrong mode: the
+ * models are of the 2-set keyboard, and the word is corrected by
+ * deleting what the application has got of it. */
+static gboolean
+ibus_hangul_engine_layout_enabled (IBusHangulEngine *hangul)
+{
+    const gchar *keyboard;
+
+    if (!layout_detect)
+        return FALSE;
+
+    if (!(((IBusEngine *) hangul)->client_capabilities &
+          IBUS_CAP_SURROUNDING_TEXT))
+        return FALSE;
+
+    keyboard = g_ptr_array_index (keyboard_list, hangul->keyboard_index);
+    return strcmp (keyboard, "2") == 0;
+}
+
+/* Returns what the keys of the word give in the other mode. */
+static IBusText*
+ibus_hangul_engine_layout_text (IBusHangulEngine *hangul)
+{
+    const guint *keys;
+    UString *str;
+    IBusText *text;
+    guint i, n;
+
+    keys = layout_detector_get_keys (hangul->layout, &n);
+
+    if (hangul->hangul_mode) {
+        gchar latin[LAYOUT_WORD_MAX + 1];
+
+        for (i = 0; i < n; i++)
+            latin[i] = keys[i];
+        latin[n] = '\0';
+        return ibus_text_new_from_string (latin);
+    }
+
+    if (layout_composer == NULL)
+        layout_composer = composer_new ("2");
+
+    str = ustring_new ();
+    for (i = 0; i < n; i++) {
+        composer_process (layout_composer, keys[i]);
+        ustring_append_ucs4 (str,
+                             composer_get_commit_string (layout_composer), -1);
+    }
+    ustring_append_ucs4 (str, composer_flush (layout_composer), -1);
+    text = ibus_text_new_from_ucs4 ((gunichar *) ustring_begin (str));
+    ustring_delete (str);
+
+    return text;
+}
+
+static void
+ibus_hangul_engine_show_layout_offer (IBusHangulEngine *hangul)
+{
+    IBusText *text;
+
+    ibus_hangul_engine_clear_comments (hangul);
+    ibus_lookup_table_clear (hangul->table);
+    ibus_lookup_table_append_candidate (hangul->table,
+                                    ibus_hangul_engine_layout_text (hangul));
+    ibus_lookup_table_set_cursor_pos (hangul->table, 0);
+
+    if (!hangul->layout_offer) {
+        text = ibus_text_new_from_string (_("Switch the input mode to "
+                                            "correct the word"));
+        ibus_engine_update_auxiliary_text ((IBusEngine *) hangul, text, TRUE);
+    }
+    ibus_engine_update_lookup_table ((IBusEngine *) hangul, hangul->table,
+                                     TRUE);
+    lookup_table_set_visible (hangul->table, TRUE);
+    hangul->layout_offer = TRUE;
+}
+
+static void
+ibus_hangul_engine_hide_layout_offer (IBusHangulEngine *hangul)
+{
+    if (!hangul->layout_offer)
+        return;
+
+    hangul->layout_offer = FALSE;
+    ibus_lookup_table_clear (hangul->table);
+    if (lookup_table_is_visible (hangul->table)) {
+        event_log_add (EVENT_LOOKUP_HIDE, 0, 0, 0);
+        ibus_engine_hide_lookup_table ((IBusEngine *) hangul);
+        ibus_engine_hide_auxiliary_text ((IBusEngine *) hangul);
+        lookup_table_set_visible (hangul->table, FALSE);
+    }
+}
+
+/* Starts a new word, e.g. when the focus moves. */
+static void
+ibus_hangul_engine_reset_layout (IBusHangulEngine *hangul)
+{
+    if (hangul->layout == NULL)
+        return;
+
+    ibus_hangul_engine_hide_layout_offer (hangul);
+    layout_detector_reset (hangul->layout);
+    hangul->layout_committed = 0;
+    hangul->layout_word_end = FALSE;
+    hangul->layout_guess = LAYOUT_UNSURE;
+}
+
+/* Replaces the word typed so far with what its keys give in the other
+ * mode, and switches to that mode. If pending, the last key of the word
+ * is not handled yet. */
+static void
+ibus_hangul_engine_correct_layout (IBusHangulEngine *hangul,
+                                   gboolean          pending)
+{
+    IBusEngine *engine = (IBusEngine *) hangul;
+    const guint *keys;
+    guint i, n, n_chars;
+
+    keys = layout_detector_get_keys (hangul->layout, &n);
+    ibus_hangul_engine_hide_layout_offer (hangul);
+    event_log_add (EVENT_LAYOUT,
+                   hangul->hangul_mode ? LAYOUT_LATIN : LAYOUT_HANGUL, n,
+                   TRUE);
+
+    if (hangul->hangul_mode) {
+        IBusText *text = ibus_hangul_engine_layout_text (hangul);
+
+        // The syllable being composed is dropped, not committed.
+        core_reset (hangul->core);
+        hangul->preedit_pending = TRUE;
+        ibus_hangul_engine_send_updates (hangul);
+
+        n_chars = hangul->layout_committed;
+        if (n_chars > 0)
+            ibus_engine_delete_surrounding_text (engine, -(gint) n_chars,
+                                                 n_chars);
+        ibus_engine_commit_text (engine, text);
+        ibus_hangul_engine_set_hangul_mode (hangul, FALSE);
+    } else {
+        // The keys are typed again in Hangul mode, so the last syllable
+        // is left in the preedit string to go on with.
+        n_chars = pending ? n - 1 : n;
+        if (n_chars > 0)
+            ibus_engine_delete_surrounding_text (engine, -(gint) n_chars,
+                                                 n_chars);
+        ibus_hangul_engine_set_hangul_mode (hangul, TRUE);
+        for (i = 0; i < n; i++)
+            core_process_key (hangul->core, keys[i]);
+    }
+
+    // the rest of the word is typed in the new mode
+    layout_detector_stop (hangul->layout);
+}
+
+/* Follows the letters of a word in the layout detector, before the key
+ * is handled. Returns TRUE if the key was taken to correct the word. */
+static gboolean
+ibus_hangul_engine_layout_key (IBusHangulEngine *hangul,
+                               guint             keyval,
+                               guint             modifiers)
+{
+    LayoutGuess guess;
+    guint n;
+
+    // Shift makes capitals, and a lone modifier does nothing yet.
+    if (keyval >= IBUS_Shift_L && keyval <= IBUS_Hyper_R)
+        return FALSE;
+
+    // the mode key takes the correction offered
+    if (hangul->layout_offer &&
+        key_event_list_match (hangul_mode_keys, keyval, modifiers)) {
+        ibus_hangul_engine_correct_layout (hangul, FALSE);
+        return TRUE;
+    }
+
+    hangul->layout_guess = LAYOUT_UNSURE;
+
+    // Anything but a letter ends the word. The next one starts once
+    // the key is handled, so a syllable it commits is not part of it.
+    if ((modifiers & (IBUS_CONTROL_MASK | IBUS_MOD1_MASK)) ||
+        keyval > 0x7f || !g_ascii_isalpha (keyval)) {
+        ibus_hangul_engine_hide_layout_offer (hangul);
+        hangul->layout_word_end = TRUE;
+        return FALSE;
+    }
+
+    // as the key is handled in Hangul mode
+    if (modifiers & IBUS_LOCK_MASK)
+        keyval = isupper (keyval) ? tolower (keyval) : toupper (keyval);
+
+    // In hanja mode and with candidates the letters do other things,
+    // and a word can't start in the middle of a syllable.
+    layout_detector_get_keys (hangul->layout, &n);
+    if (!ibus_hangul_engine_layout_enabled (hangul) ||
+        (hangul->hangul_mode &&
+         (core_get_hanja_mode (hangul->core) ||
+          core_has_candidates (hangul->core) ||
+          core_get_symbol_search (hangul->core) ||
+          (n == 0 && core_get_preedit (hangul->core, NULL)[0] != 0))))
+        layout_detector_stop (hangul->layout);
+
+    guess = layout_detector_push (hangul->layout, keyval);
+    if (guess != (hangul->hangul_mode ? LAYOUT_LATIN : LAYOUT_HANGUL)) {
+        ibus_hangul_engine_hide_layout_offer (hangul);
+        return FALSE;
+    }
+
+    if (layout_auto_correct) {
+        ibus_hangul_engine_correct_layout (hangul, TRUE);
+        return TRUE;
+    }
+
+    // offered once the key is handled
+    hangul->layout_guess = guess;
+    return FALSE;
+}
+
+/* Acts on the layout detection once the key is handled. */
+static void
+ibus_hangul_engine_layout_update (IBusHangulEngine *hangul)
+{
+    guint n;
+
+    if (hangul->layout_word_end) {
+        hangul->layout_word_end = FALSE;
+        layout_detector_reset (hangul->layout);
+        hangul->layout_committed = 0;
+        return;
+    }
+
+    if (hangul->layout_guess == LAYOUT_UNSURE)
+        return;
+
+    // Candidates the key brought up, e.g. of a snippet, come first.
+    if (!core_has_candidates (hangul->core)) {
+        if (!hangul->layout_offer) {
+            layout_detector_get_keys (hangul->layout, &n);
+            event_log_add (EVENT_LAYOUT, hangul->layout_guess, n, FALSE);
+        }
+        ibus_hangul_engine_show_layout_offer (hangul);
+    }
+    hangul->layout_guess = LAYOUT_UNSURE;
+}
+
+static gboolean
+ibus_hangul_engine_handle_key_event (IBusEngine     *engine,
+                                     guint           keyval,
+                                     guint           keycode,
+                                     guint           modifiers)
+{
+    IBusHangulEngine *hangul = (IBusHangulEngine *) engine;
 
     if (modifiers & IBUS_RELEASE_MASK)
         return FALSE;
@@ -660,78 +1718,104 @@ ibus_hangul_engine_process_key_event (IBusEngine     *engine,
     if (keyval == IBUS_Shift_L || keyval == IBUS_Shift_R)
         return FALSE;
 
-    if (key_event_list_match(hanja_keys, keyval, modifiers)) {
-        if (hangul->hanja_list == NULL) {
-            ibus_hangul_engine_update_lookup_table (hangul);
-        } else {
-            ibus_hangul_engine_hide_lookup_table (hangul);
-        }
+    if (key_event_list_match(hangul_mode_keys, keyval, modifiers)) {
+        ibus_hangul_engine_set_hangul_mode (hangul, !hangul->hangul_mode);
         return TRUE;
     }
 
-    if (modifiers & (IBUS_CONTROL_MASK | IBUS_MOD1_MASK))
+    if (!hangul->hangul_mode)
         return FALSE;
 
-    if (hangul->hanja_list != NULL) {
-        retval = ibus_hangul_engine_process_candidate_key_event (hangul,
-                     keyval, modifiers);
-        if (hangul->hanja_mode) {
-            if (retval)
-                return TRUE;
+    if (key_event_list_match(hanja_keys, keyval, modifiers)) {
+        if (!core_has_candidates (hangul->core)) {
+            core_show_candidates (hangul->core);
         } else {
-            return TRUE;
+            core_hide_candidates (hangul->core);
         }
+        return TRUE;
     }
 
-    if (keyval == IBUS_BackSpace) {
-        retval = hangul_ic_backspace (hangul->context);
-    } else {
-        // ignore capslock
-        if (modifiers & IBUS_LOCK_MASK) {
-            if (keyval >= 'A' && keyval <= 'z') {
-                if (isupper(keyval))
-                    keyval = tolower(keyval);
-                else
-                    keyval = toupper(keyval);
-            }
-        }
-        retval = hangul_ic_process (hangul->context, keyval);
+    if (key_event_list_match(symbol_search_keys, keyval, modifiers)) {
+        event_log_add (EVENT_SYMBOL_SEARCH, TRUE, 0, 0);
+        core_start_symbol_search (hangul->core);
+        return TRUE;
     }
 
-    str = hangul_ic_get_commit_string (hangul->context);
-    if (hangul->hanja_mode) {
-        const ucschar* hic_preedit;
+    if (key_event_list_match(switch_keyboard_keys, keyval, modifiers)) {
+        ibus_hangul_engine_switch_keyboard (hangul);
+        return TRUE;
+    }
 
-        hic_preedit = hangul_ic_get_preedit_string (hangul->context);
-        if (hic_preedit != NULL && hic_preedit[0] != 0) {
-            ustring_append_ucs4 (hangul->preedit, str, -1);
-        } else {
-            IBusText *text;
-            const ucschar* preedit;
-
-            ustring_append_ucs4 (hangul->preedit, str, -1);
-            if (ustring_length (hangul->preedit) > 0) {
-                preedit = ustring_begin (hangul->preedit);
-                text = ibus_text_new_from_ucs4 ((gunichar*)preedit);
-                ibus_engine_commit_text (engine, text);
-            }
-            ustring_clear (hangul->preedit);
-        }
-    } else {
-        if (str != NULL && str[0] != 0) {
-            IBusText *text = ibus_text_new_from_ucs4 (str);
-            ibus_engine_commit_text (engine, text);
+    // The application may do anything with these, e.g. paste.
+    if (modifiers & (IBUS_CONTROL_MASK | IBUS_MOD1_MASK)) {
+        core_forget_text (hangul->core);
+        return FALSE;
+    }
+
+    // ignore capslock
+    if (modifiers & IBUS_LOCK_MASK) {
+        if (keyval >= 'A' && keyval <= 'z') {
+            if (isupper(keyval))
+                keyval = tolower(keyval);
+            else
+                keyval = toupper(keyval);
         }
     }
 
-    ibus_hangul_engine_update_preedit_text (hangul);
+    return core_process_key (hangul->core, keyval);
+}
 
-    if (hangul->hanja_mode) {
-        ibus_hangul_engine_update_lookup_table (hangul);
+static gboolean
+ibus_hangul_engine_process_key_event (IBusEngine     *engine,
+                                      guint           keyval,
+                                      guint           keycode,
+                                      guint           modifiers)
+{
+    IBusHangulEngine *hangul = (IBusHangulEngine *) engine;
+    guint64 start;
+    gboolean retval;
+
+    // In Latin mode the keys go back to the application as they are.
+    // Nothing but the toggle and the letters of a word that may be typed
+    // in the wrong mode are looked at, and nothing is sent out unless it
+    // is.
+    if (!hangul->hangul_mode && hangul->trace == NULL &&
+        ((modifiers & IBUS_RELEASE_MASK) ||
+         !key_event_list_match (hangul_mode_keys, keyval, modifiers))) {
+        if (hangul->layout == NULL || (modifiers & IBUS_RELEASE_MASK))
+            return FALSE;
+
+        retval = ibus_hangul_engine_layout_key (hangul, keyval, modifiers);
+        ibus_hangul_engine_layout_update (hangul);
+        if (retval)
+            event_log_add (EVENT_KEY, keyval, modifiers, retval);
+        return retval;
     }
 
+    ibus_hangul_engine_watch (hangul, WATCHDOG_PHASE_KEY);
+    start = ibus_hangul_engine_trace_start (hangul);
+
+    retval = FALSE;
+    if (hangul->layout != NULL && !(modifiers & IBUS_RELEASE_MASK))
+        retval = ibus_hangul_engine_layout_key (hangul, keyval, modifiers);
     if (!retval)
-        ibus_hangul_engine_flush (hangul);
+        retval = ibus_hangul_engine_handle_key_event (engine,
+                                                keyval, keycode, modifiers);
+    if (hangul->layout != NULL && !(modifiers & IBUS_RELEASE_MASK))
+        ibus_hangul_engine_layout_update (hangul);
+
+    // The application acts on the keys we don't take, so it has to see
+    // our preedit as it is now. Releases and Shift do nothing there.
+    if (!retval && !(modifiers & IBUS_RELEASE_MASK) &&
+        keyval != IBUS_Shift_L && keyval != IBUS_Shift_R)
+        ibus_hangul_engine_send_updates (hangul);
+
+    if (hangul->trace != NULL)
+        key_trace_append (hangul->trace, KEY_TRACE_KEY,
+                          keyval, keycode, modifiers, retval, start);
+    event_log_add (EVENT_KEY, keyval, modifiers, retval);
+
+    watchdog_leave (watchdog);
 
     return retval;
 }
@@ -739,73 +1823,143 @@ ibus_hangul_engine_process_key_event (IBusEngine     *engine,
 static void
 ibus_hangul_engine_flush (IBusHangulEngine *hangul)
 {
-    const gunichar *str;
-    IBusText *text;
-
-    ibus_hangul_engine_hide_lookup_table (hangul);
-
-    str = hangul_ic_flush (hangul->context);
-
-    ustring_append_ucs4 (hangul->preedit, str, -1);
-
-    if (ustring_length (hangul->preedit) == 0)
-        return;
+    core_flush (hangul->core);
+}
 
-    str = ustring_begin (hangul->preedit);
-    text = ibus_text_new_from_ucs4 (str);
+static void
+ibus_hangul_engine_register_properties (IBusHangulEngine *hangul)
+{
+    IBusMessage *message;
+    const gchar *path;
+    GList *connections;
+    GList *l;
+    gboolean hanja_mode = core_get_hanja_mode (hangul->core);
+    guint i = (hanja_mode ? 1 : 0) | (hangul->hangul_mode ? 0 : 2);
+
+    // All engines have the same property list but for the states of
+    // the modes, so it is serialized once for each of them. Every
+    // engine sends a copy of it with its own object path.
+    if (prop_list_messages[i] == NULL) {
+        message = ibus_message_new_signal ("/",
+                                           IBUS_INTERFACE_ENGINE,
+                                           "RegisterProperties");
+        ibus_message_append_args (message,
+                                  IBUS_TYPE_PROP_LIST, &hangul->prop_list,
+                                  G_TYPE_INVALID);
+        prop_list_messages[i] = message;
+    }
 
-    ibus_engine_hide_preedit_text ((IBusEngine *) hangul);
-    // Use ibus_engine_update_preedit_text_with_mode instead.
-    //ibus_engine_commit_text ((IBusEngine *) hangul, text);
+    path = ibus_service_get_path ((IBusService *) hangul);
+    connections = ibus_service_get_connections ((IBusService *) hangul);
+    for (l = connections; l != NULL; l = l->next) {
+        message = dbus_message_copy (prop_list_messages[i]);
+        dbus_message_set_path (message, path);
+        ibus_connection_send ((IBusConnection *) l->data, message);
+        ibus_message_unref (message);
+    }
+    g_list_free (connections);
 
-    ustring_clear(hangul->preedit);
+    panel_engine = hangul;
+    panel_n_registrations++;
+    panel_hangul_mode = hangul->hangul_mode;
+    panel_hanja_mode = hanja_mode;
 }
 
 static void
 ibus_hangul_engine_focus_in (IBusEngine *engine)
 {
     IBusHangulEngine *hangul = (IBusHangulEngine *) engine;
+    guint64 start = ibus_hangul_engine_trace_start (hangul);
+    gboolean hanja_mode = core_get_hanja_mode (hangul->core);
 
-    if (hangul->hanja_mode) {
+    ibus_hangul_engine_watch (hangul, WATCHDOG_PHASE_FOCUS_IN);
+    event_log_add (EVENT_FOCUS_IN, 0, 0, 0);
+    core_forget_text (hangul->core);
+    ibus_hangul_engine_reset_layout (hangul);
+    dict_update_check ();
+    snippet_check ();
+
+    if (hanja_mode) {
         hangul->prop_hanja_mode->state = PROP_STATE_CHECKED;
     } else {
         hangul->prop_hanja_mode->state = PROP_STATE_UNCHECKED;
     }
 
-    ibus_engine_register_properties (engine, hangul->prop_list);
+    // The panel drops the properties when the focus leaves, so they are
+    // registered on every focus in, from the message made once. Only a
+    // focus in that comes again without a focus out, the panel still
+    // having our properties, needs to hear about a changed mode alone.
+    if (panel_engine != hangul) {
+        ibus_hangul_engine_register_properties (hangul);
+    } else {
+        if (panel_hangul_mode != hangul->hangul_mode) {
+            ibus_engine_update_property (engine, hangul->prop_hangul_mode);
+            panel_hangul_mode = hangul->hangul_mode;
+        }
+        if (panel_hanja_mode != hanja_mode) {
+            ibus_engine_update_property (engine, hangul->prop_hanja_mode);
+            panel_hanja_mode = hanja_mode;
+        }
+    }
 
-    if (hangul->hanja_list != NULL) {
+    if (core_get_candidates (hangul->core) != NULL) {
         ibus_hangul_engine_update_lookup_table_ui (hangul);
     }
 
     parent_class->focus_in (engine);
+
+    ibus_hangul_engine_trace (hangul, KEY_TRACE_FOCUS_IN, 0, start);
+    watchdog_leave (watchdog);
 }
 
 static void
 ibus_hangul_engine_focus_out (IBusEngine *engine)
 {
     IBusHangulEngine *hangul = (IBusHangulEngine *) engine;
+    guint64 start = ibus_hangul_engine_trace_start (hangul);
 
-    if (hangul->hanja_list == NULL) {
+    ibus_hangul_engine_watch (hangul, WATCHDOG_PHASE_FOCUS_OUT);
+    event_log_add (EVENT_FOCUS_OUT, 0, 0, 0);
+    ibus_hangul_engine_send_updates (hangul);
+    ibus_hangul_engine_reset_layout (hangul);
+
+    if (core_get_candidates (hangul->core) == NULL) {
         ibus_hangul_engine_flush (hangul);
-    } else {
+    } else if (lookup_table_is_visible (hangul->table)) {
+        // keep the table marked visible, focus_in shows it again
         ibus_engine_hide_lookup_table (engine);
         ibus_engine_hide_auxiliary_text (engine);
     }
 
+    // the panel drops the properties when the focus leaves
+    if (panel_engine == hangul)
+        panel_engine = NULL;
+
     parent_class->focus_out ((IBusEngine *) hangul);
+
+    if (hangul->trace != NULL) {
+        ibus_hangul_engine_trace (hangul, KEY_TRACE_FOCUS_OUT, 0, start);
+        // a good time to keep the trace safe from a crash
+        key_trace_save (hangul->trace, hangul->trace_file);
+    }
+
+    watchdog_leave (watchdog);
 }
 
 static void
 ibus_hangul_engine_reset (IBusEngine *engine)
 {
     IBusHangulEngine *hangul = (IBusHangulEngine *) engine;
+    guint64 start = ibus_hangul_engine_trace_start (hangul);
 
+    ibus_hangul_engine_watch (hangul, WATCHDOG_PHASE_RESET);
+    event_log_add (EVENT_RESET, 0, 0, 0);
+    ibus_hangul_engine_reset_layout (hangul);
     ibus_hangul_engine_flush (hangul);
-    if (hangul->hanja_list != NULL) {
-        ibus_hangul_engine_hide_lookup_table (hangul);
-    }
     parent_class->reset (engine);
+
+    ibus_hangul_engine_trace (hangul, KEY_TRACE_RESET, 0, start);
+    watchdog_leave (watchdog);
 }
 
 static void
@@ -837,26 +1991,26 @@ static void
 ibus_hangul_engine_cursor_up (IBusEngine *engine)
 {
     IBusHangulEngine *hangul = (IBusHangulEngine *) engine;
+    guint64 start = ibus_hangul_engine_trace_start (hangul);
 
-    if (hangul->hanja_list != NULL) {
-        ibus_lookup_table_cursor_up (hangul->table);
-        ibus_hangul_engine_update_lookup_table_ui (hangul);
-    }
+    core_cursor_up (hangul->core);
 
     parent_class->cursor_up (engine);
+
+    ibus_hangul_engine_trace (hangul, KEY_TRACE_CURSOR_UP, 0, start);
 }
 
 static void
 ibus_hangul_engine_cursor_down (IBusEngine *engine)
 {
     IBusHangulEngine *hangul = (IBusHangulEngine *) engine;
+    guint64 start = ibus_hangul_engine_trace_start (hangul);
 
-    if (hangul->hanja_list != NULL) {
-        ibus_lookup_table_cursor_down (hangul->table);
-        ibus_hangul_engine_update_lookup_table_ui (hangul);
-    }
+    core_cursor_down (hangul->core);
 
     parent_class->cursor_down (engine);
+
+    ibus_hangul_engine_trace (hangul, KEY_TRACE_CURSOR_DOWN, 0, start);
 }
 
 static void
@@ -880,44 +2034,672 @@ ibus_hangul_engine_property_activate (IBusEngine    *engine,
         g_spawn_async (NULL, argv, NULL, 0, NULL, NULL, NULL, &error);
 
         g_free(path);
+    } else if (strcmp(prop_name, "hangul_mode") == 0) {
+        IBusHangulEngine *hangul = (IBusHangulEngine *) engine;
+
+        ibus_hangul_engine_set_hangul_mode (hangul, !hangul->hangul_mode);
     } else if (strcmp(prop_name, "hanja_mode") == 0) {
         IBusHangulEngine *hangul = (IBusHangulEngine *) engine;
+        gboolean hanja_mode = !core_get_hanja_mode (hangul->core);
 
-        hangul->hanja_mode = !hangul->hanja_mode;
-        if (hangul->hanja_mode) {
+        core_set_hanja_mode (hangul->core, hanja_mode);
+        event_log_add (EVENT_HANJA_MODE, hanja_mode, 0, 0);
+        if (hanja_mode) {
             hangul->prop_hanja_mode->state = PROP_STATE_CHECKED;
         } else {
             hangul->prop_hanja_mode->state = PROP_STATE_UNCHECKED;
         }
 
         ibus_engine_update_property (engine, hangul->prop_hanja_mode);
+        if (panel_engine == hangul)
+            panel_hanja_mode = hanja_mode;
         ibus_hangul_engine_flush (hangul);
     }
 }
 
 static void
-ibus_config_value_changed (IBusConfig   *config,
-                           const gchar  *section,
-                           const gchar  *name,
-                           GValue       *value,
-                           gpointer      user_data)
+ibus_hangul_engine_config_changed (IBusHangulEngine *hangul,
+                                   const gchar      *section,
+                                   const gchar      *name)
 {
-    IBusHangulEngine *hangul = (IBusHangulEngine *) user_data;
+    if (strcmp(section, "panel") == 0) {
+        if (strcmp(name, "lookup_table_orientation") == 0)
+            core_set_vertical (hangul->core, lookup_table_orientation != 0);
+        return;
+    }
+
+    if (strcmp(section, "engine/Hangul") != 0)
+        return;
+
+    if (strcmp(name, "HangulKeyboard") == 0) {
+        hangul->keyboard_index = 0;
+        core_select_keyboard (hangul->core, hangul_keyboard->str);
+    } else if (strcmp(name, "TraceKeyEvents") == 0) {
+        if (trace_enabled)
+            ibus_hangul_engine_start_trace (hangul);
+        else
+            ibus_hangul_engine_stop_trace (hangul);
+    } else if (strcmp(name, "CandidateFilter") == 0) {
+        // the candidates shown now are from the old filter
+        ibus_hangul_engine_flush (hangul);
+        core_set_filter (hangul->core, candidate_filter);
+    } else if (strcmp(name, "SnippetAutoCommit") == 0) {
+        core_set_snippets (hangul->core, snippets, snippet_auto_commit);
+    } else if (strcmp(name, "LayoutDetect") == 0) {
+        ibus_hangul_engine_reset_layout (hangul);
+    }
+}
+
+/* Makes the filter named by str: "none", "ksx1001" for the characters
+ * of the legacy Korean charset, or a file with the characters to keep. */
+static CoreFilter*
+candidate_filter_new (const gchar *str)
+{
+    CharFilter *chars;
+
+    if (str == NULL || str[0] == '\0' || strcmp (str, "none") == 0)
+        return NULL;
+
+    if (strcmp (str, "ksx1001") == 0) {
+        chars = char_filter_new_ksx1001 ();
+    } else {
+        chars = char_filter_load (str);
+        if (chars == NULL) {
+            g_warning ("can't read the candidate filter %s", str);
+            return NULL;
+        }
+    }
+
+    return core_filter_new (dicts, chars);
+}
+
+/* Applies the dictionary deltas, so a dictionary can be refreshed by
+ * shipping the entries that change. They are read from the user's data
+ * directory and from ours, and applied off the main thread: the engines
+ * keep using the dictionaries they have until then. Like the snippets,
+ * the directories are looked at again when an engine gets the focus, and
+ * read again if a delta was added to or removed from one; the deltas
+ * applied already are skipped then, as they don't fit the dictionaries
+ * any more. */
+static void
+dict_update_check (void)
+{
+    gchar *dirnames[2];
+    time_t mtimes[2];
+    guint i;
+
+    if (dict_update_thread != NULL)
+        return;
+
+    dirnames[0] = g_build_filename (g_get_user_data_dir (), "ibus-hangul",
+                                    "delta", NULL);
+    dirnames[1] = g_strdup (IBUSHANGUL_DATADIR "/data/delta");
+    for (i = 0; i < G_N_ELEMENTS (dirnames); i++) {
+        struct stat st;
+
+        mtimes[i] = g_stat (dirnames[i], &st) == 0 ? st.st_mtime : 0;
+        g_free (dirnames[i]);
+    }
+
+    if (mtimes[0] == dict_update_mtimes[0] &&
+        mtimes[1] == dict_update_mtimes[1])
+        return;
+
+    dict_update_thread = g_thread_create (dict_update_func,
+                                          core_dicts_ref (dicts),
+                                          TRUE, NULL);
+    if (dict_update_thread == NULL) {
+        core_dicts_unref (dicts);
+        return;
+    }
+
+    dict_update_mtimes[0] = mtimes[0];
+    dict_update_mtimes[1] = mtimes[1];
+}
+
+static gint
+dict_delta_compare (gconstpointer a, gconstpointer b)
+{
+    guint va = dict_delta_get_version (*(DictDelta * const *) a);
+    guint vb = dict_delta_get_version (*(DictDelta * const *) b);
+
+    return va < vb ? -1 : va > vb;
+}
+
+/* Appends the deltas in dirname to deltas. */
+static void
+dict_update_read_dir (const gchar *dirname, GPtrArray *deltas)
+{
+    GDir *dir;
+    const gchar *name;
+
+    dir = g_dir_open (dirname, 0, NULL);
+    if (dir == NULL)
+        return;
+
+    while ((name = g_dir_read_name (dir)) != NULL) {
+        DictDelta *delta;
+        GError *error = NULL;
+        gchar *filename;
+
+        if (!g_str_has_suffix (name, ".delta"))
+            continue;
+
+        filename = g_build_filename (dirname, name, NULL);
+        delta = dict_delta_load (filename, &error);
+        if (delta != NULL) {
+            g_ptr_array_add (deltas, delta);
+        } else {
+            g_warning ("%s", error->message);
+            g_error_free (error);
+        }
+        g_free (filename);
+    }
+
+    g_dir_close (dir);
+}
+
+/* Returns the dictionaries of data, which it takes, with the deltas
+ * applied, or NULL if none was. */
+static gpointer
+dict_update_func (gpointer data)
+{
+    CoreDicts *updated = data;
+    GPtrArray *deltas;
+    gboolean changed = FALSE;
+    gchar *dirname;
+    guint i;
+
+    deltas = g_ptr_array_new ();
+    dirname = g_build_filename (g_get_user_data_dir (), "ibus-hangul",
+                                "delta", NULL);
+    dict_update_read_dir (dirname, deltas);
+    g_free (dirname);
+    dict_update_read_dir (IBUSHANGUL_DATADIR "/data/delta", deltas);
+
+    // Each delta is made for the version before it.
+    g_ptr_array_sort (deltas, dict_delta_compare);
+
+    for (i = 0; i < deltas->len; i++) {
+        DictDelta *delta = g_ptr_array_index (deltas, i);
+        CoreDicts *next;
+        GError *error = NULL;
+
+        next = core_dicts_apply_delta (updated, delta, &error);
+        if (next != NULL) {
+            core_dicts_unref (updated);
+            updated = next;
+            changed = TRUE;
+        } else if (error->code == DICT_DELTA_ERROR_BASE) {
+            // for a dictionary we don't have, or applied already
+            g_debug ("%s", error->message);
+        } else {
+            g_warning ("%s", error->message);
+        }
+
+        if (error != NULL)
+            g_error_free (error);
+        dict_delta_free (delta);
+    }
+    g_ptr_array_free (deltas, TRUE);
+
+    if (!changed) {
+        core_dicts_unref (updated);
+        updated = NULL;
+    }
+
+    g_idle_add (dict_update_done, &dict_update_thread);
+
+    return updated;
+}
+
+static gboolean
+dict_update_done (gpointer data)
+{
+    CoreDicts *updated;
+    GList *l;
+    GSList *sl;
+
+    updated = g_thread_join (dict_update_thread);
+    dict_update_thread = NULL;
+    if (updated == NULL)
+        return FALSE;
+
+    g_message ("dictionaries updated to version %u",
+               core_dicts_get_version (updated));
+    event_log_add (EVENT_DICTS, core_dicts_get_version (updated), 0, 0);
+
+    core_dicts_unref (dicts);
+    dicts = updated;
+
+    // The filter is sorted out for the entries of the old dictionaries.
+    core_filter_unref (candidate_filter);
+    candidate_filter = candidate_filter_new (candidate_filter_str);
+
+    for (l = engine_list; l != NULL; l = l->next) {
+        IBusHangulEngine *hangul = l->data;
+
+        // This hides the candidates of the old dictionaries, but leaves
+        // the preedit string alone.
+        core_set_dicts (hangul->core, dicts);
+        core_set_filter (hangul->core, candidate_filter);
+    }
+
+    for (sl = engine_state_pool; sl != NULL; sl = sl->next) {
+        EngineState *state = sl->data;
+
+        core_set_dicts (state->core, dicts);
+    }
+
+    return FALSE;
+}
+
+/* Reads the snippet file again, in the background, if it changed since
+ * it was read last. It is looked at when an engine gets the focus, so
+ * the snippets can be edited while typing. */
+static void
+snippet_check (void)
+{
+    struct stat st;
+    time_t mtime = 0;
+    goffset size = -1;
+
+    if (snippet_load_thread != NULL)
+        return;
+
+    if (g_stat (snippet_file, &st) == 0) {
+        mtime = st.st_mtime;
+        size = st.st_size;
+    }
+
+    if (mtime == snippet_mtime && size == snippet_size)
+        return;
+
+    snippet_load_thread = g_thread_create (snippet_load_func,
+                                           g_strdup (snippet_file),
+                                           TRUE, NULL);
+    if (snippet_load_thread == NULL)
+        return;
+
+    snippet_mtime = mtime;
+    snippet_size = size;
+}
+
+/* Returns the snippets of the file named data, which it takes, or NULL
+ * if there are none. */
+static gpointer
+snippet_load_func (gpointer data)
+{
+    gchar *filename = data;
+    SnippetTable *table;
+
+    table = snippet_table_load (filename);
+    g_free (filename);
+
+    g_idle_add (snippet_load_done, &snippet_load_thread);
+
+    return table;
+}
+
+static gboolean
+snippet_load_done (gpointer data)
+{
+    GList *l;
+
+    snippet_table_unref (snippets);
+    snippets = g_thread_join (snippet_load_thread);
+    snippet_load_thread = NULL;
+
+    for (l = engine_list; l != NULL; l = l->next) {
+        IBusHangulEngine *hangul = l->data;
+
+        core_set_snippets (hangul->core, snippets, snippet_auto_commit);
+    }
+
+    return FALSE;
+}
+
+static void
+ibus_hangul_config_set_value (const gchar  *section,
+                              const gchar  *name,
+                              const GValue *value)
+{
+    GList *l;
 
     if (strcmp(section, "engine/Hangul") == 0) {
         if (strcmp(name, "HangulKeyboard") == 0) {
             const gchar *str = g_value_get_string (value);
             g_string_assign (hangul_keyboard, str);
-            hangul_ic_select_keyboard (hangul->context, hangul_keyboard->str);
+            keyboard_list_set (keyboard_list, keyboard_list_str->str);
+        } else if (strcmp(name, "HangulKeyboardList") == 0) {
+            const gchar *str = g_value_get_string (value);
+            GPtrArray *old_list = keyboard_list;
+
+            g_string_assign (keyboard_list_str, str);
+            keyboard_list = g_ptr_array_new ();
+            keyboard_list_set (keyboard_list, keyboard_list_str->str);
+
+            // The list may be only reordered, so each engine looks for
+            // the keyboard it is on in the new one.
+            for (l = engine_list; l != NULL; l = l->next) {
+                IBusHangulEngine *hangul = l->data;
+
+                ibus_hangul_engine_find_keyboard (hangul,
+                        g_ptr_array_index (old_list, hangul->keyboard_index));
+            }
+
+            g_ptr_array_foreach (old_list, (GFunc) g_free, NULL);
+            g_ptr_array_free (old_list, TRUE);
         } else if (strcmp(name, "HanjaKeys") == 0) {
             const gchar* str = g_value_get_string (value);
             key_event_list_set(hanja_keys, str);
+        } else if (strcmp(name, "HangulModeKeys") == 0) {
+            const gchar* str = g_value_get_string (value);
+            key_event_list_set(hangul_mode_keys, str);
+        } else if (strcmp(name, "SymbolSearchKeys") == 0) {
+            const gchar* str = g_value_get_string (value);
+            key_event_list_set(symbol_search_keys, str);
+        } else if (strcmp(name, "SwitchKeyboardKeys") == 0) {
+            const gchar* str = g_value_get_string (value);
+            key_event_list_set(switch_keyboard_keys, str);
+        } else if (strcmp(name, "TraceKeyEvents") == 0) {
+            trace_enabled = g_value_get_boolean (value);
+        } else if (strcmp(name, "TraceRedact") == 0) {
+            const gchar* str = g_value_get_string (value);
+            trace_redact = trace_redact_from_string (str);
+        } else if (strcmp(name, "UpdateDelay") == 0) {
+            gint delay = g_value_get_int (value);
+            update_delay = CLAMP (delay, 0, 100000);
+        } else if (strcmp(name, "FastPath") == 0) {
+            composer_set_fast_path (g_value_get_boolean (value));
+        } else if (strcmp(name, "StallThreshold") == 0) {
+            gint threshold = g_value_get_int (value);
+
+            // in ms, 0 turns the watchdog off
+            watchdog_log_histogram (watchdog);
+            watchdog_delete (watchdog);
+            watchdog = NULL;
+            if (threshold > 0)
+                watchdog = watchdog_new (MIN (threshold, 60000));
+        } else if (strcmp(name, "CandidateFilter") == 0) {
+            const gchar* str = g_value_get_string (value);
+
+            // Engines keep a reference to the old filter until they
+            // hear of the new one, as do searches in flight.
+            core_filter_unref (candidate_filter);
+            candidate_filter = candidate_filter_new (str);
+            g_free (candidate_filter_str);
+            candidate_filter_str = g_strdup (str);
+        } else if (strcmp(name, "SnippetAutoCommit") == 0) {
+            snippet_auto_commit = g_value_get_boolean (value);
+        } else if (strcmp(name, "LayoutDetect") == 0) {
+            layout_detect = g_value_get_boolean (value);
+        } else if (strcmp(name, "LayoutAutoCorrect") == 0) {
+            layout_auto_correct = g_value_get_boolean (value);
         }
     } else if (strcmp(section, "panel") == 0) {
         if (strcmp(name, "lookup_table_orientation") == 0) {
             lookup_table_orientation = g_value_get_int (value);
         }
     }
+
+    for (l = engine_list; l != NULL; l = l->next)
+        ibus_hangul_engine_config_changed (l->data, section, name);
+}
+
+static const ConfigKey*
+config_key_find (const gchar *section, const gchar *name)
+{
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS (config_keys); i++) {
+        if (strcmp (config_keys[i].section, section) == 0 &&
+            strcmp (config_keys[i].name, name) == 0)
+            return &config_keys[i];
+    }
+
+    return NULL;
+}
+
+/* Sets value to str, a value of key as kept in the snapshot. Returns
+ * FALSE, with value unset, if str is not one. */
+static gboolean
+config_value_from_string (const ConfigKey *key,
+                          const gchar     *str,
+                          GValue          *value)
+{
+    g_value_init (value, key->type);
+
+    if (key->type == G_TYPE_STRING) {
+        g_value_set_string (value, str);
+    } else if (key->type == G_TYPE_BOOLEAN) {
+        if (strcmp (str, "true") == 0) {
+            g_value_set_boolean (value, TRUE);
+        } else if (strcmp (str, "false") == 0) {
+            g_value_set_boolean (value, FALSE);
+        } else {
+            g_value_unset (value);
+            return FALSE;
+        }
+    } else {
+        gchar *end;
+        gint64 n = g_ascii_strtoll (str, &end, 10);
+
+        if (*str == '\0' || *end != '\0') {
+            g_value_unset (value);
+            return FALSE;
+        }
+        g_value_set_int (value, CLAMP (n, G_MININT, G_MAXINT));
+    }
+
+    return TRUE;
+}
+
+/* Stores value in the snapshot. Returns FALSE if the snapshot already
+ * had the same value. */
+static gboolean
+config_snapshot_update (const ConfigKey *key, const GValue *value)
+{
+    gboolean changed = TRUE;
+    gchar *old;
+    gchar *str;
+
+    if (G_VALUE_TYPE (value) != key->type)
+        return TRUE;
+
+    if (key->type == G_TYPE_STRING)
+        str = g_strdup (g_value_get_string (value));
+    else if (key->type == G_TYPE_BOOLEAN)
+        str = g_strdup (g_value_get_boolean (value) ? "true" : "false");
+    else
+        str = g_strdup_printf ("%d", g_value_get_int (value));
+
+    old = g_key_file_get_string (config_snapshot, key->section,
+                                 key->name, NULL);
+    if (old != NULL && strcmp (old, str) == 0) {
+        changed = FALSE;
+    } else {
+        g_key_file_set_string (config_snapshot, key->section, key->name, str);
+        config_snapshot_dirty = TRUE;
+    }
+
+    g_free (old);
+    g_free (str);
+
+    return changed;
+}
+
+static void
+config_snapshot_load (void)
+{
+    guint i;
+
+    config_snapshot = g_key_file_new ();
+    config_snapshot_file = g_build_filename (g_get_user_cache_dir (),
+                                             "ibus-hangul", "config", NULL);
+    config_snapshot_dirty = FALSE;
+
+    if (!g_key_file_load_from_file (config_snapshot, config_snapshot_file,
+                                    G_KEY_FILE_NONE, NULL))
+        return;
+
+    for (i = 0; i < G_N_ELEMENTS (config_keys); i++) {
+        const ConfigKey *key = &config_keys[i];
+        GValue value = { 0, };
+        gchar *str;
+
+        str = g_key_file_get_string (config_snapshot, key->section,
+                                     key->name, NULL);
+        if (str == NULL)
+            continue;
+
+        if (config_value_from_string (key, str, &value)) {
+            ibus_hangul_config_set_value (key->section, key->name, &value);
+            g_value_unset (&value);
+        }
+        g_free (str);
+    }
+}
+
+static void
+config_snapshot_save (void)
+{
+    gchar *data;
+    gchar *dir;
+    gsize length;
+
+    if (config_snapshot == NULL || !config_snapshot_dirty)
+        return;
+
+    dir = g_path_get_dirname (config_snapshot_file);
+    g_mkdir_with_parents (dir, 0700);
+    g_free (dir);
+
+    data = g_key_file_to_data (config_snapshot, &length, NULL);
+    if (g_file_set_contents (config_snapshot_file, data, length, NULL))
+        config_snapshot_dirty = FALSE;
+    g_free (data);
+}
+
+/* Takes the reply to the GetValue call of config_keys[i]. */
+static void
+config_fetch_done (IBusPendingCall *pending, gpointer user_data)
+{
+    guint i = GPOINTER_TO_UINT (user_data);
+    const ConfigKey *key = &config_keys[i];
+    IBusMessage *reply;
+    IBusError *error = NULL;
+    GValue value = { 0, };
+
+    config_fetch_calls[i] = NULL;
+    config_fetch_n_pending--;
+
+    reply = ibus_pending_call_steal_reply (pending);
+    ibus_pending_call_unref (pending);
+
+    watchdog_enter (watchdog, WATCHDOG_PHASE_CONFIG, 0, 0);
+
+    if (reply != NULL) {
+        error = ibus_error_new_from_message (reply);
+        if (error != NULL) {
+            // The key is unset, and back to its default, unless the
+            // service didn't answer at all.
+            if (strcmp (error->name, DBUS_ERROR_NO_REPLY) != 0)
+                config_value_from_string (key, key->default_value, &value);
+            ibus_error_free (error);
+        } else if (!ibus_message_get_args (reply, &error,
+                                           G_TYPE_VALUE, &value,
+                                           G_TYPE_INVALID)) {
+            ibus_error_free (error);
+        }
+        ibus_message_unref (reply);
+    }
+
+    // Only the values that differ from the snapshot are applied.
+    if (G_IS_VALUE (&value)) {
+        if (G_VALUE_TYPE (&value) == key->type &&
+            config_snapshot_update (key, &value))
+            ibus_hangul_config_set_value (key->section, key->name, &value);
+        g_value_unset (&value);
+    }
+
+    if (config_fetch_n_pending == 0)
+        config_snapshot_save ();
+
+    watchdog_leave (watchdog);
+}
+
+static void
+config_fetch_cancel (guint i)
+{
+    if (config_fetch_calls[i] == NULL)
+        return;
+
+    ibus_pending_call_cancel (config_fetch_calls[i]);
+    ibus_pending_call_unref (config_fetch_calls[i]);
+    config_fetch_calls[i] = NULL;
+    config_fetch_n_pending--;
+}
+
+/* Asks for all the keys we use, after start up. IBusConfig has no call
+ * to get several values at once, and ibus_config_get_value() waits for
+ * each reply, so the calls are all sent here and their replies are
+ * taken from the main loop as they come. */
+static gboolean
+config_fetch_all (gpointer user_data)
+{
+    guint i;
+
+    config_fetch_id = 0;
+
+    for (i = 0; i < G_N_ELEMENTS (config_keys); i++) {
+        const ConfigKey *key = &config_keys[i];
+        IBusPendingCall *pending = NULL;
+        IBusError *error = NULL;
+
+        if (!ibus_proxy_call_with_reply ((IBusProxy *) config, "GetValue",
+                                         &pending, -1, &error,
+                                         G_TYPE_STRING, &key->section,
+                                         G_TYPE_STRING, &key->name,
+                                         G_TYPE_INVALID)) {
+            if (error != NULL) {
+                g_warning ("%s: %s", error->name, error->message);
+                ibus_error_free (error);
+            }
+            continue;
+        }
+
+        config_fetch_calls[i] = pending;
+        config_fetch_n_pending++;
+        ibus_pending_call_set_notify (pending, config_fetch_done,
+                                      GUINT_TO_POINTER (i), NULL);
+    }
+
+    return FALSE;
+}
+
+static void
+ibus_config_value_changed (IBusConfig   *config,
+                           const gchar  *section,
+                           const gchar  *name,
+                           GValue       *value,
+                           gpointer      user_data)
+{
+    const ConfigKey *key;
+
+    key = config_key_find (section, name);
+    if (key == NULL || G_VALUE_TYPE (value) != key->type)
+        return;
+
+    // the reply to a fetch still in flight is older
+    config_fetch_cancel (key - config_keys);
+
+    watchdog_enter (watchdog, WATCHDOG_PHASE_CONFIG, 0, 0);
+    if (config_snapshot_update (key, value)) {
+        ibus_hangul_config_set_value (section, name, value);
+        config_snapshot_save ();
+    }
+    watchdog_leave (watchdog);
 }
 
 static void
@@ -981,6 +2763,89 @@ key_event_list_match(GArray* list, guint keyval, guint modifiers)
     return FALSE;
 }
 
+static void
+keyboard_list_set (GPtrArray* list, const char* str)
+{
+    gchar** items;
+
+    g_ptr_array_foreach (list, (GFunc) g_free, NULL);
+    g_ptr_array_set_size (list, 0);
+
+    // The configured default keyboard is always the first one,
+    // so that the switch key cycles back to it.
+    g_ptr_array_add (list, g_strdup (hangul_keyboard->str));
+
+    items = g_strsplit(str, ",", 0);
+    if (items != NULL) {
+        int i;
+        for (i = 0; items[i] != NULL; ++i) {
+            guint j;
+            gboolean dup = FALSE;
+
+            g_strstrip (items[i]);
+            if (items[i][0] == '\0')
+                continue;
+
+            for (j = 0; j < list->len; ++j) {
+                if (strcmp (g_ptr_array_index (list, j), items[i]) == 0) {
+                    dup = TRUE;
+                    break;
+                }
+            }
+
+            if (!dup)
+                g_ptr_array_add (list, g_strdup (items[i]));
+        }
+        g_strfreev(items);
+    }
+}
+
+static void
+hanja_search_func (gpointer data, gpointer user_data)
+{
+    HanjaSearch *search = (HanjaSearch *) data;
+    gint generation;
+
+    // Skip the search if the preedit string has changed while this
+    // request was waiting in the queue.
+    generation = g_atomic_int_get (&search->hangul->hanja_search_generation);
+    if (search->generation == generation) {
+        guint64 start = key_trace_now ();
+
+        search->result = core_dicts_search (search->dicts, search->filter,
+                                            search->key);
+        event_log_add (EVENT_SEARCH, g_utf8_strlen (search->key, -1),
+                       search->result != NULL ?
+                       candidate_list_get_size (search->result) : 0,
+                       key_trace_now () - start);
+    }
+
+    g_idle_add_full (G_PRIORITY_DEFAULT, hanja_search_done, search, NULL);
+}
+
+static gboolean
+hanja_search_done (gpointer data)
+{
+    HanjaSearch *search = (HanjaSearch *) data;
+    IBusHangulEngine *hangul = search->hangul;
+
+    if (search->generation == hangul->hanja_search_generation &&
+        hangul->core != NULL) {
+        core_set_search_result (hangul->core, search->result);
+        search->result = NULL;
+    }
+
+    if (search->result != NULL)
+        candidate_list_delete (search->result);
+    g_free (search->key);
+    core_dicts_unref (search->dicts);
+    core_filter_unref (search->filter);
+    g_object_unref (search->hangul);
+    g_slice_free (HanjaSearch, search);
+
+    return FALSE;
+}
+
 static void
 ibus_hangul_engine_candidate_clicked (IBusEngine     *engine,
                                       guint           index,
@@ -988,18 +2853,128 @@ ibus_hangul_engine_candidate_clicked (IBusEngine     *engine,
                                       guint           state)
 {
     IBusHangulEngine *hangul = (IBusHangulEngine *) engine;
+    guint64 start;
+
     if (hangul == NULL)
 	return;
 
     if (hangul->table == NULL)
 	return;
 
-    ibus_lookup_table_set_cursor_pos (hangul->table, index);
-    ibus_hangul_engine_commit_current_candidate (hangul);
+    start = ibus_hangul_engine_trace_start (hangul);
 
-    if (hangul->hanja_mode) {
-	ibus_hangul_engine_update_lookup_table (hangul);
-    } else {
-	ibus_hangul_engine_hide_lookup_table (hangul);
+    if (hangul->layout_offer)
+        ibus_hangul_engine_correct_layout (hangul, FALSE);
+    else
+        core_select_candidate (hangul->core, index);
+
+    ibus_hangul_engine_trace (hangul, KEY_TRACE_CANDIDATE_CLICKED, index, start);
+}
+
+gboolean
+ibus_hangul_replay_trace (const gchar *filename, gboolean keep_timing)
+{
+    KeyTraceRecord *records;
+    IBusEngine *engine;
+    IBusEngineClass *klass;
+    gchar *keyboard = NULL;
+    guint n_records;
+    guint64 base;
+    guint64 recorded_total = 0;
+    guint64 replayed_total = 0;
+    guint32 recorded_max = 0;
+    guint32 replayed_max = 0;
+    guint slower = 0;
+    guint i;
+
+    records = key_trace_load (filename, &n_records, &keyboard);
+    if (records == NULL) {
+        g_printerr ("%s: not a key trace file\n", filename);
+        return FALSE;
     }
+
+    // An engine without a connection: the updates it sends go nowhere,
+    // but every event takes the same path as in a real session.
+    engine = g_object_new (IBUS_TYPE_HANGUL_ENGINE,
+                           "name", "hangul",
+                           "path", "/org/freedesktop/IBus/Engine/Replay",
+                           NULL);
+    klass = IBUS_ENGINE_GET_CLASS (engine);
+
+    if (keyboard != NULL && keyboard[0] != '\0')
+        core_select_keyboard (((IBusHangulEngine *) engine)->core, keyboard);
+
+    base = key_trace_now ();
+    for (i = 0; i < n_records; i++) {
+        const KeyTraceRecord *r = &records[i];
+        guint64 start;
+        guint32 duration;
+
+        if (keep_timing) {
+            guint64 due = base + (r->time - records[0].time);
+            guint64 now = key_trace_now ();
+            if (due > now)
+                g_usleep (due - now);
+        }
+
+        start = key_trace_now ();
+        switch (r->type) {
+        case KEY_TRACE_KEY:
+            klass->process_key_event (engine, r->keyval, r->keycode,
+                                      r->modifiers);
+            break;
+        case KEY_TRACE_FOCUS_IN:
+            klass->focus_in (engine);
+            break;
+        case KEY_TRACE_FOCUS_OUT:
+            klass->focus_out (engine);
+            break;
+        case KEY_TRACE_RESET:
+            klass->reset (engine);
+            break;
+        case KEY_TRACE_CANDIDATE_CLICKED:
+            klass->candidate_clicked (engine, r->keyval, 1, 0);
+            break;
+        case KEY_TRACE_CURSOR_UP:
+            klass->cursor_up (engine);
+            break;
+        case KEY_TRACE_CURSOR_DOWN:
+            klass->cursor_down (engine);
+            break;
+        default:
+            break;
+        }
+
+        // deliver the results of the hanja searches
+        while (g_main_context_pending (NULL))
+            g_main_context_iteration (NULL, FALSE);
+
+        duration = (guint32) (key_trace_now () - start);
+
+        recorded_total += r->duration;
+        replayed_total += duration;
+        recorded_max = MAX (recorded_max, r->duration);
+        replayed_max = MAX (replayed_max, duration);
+        if (duration > 2 * r->duration + 1000) {
+            slower++;
+            g_print ("event %u: type %u keyval 0x%x took %uus, "
+                     "recorded %uus\n",
+                     i, r->type, r->keyval, duration, r->duration);
+        }
+    }
+
+    g_print ("%u events, keyboard %s\n", n_records,
+             keyboard != NULL ? keyboard : "?");
+    g_print ("recorded: total %" G_GUINT64_FORMAT "us, max %uus\n",
+             recorded_total, recorded_max);
+    g_print ("replayed: total %" G_GUINT64_FORMAT "us, max %uus\n",
+             replayed_total, replayed_max);
+    g_print ("%u events more than twice as slow as recorded\n", slower);
+
+    ibus_object_destroy ((IBusObject *) engine);
+    g_object_unref (engine);
+    g_free (keyboard);
+    g_free (records);
+
+    return TRUE;
 }
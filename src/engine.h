@@ -12,4 +12,17 @@ GType   ibus_hangul_engine_get_type    (void);
 void    ibus_hangul_init (IBusBus *bus);
 void    ibus_hangul_exit (void);
 
+/* Sets how many destroyed engines keep their input context, lookup
+ * table and properties for the next engine to reuse. */
+void    ibus_hangul_engine_set_pool_size (guint size);
+
+/* How many times the engines registered their properties with the
+ * panel, for the tests. */
+guint   ibus_hangul_engine_get_n_registrations (void);
+
+/* Feeds a key trace recorded with TraceKeyEvents through an engine that
+ * is not connected to the bus, and prints the handling times. */
+gboolean ibus_hangul_replay_trace (const gchar *filename,
+                                   gboolean     keep_timing);
+
 #endif
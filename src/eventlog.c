@@ -0,0 +1,235 @@
+/* vim:set et sts=4: */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "eventlog.h"
+
+/* events kept, a power of two: 128KB */
+#define EVENT_LOG_SIZE  4096
+
+typedef struct _EventRecord EventRecord;
+
+struct _EventRecord {
+    /* the number of the event plus one, set once it is written */
+    volatile gint  serial;
+    guint32        type;
+    guint32        args[3];
+    guint64        time;    /* ns, monotonic */
+};
+
+typedef struct _EventTypeInfo EventTypeInfo;
+
+struct _EventTypeInfo {
+    const gchar *name;
+    /* NULL for args not used; a name ending in "0x" is shown in hex */
+    const gchar *args[3];
+};
+
+static const EventTypeInfo event_types[EVENT_N_TYPES] = {
+    { "key",            { " keyval=0x", " modifiers=0x", " handled=" } },
+    { "focus-in",       { NULL, } },
+    { "focus-out",      { NULL, } },
+    { "reset",          { NULL, } },
+    { "hangul-mode",    { " on=", } },
+    { "hanja-mode",     { " on=", } },
+    { "symbol-search",  { " on=", } },
+    { "search",         { " chars=", " candidates=", " us=" } },
+    { "preedit",        { " length=", " fixed=", } },
+    { "commit",         { " length=", } },
+    { "lookup-table",   { " candidates=", " cursor=", } },
+    { "lookup-cursor",  { " cursor=", } },
+    { "lookup-hide",    { NULL, } },
+    { "dicts",          { " version=", } },
+    { "layout",         { " mode=", " keys=", " corrected=" } },
+};
+
+static EventRecord   event_ring[EVENT_LOG_SIZE];
+/* the number of the next event */
+static volatile gint event_head = 0;
+
+/* where the log goes on SIGUSR2, empty for stderr */
+static gchar            dump_file[1024] = "";
+static gboolean         handler_installed = FALSE;
+static struct sigaction old_action;
+
+static guint64
+event_log_now (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (guint64) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void
+event_log_add (EventType type, guint32 a, guint32 b, guint32 c)
+{
+    EventRecord *record;
+    guint n;
+
+    // Writers only race for the slot. The serial is set last, so a
+    // reader knows the record is whole; see event_log_dump() for one
+    // overwritten while it is read.
+    n = (guint) g_atomic_int_exchange_and_add (&event_head, 1);
+    record = &event_ring[n & (EVENT_LOG_SIZE - 1)];
+
+    record->type = type;
+    record->args[0] = a;
+    record->args[1] = b;
+    record->args[2] = c;
+    record->time = event_log_now ();
+    g_atomic_int_set (&record->serial, n + 1);
+}
+
+/* The dump runs in a signal handler, so it can't use printf() or
+ * allocate: the lines are put together by hand. */
+static gchar*
+append_str (gchar *p, const gchar *str)
+{
+    while (*str != '\0')
+        *p++ = *str++;
+    return p;
+}
+
+static gchar*
+append_uint (gchar *p, guint64 value, guint base, guint min_digits)
+{
+    gchar digits[24];
+    guint n = 0;
+
+    do {
+        digits[n++] = "0123456789abcdef"[value % base];
+        value /= base;
+    } while (value != 0 || n < min_digits);
+
+    while (n > 0)
+        *p++ = digits[--n];
+    return p;
+}
+
+static void
+write_all (gint fd, const gchar *buf, gsize len)
+{
+    while (len > 0) {
+        gssize res = write (fd, buf, len);
+
+        if (res < 0) {
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+        buf += res;
+        len -= res;
+    }
+}
+
+void
+event_log_dump (gint fd)
+{
+    gchar line[160];
+    gchar *p;
+    guint64 now = event_log_now ();
+    guint head = (guint) g_atomic_int_get (&event_head);
+    guint n;
+
+    p = append_str (line, "# ");
+    p = append_uint (p, head, 10, 1);
+    p = append_str (p, " events, the last ones below; seconds before "
+                       "the dump\n");
+    write_all (fd, line, p - line);
+
+    for (n = head > EVENT_LOG_SIZE ? head - EVENT_LOG_SIZE : 0;
+         n != head; n++) {
+        EventRecord *record = &event_ring[n & (EVENT_LOG_SIZE - 1)];
+        const EventTypeInfo *info;
+        EventRecord copy;
+        guint64 ago;
+        guint i;
+
+        if ((guint) g_atomic_int_get (&record->serial) != n + 1)
+            continue;
+        copy = *record;
+
+        // A writer may have taken the slot for a newer event meanwhile,
+        // and the copy may be half of each then.
+        if ((guint) g_atomic_int_get (&event_head) - n > EVENT_LOG_SIZE ||
+            copy.type >= EVENT_N_TYPES)
+            continue;
+
+        info = &event_types[copy.type];
+        ago = now > copy.time ? (now - copy.time) / 1000 : 0;
+
+        p = append_str (line, "-");
+        p = append_uint (p, ago / G_USEC_PER_SEC, 10, 1);
+        p = append_str (p, ".");
+        p = append_uint (p, ago % G_USEC_PER_SEC, 10, 6);
+        p = append_str (p, " ");
+        p = append_str (p, info->name);
+        for (i = 0; i < 3 && info->args[i] != NULL; i++) {
+            gsize len = strlen (info->args[i]);
+            gboolean hex = len > 2 && strcmp (info->args[i] + len - 2,
+                                              "0x") == 0;
+
+            p = append_str (p, info->args[i]);
+            p = append_uint (p, copy.args[i], hex ? 16 : 10, 1);
+        }
+        p = append_str (p, "\n");
+        write_all (fd, line, p - line);
+    }
+}
+
+static void
+event_log_signal_handler (int signum)
+{
+    gint saved_errno = errno;
+    gint fd = 2;
+
+    if (dump_file[0] != '\0')
+        fd = open (dump_file, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+
+    if (fd >= 0) {
+        event_log_dump (fd);
+        if (fd != 2)
+            close (fd);
+    }
+
+    errno = saved_errno;
+}
+
+void
+event_log_init (const gchar *filename)
+{
+    struct sigaction action;
+
+    dump_file[0] = '\0';
+    if (filename != NULL)
+        g_strlcpy (dump_file, filename, sizeof (dump_file));
+
+    if (handler_installed)
+        return;
+
+    memset (&action, 0, sizeof (action));
+    action.sa_handler = event_log_signal_handler;
+    action.sa_flags = SA_RESTART;
+    sigemptyset (&action.sa_mask);
+    if (sigaction (SIGUSR2, &action, &old_action) == 0)
+        handler_installed = TRUE;
+}
+
+void
+event_log_cleanup (void)
+{
+    if (!handler_installed)
+        return;
+
+    sigaction (SIGUSR2, &old_action, NULL);
+    handler_installed = FALSE;
+}
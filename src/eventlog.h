@@ -0,0 +1,55 @@
+/* vim:set et sts=4: */
+#ifndef __EVENT_LOG_H__
+#define __EVENT_LOG_H__
+
+#include <glib.h>
+
+/* The event log is a flight recorder for the engine: the last events it
+ * handled and what it did about them, in a fixed ring in memory. Adding
+ * an event takes a clock read and a few stores, with no lock and no
+ * formatting, so the log is always on. It is written out as text on
+ * SIGUSR2, e.g. "pkill -USR2 ibus-engine-hangul", so a problem in the
+ * field can be looked at without restarting with logging enabled.
+ *
+ * Any thread can add events. */
+typedef enum {
+    /* a: keyval, b: modifiers, c: handled */
+    EVENT_KEY = 0,
+    EVENT_FOCUS_IN,
+    EVENT_FOCUS_OUT,
+    EVENT_RESET,
+    /* a: on */
+    EVENT_HANGUL_MODE,
+    EVENT_HANJA_MODE,
+    EVENT_SYMBOL_SEARCH,
+    /* a: characters of the key, b: candidates, c: µs */
+    EVENT_SEARCH,
+    /* a: characters, b: of those, composed already */
+    EVENT_PREEDIT,
+    EVENT_COMMIT,
+    /* a: candidates, b: cursor */
+    EVENT_LOOKUP_TABLE,
+    EVENT_LOOKUP_CURSOR,
+    EVENT_LOOKUP_HIDE,
+    /* a: version */
+    EVENT_DICTS,
+    /* a: the mode the word looks typed for, b: its keys, c: corrected,
+     * else offered */
+    EVENT_LAYOUT,
+    EVENT_N_TYPES
+} EventType;
+
+/* Sets where event_log_dump() writes on SIGUSR2: filename, or stderr if
+ * it is NULL. */
+void    event_log_init      (const gchar    *filename);
+void    event_log_cleanup   (void);
+
+void    event_log_add       (EventType       type,
+                             guint32         a,
+                             guint32         b,
+                             guint32         c);
+
+/* Writes the events, oldest first, to fd. Safe in a signal handler. */
+void    event_log_dump      (gint            fd);
+
+#endif
@@ -0,0 +1,289 @@
+/* vim:set et sts=4: */
+#include <string.h>
+#include <hangul.h>
+
+#include "fuzzyindex.h"
+
+/* Longer keys are neither indexed nor searched. They are rare and
+ * would make the per key work unbounded. */
+#define FUZZY_MAX_JAMO          16
+/* Upper bounds of the work done by one search, so a query stays
+ * within a fixed latency budget however the dictionary grows. */
+#define FUZZY_MAX_POSTINGS      1024
+#define FUZZY_MAX_KEYS          32
+
+typedef struct _FuzzyPosting FuzzyPosting;
+
+struct _FuzzyPosting {
+    guint32 hash;
+    guint32 key_id;
+};
+
+struct _FuzzyIndex {
+    const DictTrie   *trie;
+    FuzzyPosting     *postings;
+    guint             n_postings;
+};
+
+static guint
+jamo_decompose (const gchar *str, ucschar *jamo, guint size)
+{
+    guint n = 0;
+
+    while (*str != '\0') {
+        ucschar c = g_utf8_get_char (str);
+
+        if (c >= 0xac00 && c <= 0xd7a3) {
+            guint s = c - 0xac00;
+            guint t = s % 28;
+
+            if (n + 3 > size)
+                return size + 1;
+            jamo[n++] = 0x1100 + s / 588;
+            jamo[n++] = 0x1161 + (s % 588) / 28;
+            if (t != 0)
+                jamo[n++] = 0x11a7 + t;
+        } else {
+            if (n + 1 > size)
+                return size + 1;
+            jamo[n++] = c;
+        }
+        str = g_utf8_next_char (str);
+    }
+
+    return n;
+}
+
+/* FNV-1a over the jamo string with the jamo at skip left out */
+static guint32
+jamo_hash (const ucschar *jamo, guint len, guint skip)
+{
+    guint32 h = 2166136261u;
+    guint i;
+
+    for (i = 0; i < len; ++i) {
+        if (i == skip)
+            continue;
+        h ^= jamo[i];
+        h *= 16777619u;
+    }
+
+    return h;
+}
+
+/* optimal string alignment distance, so that swapped jamo count as one */
+static guint
+jamo_distance (const ucschar *a, guint alen, const ucschar *b, guint blen)
+{
+    guint d[FUZZY_MAX_JAMO + 1][FUZZY_MAX_JAMO + 1];
+    guint i, j;
+
+    for (i = 0; i <= alen; ++i)
+        d[i][0] = i;
+    for (j = 0; j <= blen; ++j)
+        d[0][j] = j;
+
+    for (i = 1; i <= alen; ++i) {
+        for (j = 1; j <= blen; ++j) {
+            guint cost = a[i - 1] == b[j - 1] ? 0 : 1;
+            guint v = MIN (d[i - 1][j] + 1, d[i][j - 1] + 1);
+
+            v = MIN (v, d[i - 1][j - 1] + cost);
+            if (i > 1 && j > 1 &&
+                a[i - 1] == b[j - 2] && a[i - 2] == b[j - 1])
+                v = MIN (v, d[i - 2][j - 2] + 1);
+            d[i][j] = v;
+        }
+    }
+
+    return d[alen][blen];
+}
+
+static gint
+fuzzy_posting_compare (gconstpointer a, gconstpointer b)
+{
+    const FuzzyPosting *p1 = (const FuzzyPosting *) a;
+    const FuzzyPosting *p2 = (const FuzzyPosting *) b;
+
+    if (p1->hash != p2->hash)
+        return p1->hash < p2->hash ? -1 : 1;
+    if (p1->key_id != p2->key_id)
+        return p1->key_id < p2->key_id ? -1 : 1;
+    return 0;
+}
+
+static gint
+key_id_compare (gconstpointer a, gconstpointer b)
+{
+    guint k1 = *(const guint *) a;
+    guint k2 = *(const guint *) b;
+
+    return k1 < k2 ? -1 : (k1 > k2);
+}
+
+static void
+fuzzy_posting_add (GArray *postings, guint32 hash, guint key_id)
+{
+    FuzzyPosting p = { hash, key_id };
+    g_array_append_val (postings, p);
+}
+
+FuzzyIndex*
+fuzzy_index_new (const DictTrie *trie)
+{
+    FuzzyIndex *index;
+    GArray *postings;
+    GString *key;
+    guint n_keys;
+    guint i, j, n;
+
+    if (trie == NULL)
+        return NULL;
+
+    key = g_string_new (NULL);
+    n_keys = dict_trie_get_n_keys (trie);
+    postings = g_array_sized_new (FALSE, FALSE, sizeof (FuzzyPosting),
+                                  n_keys * 6);
+
+    for (i = 0; i < n_keys; ++i) {
+        ucschar jamo[FUZZY_MAX_JAMO];
+        guint len;
+
+        dict_trie_get_key (trie, i, key);
+        len = jamo_decompose (key->str, jamo, FUZZY_MAX_JAMO);
+        if (len == 0 || len > FUZZY_MAX_JAMO)
+            continue;
+
+        fuzzy_posting_add (postings, jamo_hash (jamo, len, len), i);
+        for (j = 0; j < len; ++j) {
+            // deleting either jamo of a doubled pair gives the same string
+            if (j > 0 && jamo[j] == jamo[j - 1])
+                continue;
+            fuzzy_posting_add (postings, jamo_hash (jamo, len, j), i);
+        }
+    }
+
+    g_array_sort (postings, fuzzy_posting_compare);
+
+    // drop duplicates
+    n = 0;
+    for (i = 0; i < postings->len; ++i) {
+        FuzzyPosting *p = &g_array_index (postings, FuzzyPosting, i);
+        if (n > 0 && fuzzy_posting_compare (p,
+                    &g_array_index (postings, FuzzyPosting, n - 1)) == 0)
+            continue;
+        g_array_index (postings, FuzzyPosting, n++) = *p;
+    }
+    g_array_set_size (postings, n);
+    g_string_free (key, TRUE);
+
+    index = g_new (FuzzyIndex, 1);
+    index->trie = trie;
+    index->n_postings = postings->len;
+    index->postings = (FuzzyPosting *) g_array_free (postings, FALSE);
+
+    return index;
+}
+
+void
+fuzzy_index_delete (FuzzyIndex *index)
+{
+    if (index == NULL)
+        return;
+
+    g_free (index->postings);
+    g_free (index);
+}
+
+static guint
+fuzzy_index_lower_bound (const FuzzyIndex *index, guint32 hash)
+{
+    guint low = 0;
+    guint high = index->n_postings;
+
+    while (low < high) {
+        guint mid = low + (high - low) / 2;
+        if (index->postings[mid].hash < hash)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    return low;
+}
+
+void
+fuzzy_index_search (const FuzzyIndex *index,
+                    const DictMask   *mask,
+                    const gchar      *key,
+                    CandidateList    *list)
+{
+    ucschar query[FUZZY_MAX_JAMO];
+    guint32 hashes[FUZZY_MAX_JAMO + 1];
+    guint n_hashes = 0;
+    guint query_len;
+    guint key_len;
+    guint n_keys = 0;
+    guint visited = 0;
+    GArray *key_ids;
+    GString *match_key;
+    guint i, j;
+
+    if (index == NULL)
+        return;
+
+    query_len = jamo_decompose (key, query, FUZZY_MAX_JAMO);
+    if (query_len == 0 || query_len > FUZZY_MAX_JAMO)
+        return;
+
+    hashes[n_hashes++] = jamo_hash (query, query_len, query_len);
+    for (i = 0; i < query_len; ++i) {
+        if (i > 0 && query[i] == query[i - 1])
+            continue;
+        hashes[n_hashes++] = jamo_hash (query, query_len, i);
+    }
+
+    key_ids = g_array_new (FALSE, FALSE, sizeof (guint));
+    for (i = 0; i < n_hashes && visited < FUZZY_MAX_POSTINGS; ++i) {
+        for (j = fuzzy_index_lower_bound (index, hashes[i]);
+             j < index->n_postings && index->postings[j].hash == hashes[i];
+             ++j) {
+            guint key_id = index->postings[j].key_id;
+            g_array_append_val (key_ids, key_id);
+            if (++visited >= FUZZY_MAX_POSTINGS)
+                break;
+        }
+    }
+
+    g_array_sort (key_ids, key_id_compare);
+
+    key_len = g_utf8_strlen (key, -1);
+    match_key = g_string_new (NULL);
+    for (i = 0; i < key_ids->len && n_keys < FUZZY_MAX_KEYS; ++i) {
+        guint key_id = g_array_index (key_ids, guint, i);
+        ucschar jamo[FUZZY_MAX_JAMO];
+        guint len;
+
+        // the same key is usually hit through several deletions
+        if (i > 0 && g_array_index (key_ids, guint, i - 1) == key_id)
+            continue;
+
+        // A shared deletion is also two edits at most, e.g. two changed
+        // jamo, and distance 0 is an exact match, which the caller
+        // already has.
+        dict_trie_get_key (index->trie, key_id, match_key);
+        len = jamo_decompose (match_key->str, jamo, FUZZY_MAX_JAMO);
+        if (len > FUZZY_MAX_JAMO ||
+            jamo_distance (query, query_len, jamo, len) != 1)
+            continue;
+
+        // The whole reading is replaced, whatever the length
+        // of the key it was corrected to.
+        if (dict_trie_append_entries (index->trie, mask, key_id, NULL,
+                                      key_len, list) > 0)
+            n_keys++;
+    }
+
+    g_string_free (match_key, TRUE);
+    g_array_free (key_ids, TRUE);
+}
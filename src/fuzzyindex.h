@@ -0,0 +1,34 @@
+/* vim:set et sts=4: */
+#ifndef __FUZZY_INDEX_H__
+#define __FUZZY_INDEX_H__
+
+#include <glib.h>
+
+#include "dicttrie.h"
+#include "candidate.h"
+
+/* FuzzyIndex finds dictionary keys that are one jamo edit away from a
+ * reading, e.g. 항국 -> 한국: a jamo put in, left out, changed, or two
+ * next to each other swapped. Keys are decomposed into jamo and indexed
+ * by the hashes of all their one-jamo deletions. A query generates its
+ * own one-jamo deletions, so every key within one edit is found without
+ * scanning the dictionary, and is verified with the real edit distance.
+ *
+ * Keys two edits away are not searched: finding all of them would take
+ * the two-jamo deletions of every key, many times the postings, and the
+ * short strings left after two deletions are shared by so many keys
+ * that a search could no longer stay within its budget. */
+typedef struct _FuzzyIndex FuzzyIndex;
+
+FuzzyIndex* fuzzy_index_new         (const DictTrie   *trie);
+void        fuzzy_index_delete      (FuzzyIndex       *index);
+
+/* Appends the entries of the keys one edit away from key to list, in
+ * the order of the keys. Only the entries that pass mask are taken, see
+ * dict_trie_append_entries(). */
+void        fuzzy_index_search      (const FuzzyIndex *index,
+                                     const DictMask   *mask,
+                                     const gchar      *key,
+                                     CandidateList    *list);
+
+#endif
@@ -0,0 +1,256 @@
+/* vim:set et sts=4: */
+#include <string.h>
+#include <time.h>
+
+#include "keytrace.h"
+
+#define KEY_TRACE_MAGIC         "IHKT"
+#define KEY_TRACE_VERSION       1
+#define KEY_TRACE_RECORD_SIZE   24
+#define KEY_TRACE_HEADER_SIZE   32
+
+struct _KeyTrace {
+    KeyTraceRecord *ring;
+    guint           capacity;
+    guint64         count;      /* records appended so far */
+    guint64         saved;      /* value of count at the last save */
+    guint64         start;
+    KeyTraceRedact  redact;
+    gchar           keyboard[8];
+};
+
+KeyTrace*
+key_trace_new (guint capacity, KeyTraceRedact redact, const gchar *keyboard)
+{
+    KeyTrace *trace;
+
+    g_return_val_if_fail (capacity > 0, NULL);
+
+    trace = g_new0 (KeyTrace, 1);
+    trace->ring = g_new0 (KeyTraceRecord, capacity);
+    trace->capacity = capacity;
+    trace->start = key_trace_now ();
+    trace->redact = redact;
+    if (keyboard != NULL)
+        strncpy (trace->keyboard, keyboard, sizeof (trace->keyboard) - 1);
+
+    return trace;
+}
+
+void
+key_trace_delete (KeyTrace *trace)
+{
+    if (trace == NULL)
+        return;
+
+    g_free (trace->ring);
+    g_free (trace);
+}
+
+guint64
+key_trace_now (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (guint64) ts.tv_sec * G_USEC_PER_SEC + ts.tv_nsec / 1000;
+}
+
+static guint
+key_trace_redact_keyval (KeyTraceRedact redact, guint keyval)
+{
+    if (redact == KEY_TRACE_REDACT_ALL)
+        return 0;
+
+    if (redact == KEY_TRACE_REDACT_TEXT && keyval >= 0x20 && keyval < 0x7f) {
+        if (keyval >= 'a' && keyval <= 'z')
+            return 'a';
+        if (keyval >= 'A' && keyval <= 'Z')
+            return 'A';
+        if (keyval >= '0' && keyval <= '9')
+            return '0';
+        if (keyval == ' ')
+            return ' ';
+        return '.';
+    }
+
+    return keyval;
+}
+
+void
+key_trace_append (KeyTrace          *trace,
+                  KeyTraceEventType  type,
+                  guint              keyval,
+                  guint              keycode,
+                  guint              modifiers,
+                  gboolean           handled,
+                  guint64            start)
+{
+    KeyTraceRecord *r;
+    guint64 now;
+
+    now = key_trace_now ();
+    r = &trace->ring[trace->count % trace->capacity];
+
+    r->time = start - trace->start;
+    r->duration = (guint32) MIN (now - start, G_MAXUINT32);
+    r->type = type;
+    r->flags = handled ? KEY_TRACE_HANDLED : 0;
+    r->modifiers = modifiers;
+
+    if (type == KEY_TRACE_KEY) {
+        r->keyval = key_trace_redact_keyval (trace->redact, keyval);
+        r->keycode = trace->redact == KEY_TRACE_REDACT_NONE ? keycode : 0;
+    } else {
+        r->keyval = keyval;
+        r->keycode = 0;
+    }
+
+    trace->count++;
+}
+
+static void
+put_uint16 (guint8 *p, guint16 v)
+{
+    p[0] = v & 0xff;
+    p[1] = (v >> 8) & 0xff;
+}
+
+static void
+put_uint32 (guint8 *p, guint32 v)
+{
+    put_uint16 (p, v & 0xffff);
+    put_uint16 (p + 2, v >> 16);
+}
+
+static void
+put_uint64 (guint8 *p, guint64 v)
+{
+    put_uint32 (p, v & 0xffffffff);
+    put_uint32 (p + 4, v >> 32);
+}
+
+static guint16
+get_uint16 (const guint8 *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static guint32
+get_uint32 (const guint8 *p)
+{
+    return get_uint16 (p) | ((guint32) get_uint16 (p + 2) << 16);
+}
+
+static guint64
+get_uint64 (const guint8 *p)
+{
+    return get_uint32 (p) | ((guint64) get_uint32 (p + 4) << 32);
+}
+
+gboolean
+key_trace_save (KeyTrace *trace, const gchar *filename)
+{
+    guint8 *buf;
+    guint8 *p;
+    guint64 first;
+    guint n;
+    guint64 i;
+    gsize size;
+    gboolean res;
+
+    if (trace->count == trace->saved)
+        return TRUE;
+
+    n = (guint) MIN (trace->count, trace->capacity);
+    first = trace->count - n;
+
+    size = KEY_TRACE_HEADER_SIZE + n * KEY_TRACE_RECORD_SIZE;
+    buf = g_malloc0 (size);
+
+    // header: magic, version, record size, number of records,
+    // number of records lost to the ring, redaction, keyboard id
+    memcpy (buf, KEY_TRACE_MAGIC, 4);
+    put_uint16 (buf + 4, KEY_TRACE_VERSION);
+    put_uint16 (buf + 6, KEY_TRACE_RECORD_SIZE);
+    put_uint32 (buf + 8, n);
+    put_uint64 (buf + 12, first);
+    put_uint32 (buf + 20, trace->redact);
+    memcpy (buf + 24, trace->keyboard, sizeof (trace->keyboard));
+
+    p = buf + KEY_TRACE_HEADER_SIZE;
+    for (i = first; i < trace->count; ++i) {
+        const KeyTraceRecord *r = &trace->ring[i % trace->capacity];
+
+        put_uint64 (p, r->time);
+        put_uint32 (p + 8, r->duration);
+        put_uint32 (p + 12, r->keyval);
+        put_uint32 (p + 16, r->modifiers);
+        put_uint16 (p + 20, r->keycode);
+        p[22] = r->type;
+        p[23] = r->flags;
+        p += KEY_TRACE_RECORD_SIZE;
+    }
+
+    res = g_file_set_contents (filename, (const gchar *) buf, size, NULL);
+    if (res)
+        trace->saved = trace->count;
+
+    g_free (buf);
+
+    return res;
+}
+
+KeyTraceRecord*
+key_trace_load (const gchar *filename, guint *n_records, gchar **keyboard)
+{
+    gchar *contents;
+    gsize size;
+    const guint8 *p;
+    KeyTraceRecord *records;
+    guint n;
+    guint i;
+
+    if (!g_file_get_contents (filename, &contents, &size, NULL))
+        return NULL;
+
+    p = (const guint8 *) contents;
+    if (size < KEY_TRACE_HEADER_SIZE ||
+        memcmp (p, KEY_TRACE_MAGIC, 4) != 0 ||
+        get_uint16 (p + 4) != KEY_TRACE_VERSION ||
+        get_uint16 (p + 6) != KEY_TRACE_RECORD_SIZE) {
+        g_free (contents);
+        return NULL;
+    }
+
+    n = get_uint32 (p + 8);
+    if ((size - KEY_TRACE_HEADER_SIZE) / KEY_TRACE_RECORD_SIZE < n) {
+        g_free (contents);
+        return NULL;
+    }
+
+    if (keyboard != NULL)
+        *keyboard = g_strndup ((const gchar *) p + 24, 8);
+
+    records = g_new (KeyTraceRecord, MAX (n, 1));
+    p += KEY_TRACE_HEADER_SIZE;
+    for (i = 0; i < n; ++i) {
+        KeyTraceRecord *r = &records[i];
+
+        r->time = get_uint64 (p);
+        r->duration = get_uint32 (p + 8);
+        r->keyval = get_uint32 (p + 12);
+        r->modifiers = get_uint32 (p + 16);
+        r->keycode = get_uint16 (p + 20);
+        r->type = p[22];
+        r->flags = p[23];
+        p += KEY_TRACE_RECORD_SIZE;
+    }
+
+    g_free (contents);
+
+    if (n_records != NULL)
+        *n_records = n;
+
+    return records;
+}
@@ -0,0 +1,75 @@
+/* vim:set et sts=4: */
+#ifndef __KEY_TRACE_H__
+#define __KEY_TRACE_H__
+
+#include <glib.h>
+
+/* KeyTrace records the events an engine handles, with a monotonic time
+ * stamp and the time spent handling each of them, in a fixed size ring
+ * in memory. The ring is written to a compact binary file on demand,
+ * and can be read back for replay. */
+typedef struct _KeyTrace KeyTrace;
+typedef struct _KeyTraceRecord KeyTraceRecord;
+
+typedef enum {
+    KEY_TRACE_KEY = 0,
+    KEY_TRACE_FOCUS_IN,
+    KEY_TRACE_FOCUS_OUT,
+    KEY_TRACE_RESET,
+    KEY_TRACE_CANDIDATE_CLICKED,
+    KEY_TRACE_CURSOR_UP,
+    KEY_TRACE_CURSOR_DOWN
+} KeyTraceEventType;
+
+typedef enum {
+    /* record keyvals as they are */
+    KEY_TRACE_REDACT_NONE = 0,
+    /* replace printable keyvals, keeping only the letter case and
+     * whether the key is a letter, digit or other printable character */
+    KEY_TRACE_REDACT_TEXT,
+    /* drop every keyval and keycode, keeping only the timing */
+    KEY_TRACE_REDACT_ALL,
+} KeyTraceRedact;
+
+#define KEY_TRACE_HANDLED   (1 << 0)
+
+/* 24 bytes on disk, little endian */
+struct _KeyTraceRecord {
+    guint64 time;       /* µs since the trace was started */
+    guint32 duration;   /* µs spent handling the event */
+    guint32 keyval;     /* keyval, or candidate index */
+    guint32 modifiers;
+    guint16 keycode;
+    guint8  type;       /* KeyTraceEventType */
+    guint8  flags;      /* KEY_TRACE_HANDLED */
+};
+
+KeyTrace*       key_trace_new       (guint              capacity,
+                                     KeyTraceRedact     redact,
+                                     const gchar       *keyboard);
+void            key_trace_delete    (KeyTrace          *trace);
+
+/* monotonic clock in µs */
+guint64         key_trace_now       (void);
+
+/* start is the key_trace_now() value taken before handling the event */
+void            key_trace_append    (KeyTrace          *trace,
+                                     KeyTraceEventType  type,
+                                     guint              keyval,
+                                     guint              keycode,
+                                     guint              modifiers,
+                                     gboolean           handled,
+                                     guint64            start);
+
+/* Writes the records in the ring, oldest first, if any were added since
+ * the last save. */
+gboolean        key_trace_save      (KeyTrace          *trace,
+                                     const gchar       *filename);
+
+/* Returns the records of a trace file, or NULL. keyboard receives the
+ * keyboard id the trace was recorded with. */
+KeyTraceRecord* key_trace_load      (const gchar       *filename,
+                                     guint             *n_records,
+                                     gchar            **keyboard);
+
+#endif
@@ -0,0 +1,321 @@
+/* vim:set et sts=4: */
+#ifndef __KSX1001_H__
+#define __KSX1001_H__
+
+/* The characters of KS X 1001, with ASCII, as in EUC-KR: 8225
+ * characters, 4888 of them hanja. They are given in pages of 256 code
+ * points, a bit for each, for the pages that have any. Made from the
+ * EUC-KR decoder of Python's codecs. */
+
+#define KSX1001_N_PAGES  145
+
+static const guint16 ksx1001_page_numbers[KSX1001_N_PAGES] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26,
+    0x30, 0x31, 0x32, 0x33, 0x4e, 0x4f, 0x50, 0x51, 0x52, 0x53, 0x54, 0x55,
+    0x56, 0x57, 0x58, 0x59, 0x5a, 0x5b, 0x5c, 0x5d, 0x5e, 0x5f, 0x60, 0x61,
+    0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x6b, 0x6c, 0x6d,
+    0x6e, 0x6f, 0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79,
+    0x7a, 0x7b, 0x7c, 0x7d, 0x7e, 0x7f, 0x80, 0x81, 0x82, 0x83, 0x84, 0x85,
+    0x86, 0x87, 0x88, 0x89, 0x8a, 0x8b, 0x8c, 0x8d, 0x8e, 0x8f, 0x90, 0x91,
+    0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0x9b, 0x9c, 0x9d,
+    0x9e, 0x9f, 0xac, 0xad, 0xae, 0xaf, 0xb0, 0xb1, 0xb2, 0xb3, 0xb4, 0xb5,
+    0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xbb, 0xbc, 0xbd, 0xbe, 0xbf, 0xc0, 0xc1,
+    0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xcb, 0xcc, 0xcd,
+    0xce, 0xcf, 0xd0, 0xd1, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xf9, 0xfa,
+    0xff,
+};
+
+static const guint32 ksx1001_pages[KSX1001_N_PAGES][8] = {
+    { 0x00000000, 0xffffffff, 0xffffffff, 0x7fffffff,
+      0x00000000, 0xf7df6592, 0xc1810040, 0x41810040 },
+    { 0x00020000, 0x810e00c0, 0x000c0e07, 0x000000c0,
+      0x00000000, 0x00000000, 0x00000000, 0x00000000 },
+    { 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+      0x00000000, 0x00000000, 0x2f010080, 0x00000000 },
+    { 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+      0xfffe0000, 0xfffe03fb, 0x000003fb, 0x00000000 },
+    { 0xffff0002, 0xffffffff, 0x0002ffff, 0x00000000,
+      0x00000000, 0x00000000, 0x00000000, 0x00000000 },
+    { 0x33200000, 0x080d0063, 0x00000000, 0x80100000,
+      0x0000001e, 0x00001000, 0x00000000, 0x00000000 },
+    { 0x00480208, 0x00000846, 0x78180000, 0x03ff03ff,
+      0x03ff0000, 0x00000000, 0x00140000, 0x00000000 },
+    { 0x6402898d, 0x30305fa1, 0x00040000, 0x00000c33,
+      0x020000cc, 0x00000020, 0x00000000, 0x00000000 },
+    { 0x00040000, 0x00000000, 0x00000000, 0x00000000,
+      0x00000000, 0x00000000, 0x00000000, 0x00000000 },
+    { 0x00000000, 0x00000000, 0x00000000, 0xfff07fff,
+      0xf0000007, 0x003fffff, 0xffff0000, 0x000003ff },
+    { 0xfffff00f, 0xffffffff, 0x00000fff, 0x00000000,
+      0x00040000, 0x30cc03fb, 0x0003c9c3, 0x00000000 },
+    { 0x5000c060, 0x00000000, 0x00000005, 0x000037bb,
+      0x00000000, 0x00000000, 0x00000000, 0x00000000 },
+    { 0x003bff0f, 0x00000000, 0xfffffffe, 0xffffffff,
+      0x000fffff, 0xfffffffe, 0xffffffff, 0x007fffff },
+    { 0x00000000, 0xfffe0000, 0xffffffff, 0xffffffef,
+      0x00007fff, 0x00000000, 0x00000000, 0x00000000 },
+    { 0x1fffffff, 0x00000000, 0x00000000, 0x8fffffff,
+      0x00000000, 0x00000000, 0x00000000, 0x00000000 },
+    { 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+      0xffffff1f, 0xffffffff, 0x394987ff, 0x00000000 },
+    { 0x43722f8b, 0x0b042000, 0xe340e82c, 0x40c82800,
+      0x49375944, 0x04407976, 0xa3f02c93, 0x08c50038 },
+    { 0x0003ee02, 0x35508000, 0x1e23e1c8, 0xc4498200,
+      0x2942ad5a, 0x8060c000, 0xa49a461c, 0x052ac003 },
+    { 0xd6462a44, 0x08003dda, 0x14208388, 0x01700020,
+      0x03022021, 0x40ac3000, 0x44628620, 0x8a0020a0 },
+    { 0x80040253, 0x14840402, 0x10047bfb, 0x11e27fa4,
+      0x00a42441, 0x20c01421, 0x70003a50, 0x27430002 },
+    { 0x208245c9, 0x0fc14630, 0x28503c88, 0xa0248602,
+      0x88062388, 0x40000e19, 0xeb6422aa, 0xcd28001c },
+    { 0x02e1a120, 0x8200840b, 0x549e279b, 0xa0b38141,
+      0x85080010, 0x08002061, 0x08d02f08, 0x010fbe3e },
+    { 0xa803f718, 0x5b080a41, 0x00020504, 0x382a0500,
+      0x00015041, 0x21081910, 0x00000313, 0x04046122 },
+    { 0x100140d0, 0x40228000, 0x40488050, 0x10000008,
+      0x370006d1, 0x00005e80, 0x941000a0, 0x60000018 },
+    { 0x00900240, 0x00548000, 0x00080000, 0x00100900,
+      0x00000040, 0x10105020, 0x4c022400, 0x06010001 },
+    { 0x814c2918, 0x08012100, 0x00036485, 0x10214452,
+      0x00080904, 0x0000000d, 0x80004988, 0x16910001 },
+    { 0x40000765, 0x04338492, 0x45928c00, 0x52200016,
+      0xd0080228, 0x4c084300, 0xc32a40a2, 0x2e009810 },
+    { 0x16708000, 0x40826e84, 0x04b3c390, 0x21187c85,
+      0x02c8041c, 0x4a001120, 0x361b0a48, 0x89005540 },
+    { 0x9902000a, 0x10400221, 0x04000242, 0x00000044,
+      0x0c040000, 0x00000010, 0x00001216, 0x00000242 },
+    { 0x00401a20, 0x00000400, 0xb5b30009, 0x15230a18,
+      0x1fe89ba0, 0x8379507c, 0xc09d10fd, 0x0560dbf6 },
+    { 0x0242ef92, 0xdf020110, 0x08226961, 0x02029035,
+      0x00030000, 0x45aa1a02, 0x02000001, 0x28518101 },
+    { 0x02d26080, 0x00000280, 0x00011800, 0x00009200,
+      0x20000880, 0x35000405, 0x60442000, 0x609e49e6 },
+    { 0x2a42104c, 0xa1482820, 0x802010b1, 0x7b9c000e,
+      0x14a08490, 0x41e028c1, 0x8c490704, 0x0cc8100d },
+    { 0x89ba8412, 0x142202c0, 0x0ac05500, 0x92833ec4,
+      0x43871ca3, 0x22a04703, 0x03c03028, 0xa0200801 },
+    { 0x30448000, 0x000085a3, 0x2225200e, 0x0001b73c,
+      0x8c503220, 0x315d0099, 0x940200a0, 0x0e4b0003 },
+    { 0x8c20e342, 0xd0910080, 0xa3281d94, 0x60c1499c,
+      0x07134406, 0x44445a90, 0x00000f88, 0x95c40040 },
+    { 0x84477581, 0xc0534402, 0x01082b83, 0x92424000,
+      0x09a60611, 0x32220800, 0x1bddb384, 0xc08af000 },
+    { 0x00020282, 0x6c008800, 0x00219200, 0x8c844180,
+      0x09441308, 0x000007a7, 0x0c418051, 0x00d06002 },
+    { 0x10d0a000, 0x44003004, 0x01000000, 0x07008201,
+      0x440e0100, 0x08056830, 0x051464b2, 0x441410e6 },
+    { 0x21000011, 0xcbc09c08, 0x40c2e120, 0x41b4304c,
+      0x9a8310ac, 0x328198b2, 0x00849822, 0xbc123369 },
+    { 0xc03bd6c0, 0x0c53a1a1, 0xea008a1e, 0x05d8cbf0,
+      0x21c34390, 0x4a1c4805, 0x324002d0, 0xd79d0041 },
+    { 0xe8b02b09, 0x24527dc0, 0xd04bc240, 0xc8aba000,
+      0x34a98a80, 0x41c98000, 0x241f8010, 0x487b9200 },
+    { 0x00cc0000, 0x33008406, 0x001b410f, 0x80402000,
+      0xa0988022, 0x006ba186, 0x85a42a30, 0x06044181 },
+    { 0x00046021, 0xa0010080, 0x46b80400, 0x03a0e90f,
+      0x18200000, 0x081040a0, 0x0001380a, 0xa8000500 },
+    { 0xc28a0404, 0x2720000a, 0x830c0910, 0x00000802,
+      0x10806211, 0x0808000c, 0x0c08000c, 0x08400000 },
+    { 0x00441410, 0x6404000b, 0x800150c0, 0x8984047e,
+      0x41400658, 0x94a4c000, 0x09dca862, 0x00001800 },
+    { 0x000a8100, 0x41900008, 0xe4a14007, 0x64452501,
+      0x0e7d11ee, 0xfb084800, 0x08a81616, 0x0009c92e },
+    { 0x4a821800, 0x6b6406a0, 0x16000002, 0x83905648,
+      0x002a73a0, 0x00248000, 0x470288f9, 0x0faa4d02 },
+    { 0x8e800000, 0x7554b87b, 0xd9402418, 0x040cc880,
+      0xb0410000, 0x04428c24, 0x001a5a34, 0xc1108000 },
+    { 0x00328046, 0x8106180d, 0xcd920002, 0x74016014,
+      0x00916112, 0x420ac098, 0x8420040f, 0x40029a13 },
+    { 0xfd228a62, 0x40808188, 0x21031000, 0x31010808,
+      0x07044420, 0x0388b812, 0xa3008900, 0x22020000 },
+    { 0x46001210, 0x00410042, 0x52415680, 0x200052f0,
+      0x82148610, 0x46021004, 0x8035430a, 0xd80060e0 },
+    { 0x08010041, 0x6c653400, 0xab0411c1, 0x22040286,
+      0x00000003, 0x00009084, 0x02814015, 0x33000202 },
+    { 0x38400400, 0xc0c00e20, 0x00850030, 0x0d250500,
+      0x81d04ad0, 0x020c2280, 0x6240b605, 0x62802679 },
+    { 0x080802ea, 0x8579dd67, 0xdea0081b, 0x40008735,
+      0xd1000a8c, 0xa22505aa, 0x15108440, 0x0080404d },
+    { 0x8d220012, 0x058f1968, 0x3a1a9080, 0x85618464,
+      0x2002ccc0, 0x732e0820, 0x0b3420a4, 0x14150004 },
+    { 0x82002001, 0x08000057, 0x00445004, 0x79051212,
+      0x000940d0, 0x84004000, 0xd844054c, 0x5114409a },
+    { 0x40000b12, 0x15800201, 0x08002001, 0xc200084a,
+      0x40020800, 0x98093020, 0x18800000, 0x0008e22c },
+    { 0x00040004, 0x001410e0, 0x20008020, 0x10009800,
+      0x00827082, 0x1c000288, 0x00014c22, 0x08209100 },
+    { 0x00404002, 0x44001c00, 0x7cc10383, 0x84002121,
+      0x0002e002, 0xe20a44c0, 0x81260e03, 0x080002d0 },
+    { 0x96902921, 0xb8c24001, 0x00806241, 0xa6510a06,
+      0x812c0112, 0x0400c600, 0xa2800cb0, 0x8640a429 },
+    { 0x4a028000, 0x02003041, 0x0057ba40, 0x20205001,
+      0x24b08880, 0x01122002, 0x000402d3, 0x00000211 },
+    { 0x40040080, 0xe0000c82, 0x00003008, 0x00081011,
+      0x81a40208, 0x420e40a0, 0xc0400400, 0x48000081 },
+    { 0x0f912df5, 0x0629d807, 0x4001007c, 0x824e4546,
+      0x1008c000, 0xed363005, 0x65400c80, 0x0810930b },
+    { 0xe8200600, 0x6082c80a, 0x403400ca, 0x12012e02,
+      0x19489004, 0x00000000, 0x00000000, 0x00000000 },
+    { 0x00000000, 0x05400000, 0x00311000, 0x02a54c00,
+      0x44105520, 0x23040310, 0x80345422, 0x12010a03 },
+    { 0x01a1126b, 0xa0482000, 0x45400448, 0xe08d8000,
+      0x28401af0, 0x04168626, 0x4c005018, 0x21120032 },
+    { 0x0d0005e4, 0x42008a08, 0x00334800, 0x87030860,
+      0x34008501, 0xe4280109, 0x81002045, 0x5c1825a8 },
+    { 0xd80435a0, 0x02e01c02, 0x020000a1, 0x4146c050,
+      0xa6046800, 0xbb8af260, 0xc8b60000, 0x600200e2 },
+    { 0x0080023e, 0x03728900, 0x00068681, 0x08880000,
+      0x41404600, 0x20000e04, 0x10481622, 0x22178a00 },
+    { 0x00007418, 0x21021200, 0x08800200, 0x0420984a,
+      0x12110000, 0x99040002, 0x04022a55, 0x10105000 },
+    { 0x459a0000, 0xa000b02a, 0x0208420a, 0x00002708,
+      0x08128090, 0x04018740, 0x3020e202, 0x8c800630 },
+    { 0x04c004c4, 0x80002000, 0xd8314000, 0x02000080,
+      0x00081400, 0x00000218, 0x8a100880, 0x40002010 },
+    { 0x1500010d, 0x00000000, 0x80a04000, 0x01500140,
+      0x80002004, 0x04080004, 0x00000010, 0x4a049001 },
+    { 0x80000020, 0x0842000c, 0x2a8c3041, 0xc085090e,
+      0x40c42906, 0x00100800, 0xb2308006, 0x21380102 },
+    { 0x030d0080, 0x09400420, 0x80000012, 0x80040410,
+      0x004888ca, 0x24040602, 0x00040001, 0x01100008 },
+    { 0xa9c8550d, 0x0c522428, 0x48310000, 0x022f624d,
+      0x412830a0, 0xd205057b, 0x1844a894, 0x45c26cc2 },
+    { 0x2ed14017, 0x02081901, 0x1500c202, 0x20919040,
+      0x044d0401, 0x00000000, 0x00000000, 0x00000000 },
+    { 0x00000000, 0x80800000, 0x04201542, 0x06000c02,
+      0x60001404, 0xb9d99f87, 0x540a059f, 0x3810245d },
+    { 0x004825b0, 0x00000000, 0x00000000, 0x00990850,
+      0x02000420, 0x44080108, 0x28009840, 0x0008810a },
+    { 0x40018400, 0x00210400, 0x82000794, 0x00500001,
+      0x00002482, 0x00001c00, 0x80043c01, 0x49000800 },
+    { 0xf83c0228, 0xcb0886c0, 0xa0006230, 0x00000004,
+      0x18000000, 0x0007a148, 0x00124024, 0x22852c40 },
+    { 0xe6b3a96f, 0x5126400f, 0x723b6c86, 0xb5a4e20b,
+      0x0222859f, 0x0123854c, 0x40000402, 0x20202102 },
+    { 0x02240004, 0x00042080, 0x00047e00, 0x01a01604,
+      0x10042a80, 0x0032d800, 0x3183fa81, 0x00200488 },
+    { 0x40872000, 0x84100000, 0x48800221, 0x00000074,
+      0x114a0029, 0x02c80000, 0x00049000, 0x11000410 },
+    { 0xc5010010, 0x0000c957, 0x08102d00, 0x50204000,
+      0x04501000, 0x00013088, 0x40020008, 0x00400012 },
+    { 0x01000010, 0x01200820, 0x08060010, 0xa0000000,
+      0x00000000, 0x00000000, 0x00000000, 0x00000000 },
+    { 0x00000000, 0x00000000, 0x00000000, 0x00800000,
+      0x011e8a09, 0x18022138, 0x10700480, 0x00000006 },
+    { 0x10000000, 0x88044402, 0xf8013815, 0x21e9041c,
+      0x1b306c60, 0x08820588, 0x1a607af3, 0x0ac5870c },
+    { 0x524a00c1, 0x22050080, 0x50420114, 0x04902206,
+      0x0000a800, 0x00002901, 0x10080840, 0x88480000 },
+    { 0x018f156f, 0x0b012000, 0x45107040, 0x000088a0,
+      0x00000000, 0x00028100, 0x98000090, 0x7010e006 },
+    { 0x41091608, 0x00000101, 0x00963a20, 0x00000000,
+      0x22400000, 0x021a7120, 0xa2270002, 0x80022000 },
+    { 0x0200c102, 0x00c10800, 0x8ca02029, 0x00000624,
+      0x00000000, 0x01000100, 0x01180000, 0x00004020 },
+    { 0x04000000, 0x10020480, 0x0410803e, 0x00008000,
+      0x80024000, 0x00004800, 0x00400200, 0x00000110 },
+    { 0x00252000, 0x08040020, 0x00800280, 0x00000000,
+      0x00000000, 0x00000000, 0x00000000, 0x005802a0 },
+    { 0x08000200, 0x08000140, 0x20020000, 0x00041003,
+      0x00000000, 0x00108200, 0x00800010, 0x07040000 },
+    { 0x44000000, 0x00000000, 0x00000000, 0xa2200000,
+      0xa08c0000, 0x48300020, 0x59126008, 0x00100100 },
+    { 0x00084180, 0x08000001, 0x80044c00, 0x00801482,
+      0x10212000, 0x00000000, 0x00000000, 0x00000000 },
+    { 0x3eff0793, 0x1303b011, 0x11102801, 0x05930000,
+      0xb0111e7b, 0x3b019703, 0x00a01112, 0x306b9593 },
+    { 0x1102b051, 0x11303201, 0x011102b0, 0xb879300a,
+      0x30011306, 0x00800010, 0x100b0113, 0x93000011 },
+    { 0x00102b03, 0x05930000, 0xb051746b, 0x3b011323,
+      0x00001030, 0x70000000, 0x1303b011, 0x11102900 },
+    { 0x00012180, 0xb0153000, 0x3001030e, 0x02000030,
+      0x10230111, 0x13000000, 0x10106b81, 0x01130300 },
+    { 0x30111013, 0x00000100, 0x22b85530, 0x30000000,
+      0x9702b011, 0x113afb07, 0x011303b0, 0x00000021 },
+    { 0x3b0d1b00, 0x03b01138, 0x11330113, 0x13000001,
+      0x111c2b05, 0x00000100, 0xb0111000, 0x2a011300 },
+    { 0x02b01930, 0x10100001, 0x11000000, 0x10300301,
+      0x07130230, 0x0011146b, 0x2b051300, 0x8fb8f974 },
+    { 0x103b0113, 0x00000000, 0xd9700000, 0x01134ab0,
+      0x0011103b, 0x00001103, 0x2ab15930, 0x10000111 },
+    { 0x11010000, 0x00100b01, 0x01130000, 0x0000102b,
+      0x20000101, 0x02a01110, 0x30210111, 0x0102b059 },
+    { 0x19300000, 0x011307b0, 0xb011383b, 0x00000003,
+      0x00000000, 0x383b0d13, 0x0103b011, 0x00001000 },
+    { 0x01130000, 0x00101020, 0x00000100, 0x00000110,
+      0x30000000, 0x00021811, 0x00100000, 0x01110000 },
+    { 0x00000023, 0x0b019300, 0x00301110, 0x302b0111,
+      0x13c7b011, 0x01303b01, 0x00000280, 0xb0113000 },
+    { 0x2b011383, 0x03b01130, 0x300a0011, 0x1102b011,
+      0x00002000, 0x01110100, 0xa011102b, 0x2b011302 },
+    { 0x01000010, 0x30000001, 0x13029011, 0x11302b01,
+      0x000066b0, 0xb0113000, 0x6b07d302, 0x07b0113a },
+    { 0x00200103, 0x13000000, 0x11386b05, 0x011303b0,
+      0x000010b8, 0x2b051b00, 0x03000110, 0x10000000 },
+    { 0x1102a011, 0x79700a01, 0x0111a2b0, 0x0000100a,
+      0x00011100, 0x00901110, 0x00090111, 0x93000000 },
+    { 0xf9f2bb05, 0x011322b0, 0x2001323b, 0x00000000,
+      0x06b05930, 0x303b0193, 0x1123a011, 0x11700000 },
+    { 0x001102b0, 0x00001010, 0x03011301, 0x00000110,
+      0x162b0793, 0x01010010, 0x11300000, 0x01110200 },
+    { 0xb0113029, 0x00000000, 0x0eb05130, 0x383b0513,
+      0x0303b011, 0x00000100, 0x01930000, 0x00001039 },
+    { 0x3b000302, 0x00000000, 0x00230113, 0x00000000,
+      0x00100000, 0x00010000, 0x90113020, 0x00000002 },
+    { 0x00000000, 0x10000000, 0x11020000, 0x00000301,
+      0x01130000, 0xb079b02b, 0x3b011323, 0x02b01130 },
+    { 0xf0210111, 0x1343b0d9, 0x11303b01, 0x011103b0,
+      0xb0517020, 0x20011322, 0x01901110, 0x300b0111 },
+    { 0x9302b011, 0x0016ab01, 0x01130100, 0xb0113021,
+      0x29010302, 0x02b03130, 0x30000000, 0x1b42b819 },
+    { 0x11383301, 0x00000330, 0x00000020, 0x33051300,
+      0x00001110, 0x00000000, 0x93000001, 0x01302305 },
+    { 0x00010100, 0x30111010, 0x00000100, 0x02301130,
+      0x10100001, 0x11000000, 0x00000000, 0x85130200 },
+    { 0x10111003, 0x2b011300, 0x63b87730, 0x303b0113,
+      0x11a2b091, 0x7b300201, 0x011357f0, 0xf0d1702b },
+    { 0x1b0111e3, 0x0ab97130, 0x303b0113, 0x13029001,
+      0x11302b01, 0x071302b0, 0x3011302b, 0x23011303 },
+    { 0x02b01130, 0x30ab0113, 0x11feb411, 0x71300901,
+      0x05d347b8, 0xb011307b, 0x21015303, 0x00001110 },
+    { 0x306b0513, 0x1102b011, 0x00103301, 0x05130000,
+      0xa01038eb, 0x30000102, 0x02b01110, 0x30200013 },
+    { 0x0102b071, 0x00101000, 0x01130000, 0x1011100b,
+      0x2b011300, 0x00000000, 0x366b0593, 0x1303b095 },
+    { 0x01103b01, 0x00000200, 0xb0113000, 0x20000103,
+      0x01000010, 0x30000000, 0x030ab011, 0x00101001 },
+    { 0x01110100, 0x00000003, 0x23011302, 0x03000010,
+      0x10000000, 0x01000000, 0x00100000, 0x00000290 },
+    { 0x30113000, 0x7b015386, 0x03b01130, 0x00210151,
+      0x13000000, 0x11303b01, 0x001102b0, 0x00011010 },
+    { 0x2b011302, 0x02001110, 0x10000000, 0x0102b011,
+      0x11300100, 0x000102b0, 0x00011010, 0x2b011100 },
+    { 0x02101110, 0x002b0113, 0x93000000, 0x11302b03,
+      0x011302b0, 0x0000303b, 0x00000002, 0x03b01930 },
+    { 0x102b0113, 0x0103b011, 0x11300000, 0x011302b0,
+      0x00001021, 0x00010102, 0x00000010, 0x102b0113 },
+    { 0x01020011, 0x11302000, 0x011102b0, 0x30113001,
+      0x00000002, 0x02b01130, 0x303b0313, 0x0103b011 },
+    { 0x00002000, 0x05130000, 0xb011303b, 0x10001102,
+      0x00000110, 0x142b0113, 0x01000001, 0x01100000 },
+    { 0x00010280, 0xb0113000, 0x10000102, 0x00000010,
+      0x10230113, 0x93021011, 0x11100b05, 0x01130030 },
+    { 0xb051702b, 0x3b011323, 0x00000030, 0x30000000,
+      0x1303b011, 0x11102b01, 0x01010330, 0xb011300a },
+    { 0x20000102, 0x00000000, 0x10000011, 0x9300a011,
+      0x00102b05, 0x00000200, 0x90111000, 0x29011100 },
+    { 0x00b01110, 0x30000000, 0x1302b011, 0x11302b21,
+      0x000103b0, 0x00000020, 0x2b051300, 0x02b01130 },
+    { 0x103b0113, 0x13002011, 0x11322b21, 0x00130280,
+      0xa0113028, 0x0a011102, 0x02921130, 0x30210111 },
+    { 0x13020011, 0x11302b01, 0x03d30290, 0x3011122b,
+      0x2b011302, 0x00000000, 0x00000000, 0x00000000 },
+    { 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+      0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff },
+    { 0x00000fff, 0x00000000, 0x00000000, 0x00000000,
+      0x00000000, 0x00000000, 0x00000000, 0x00000000 },
+    { 0xfffffffe, 0xffffffff, 0x7fffffff, 0x00000000,
+      0x00000000, 0x00000000, 0x00000000, 0x0000006f },
+};
+
+#endif
@@ -0,0 +1,337 @@
+/* vim:set et sts=4: */
+#include <math.h>
+#include <string.h>
+
+#include "layoutdetect.h"
+
+/* the keys of the models: the start of a word, then a to z */
+#define LAYOUT_N_SYMBOLS    27
+#define LAYOUT_TABLE_SIZE   (LAYOUT_N_SYMBOLS * LAYOUT_N_SYMBOLS * \
+                             LAYOUT_N_SYMBOLS)
+/* costs are in these fractions of a bit */
+#define LAYOUT_COST_SCALE   8
+
+/* a saved model is this line, then the Hangul and the Latin costs */
+#define LAYOUT_MODEL_MAGIC  "ibus-hangul layout model 1\n"
+
+enum {
+    MODEL_HANGUL,
+    MODEL_LATIN,
+};
+
+struct _LayoutModel {
+    /* the cost of key c after a and b is at (a * 27 + b) * 27 + c */
+    guint8 cost[2][LAYOUT_TABLE_SIZE];
+};
+
+struct _LayoutDetector {
+    const LayoutModel *model;
+    /* in costs */
+    gint               threshold;
+    /* the last two keys, as symbols */
+    guint              prev[2];
+    /* the Latin cost of the word less its Hangul cost */
+    gint               score;
+    gboolean           stopped;
+    guint              n_keys;
+    guint              keys[LAYOUT_WORD_MAX];
+};
+
+/* The 2-set keys of the compatibility jamo, U+3131 to U+3163. */
+static const gchar * const jamo_keys[] = {
+    "r",  "R",  "rt", "s",  "sw", "sg", "e",  "E",  "f",  "fr", "fa",
+    "fq", "ft", "fx", "fv", "fg", "a",  "q",  "Q",  "qt", "t",  "T",
+    "d",  "w",  "W",  "c",  "z",  "x",  "v",  "g",
+    "k",  "o",  "i",  "O",  "j",  "p",  "u",  "P",  "h",  "hk", "ho",
+    "hl", "y",  "n",  "nj", "np", "nl", "b",  "m",  "ml", "l",
+};
+
+/* the compatibility jamo of the initial and final consonants of the
+ * syllables, in the order of their indices; the vowels are in the same
+ * order in both */
+static const gunichar choseong_jamo[19] = {
+    0x3131, 0x3132, 0x3134, 0x3137, 0x3138, 0x3139, 0x3141, 0x3142,
+    0x3143, 0x3145, 0x3146, 0x3147, 0x3148, 0x3149, 0x314a, 0x314b,
+    0x314c, 0x314d, 0x314e,
+};
+
+static const gunichar jongseong_jamo[28] = {
+    0,      0x3131, 0x3132, 0x3133, 0x3134, 0x3135, 0x3136, 0x3137,
+    0x3139, 0x313a, 0x313b, 0x313c, 0x313d, 0x313e, 0x313f, 0x3140,
+    0x3141, 0x3142, 0x3144, 0x3145, 0x3146, 0x3147, 0x3148, 0x314a,
+    0x314b, 0x314c, 0x314d, 0x314e,
+};
+
+static guint
+layout_symbol (guint keyval)
+{
+    if (keyval >= 'a' && keyval <= 'z')
+        return keyval - 'a' + 1;
+    if (keyval >= 'A' && keyval <= 'Z')
+        return keyval - 'A' + 1;
+    return 0;
+}
+
+gboolean
+layout_append_keys (GString *keys, gunichar c)
+{
+    if (c >= 0x3131 && c <= 0x3163) {
+        g_string_append (keys, jamo_keys[c - 0x3131]);
+        return TRUE;
+    }
+
+    if (c >= 0xac00 && c <= 0xd7a3) {
+        guint index = c - 0xac00;
+
+        layout_append_keys (keys, choseong_jamo[index / (21 * 28)]);
+        layout_append_keys (keys, 0x314f + index / 28 % 21);
+        if (index % 28 != 0)
+            layout_append_keys (keys, jongseong_jamo[index % 28]);
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+gchar**
+layout_split_words (const gchar *text, gboolean latin)
+{
+    GPtrArray *words;
+    GString *word;
+    const gchar *p;
+
+    words = g_ptr_array_new ();
+    word = g_string_new (NULL);
+
+    for (p = text; ; p = g_utf8_next_char (p)) {
+        gunichar c = g_utf8_get_char (p);
+        gboolean in_word;
+
+        if (latin) {
+            in_word = c < 0x80 && g_ascii_isalpha (c);
+            if (in_word)
+                g_string_append_c (word, c);
+        } else {
+            in_word = layout_append_keys (word, c);
+        }
+
+        if (!in_word && word->len > 0) {
+            g_ptr_array_add (words, g_strdup (word->str));
+            g_string_truncate (word, 0);
+        }
+
+        if (c == 0)
+            break;
+    }
+
+    g_string_free (word, TRUE);
+    g_ptr_array_add (words, NULL);
+
+    return (gchar **) g_ptr_array_free (words, FALSE);
+}
+
+/* Fills costs with a model of words: the trigram probabilities are
+ * mixed with the bigram ones, and those with the unigram ones, so a key
+ * never seen after two others still gets a fair cost. */
+static void
+layout_model_fill (guint8 *costs, gchar **words)
+{
+    const guint n = LAYOUT_N_SYMBOLS;
+    guint32 *count3, *count2, *count1;
+    guint32 *total3, *total2, total1;
+    guint a, b, c;
+    gchar **w;
+
+    count3 = g_new0 (guint32, n * n * n);
+    count2 = g_new0 (guint32, n * n);
+    count1 = g_new0 (guint32, n);
+    total3 = g_new0 (guint32, n * n);
+    total2 = g_new0 (guint32, n);
+    total1 = 0;
+
+    for (w = words; *w != NULL; ++w) {
+        const gchar *p;
+
+        a = b = 0;
+        for (p = *w; *p != '\0'; ++p) {
+            c = layout_symbol ((guchar) *p);
+            if (c == 0)
+                break;
+
+            count3[(a * n + b) * n + c]++;
+            total3[a * n + b]++;
+            count2[b * n + c]++;
+            total2[b]++;
+            count1[c]++;
+            total1++;
+            a = b;
+            b = c;
+        }
+    }
+
+    for (a = 0; a < n; ++a) {
+        for (b = 0; b < n; ++b) {
+            // Nothing comes after the start, so its costs are unused.
+            costs[(a * n + b) * n] = 0;
+
+            for (c = 1; c < n; ++c) {
+                gdouble p;
+                gdouble cost;
+
+                p = (count1[c] + 1.0) / (total1 + n - 1);
+                if (total2[b] > 0)
+                    p = 0.7 * count2[b * n + c] / total2[b] + 0.3 * p;
+                if (total3[a * n + b] > 0)
+                    p = 0.7 * count3[(a * n + b) * n + c] /
+                        total3[a * n + b] + 0.3 * p;
+
+                cost = floor (-log2 (p) * LAYOUT_COST_SCALE + 0.5);
+                costs[(a * n + b) * n + c] = CLAMP (cost, 1, 255);
+            }
+        }
+    }
+
+    g_free (count3);
+    g_free (count2);
+    g_free (count1);
+    g_free (total3);
+    g_free (total2);
+}
+
+LayoutModel*
+layout_model_train (gchar **hangul_words, gchar **latin_words)
+{
+    LayoutModel *model;
+
+    model = g_new (LayoutModel, 1);
+    layout_model_fill (model->cost[MODEL_HANGUL], hangul_words);
+    layout_model_fill (model->cost[MODEL_LATIN], latin_words);
+
+    return model;
+}
+
+LayoutModel*
+layout_model_load (const gchar *filename)
+{
+    LayoutModel *model;
+    gchar *contents;
+    gsize length;
+    gsize header = strlen (LAYOUT_MODEL_MAGIC);
+
+    if (!g_file_get_contents (filename, &contents, &length, NULL))
+        return NULL;
+
+    if (length != header + sizeof (model->cost) ||
+        memcmp (contents, LAYOUT_MODEL_MAGIC, header) != 0) {
+        g_free (contents);
+        return NULL;
+    }
+
+    model = g_new (LayoutModel, 1);
+    memcpy (model->cost, contents + header, sizeof (model->cost));
+    g_free (contents);
+
+    return model;
+}
+
+gboolean
+layout_model_save (const LayoutModel *model, const gchar *filename)
+{
+    GString *contents;
+    gboolean res;
+
+    contents = g_string_new (LAYOUT_MODEL_MAGIC);
+    g_string_append_len (contents, (const gchar *) model->cost,
+                         sizeof (model->cost));
+    res = g_file_set_contents (filename, contents->str, contents->len,
+                               NULL);
+    g_string_free (contents, TRUE);
+
+    return res;
+}
+
+void
+layout_model_delete (LayoutModel *model)
+{
+    g_free (model);
+}
+
+LayoutDetector*
+layout_detector_new (const LayoutModel *model)
+{
+    LayoutDetector *detector;
+
+    detector = g_new (LayoutDetector, 1);
+    detector->model = model;
+    layout_detector_set_threshold (detector, LAYOUT_THRESHOLD_DEFAULT);
+    layout_detector_reset (detector);
+
+    return detector;
+}
+
+void
+layout_detector_delete (LayoutDetector *detector)
+{
+    g_free (detector);
+}
+
+void
+layout_detector_set_threshold (LayoutDetector *detector, guint threshold)
+{
+    detector->threshold = threshold * LAYOUT_COST_SCALE;
+}
+
+void
+layout_detector_reset (LayoutDetector *detector)
+{
+    detector->prev[0] = 0;
+    detector->prev[1] = 0;
+    detector->score = 0;
+    detector->stopped = FALSE;
+    detector->n_keys = 0;
+}
+
+void
+layout_detector_stop (LayoutDetector *detector)
+{
+    detector->stopped = TRUE;
+}
+
+LayoutGuess
+layout_detector_push (LayoutDetector *detector, guint keyval)
+{
+    const LayoutModel *model = detector->model;
+    guint c = layout_symbol (keyval);
+    guint i;
+
+    if (detector->stopped)
+        return LAYOUT_UNSURE;
+
+    if (c == 0 || detector->n_keys == LAYOUT_WORD_MAX) {
+        detector->stopped = TRUE;
+        return LAYOUT_UNSURE;
+    }
+
+    i = (detector->prev[0] * LAYOUT_N_SYMBOLS + detector->prev[1]) *
+        LAYOUT_N_SYMBOLS + c;
+    detector->score += (gint) model->cost[MODEL_LATIN][i] -
+                       (gint) model->cost[MODEL_HANGUL][i];
+    detector->prev[0] = detector->prev[1];
+    detector->prev[1] = c;
+    detector->keys[detector->n_keys++] = keyval;
+
+    if (detector->n_keys < LAYOUT_MIN_KEYS)
+        return LAYOUT_UNSURE;
+    if (detector->score >= detector->threshold)
+        return LAYOUT_HANGUL;
+    if (detector->score <= -detector->threshold)
+        return LAYOUT_LATIN;
+    return LAYOUT_UNSURE;
+}
+
+const guint*
+layout_detector_get_keys (const LayoutDetector *detector, guint *n_keys)
+{
+    *n_keys = detector->n_keys;
+    return detector->keys;
+}
@@ -0,0 +1,78 @@
+/* vim:set et sts=4: */
+#ifndef __LAYOUT_DETECT_H__
+#define __LAYOUT_DETECT_H__
+
+#include <glib.h>
+
+/* LayoutDetector tells, as the letters of a word are typed, whether the
+ * keys look like Hangul typed on the 2-set keyboard or like Latin text,
+ * so a word typed in the wrong mode, e.g. "dkssud" for 안녕, can be
+ * caught before it is finished.
+ *
+ * A LayoutModel has two trigram models over the keys, one of Hangul and
+ * one of Latin text: the 26 letters with the case folded, and the start
+ * of a word. Each holds, for every key after every two, what the key
+ * costs in eighths of a bit, -log2 of its probability, in a byte: 2 *
+ * 27^3 bytes in all. The detector keeps the difference of the costs of
+ * the word so far, so a key costs two table lookups however long the
+ * word is. A model is read only once made, and is shared between the
+ * detectors.
+ *
+ * The models are made from corpora offline, by ibus-hangul-bench-layout,
+ * which also tells how well they do. */
+typedef struct _LayoutModel LayoutModel;
+typedef struct _LayoutDetector LayoutDetector;
+
+typedef enum {
+    LAYOUT_UNSURE = 0,
+    LAYOUT_HANGUL,
+    LAYOUT_LATIN,
+} LayoutGuess;
+
+/* the longest word followed; the keys of a longer one are let go */
+#define LAYOUT_WORD_MAX             24
+/* the fewest keys a guess is made on */
+#define LAYOUT_MIN_KEYS             3
+/* how much likelier, in bits, one model has to find the word than the
+ * other for a guess */
+#define LAYOUT_THRESHOLD_DEFAULT    12
+
+/* Returns the 2-set keys of the Hangul words of text, case kept, e.g.
+ * "dkssud" for 안녕, or with latin the words of its Latin letters. The
+ * words are split at any other character. Free with g_strfreev(). */
+gchar**         layout_split_words          (const gchar         *text,
+                                             gboolean             latin);
+/* Appends the 2-set keys of c, a syllable or a compatibility jamo, to
+ * keys. Returns FALSE if c is neither. */
+gboolean        layout_append_keys          (GString             *keys,
+                                             gunichar             c);
+
+/* Trains a model on the keys of words of each kind, as split above. */
+LayoutModel*    layout_model_train          (gchar              **hangul_words,
+                                             gchar              **latin_words);
+/* Reads a model saved with layout_model_save(), or returns NULL. */
+LayoutModel*    layout_model_load           (const gchar         *filename);
+gboolean        layout_model_save           (const LayoutModel   *model,
+                                             const gchar         *filename);
+void            layout_model_delete         (LayoutModel         *model);
+
+LayoutDetector* layout_detector_new         (const LayoutModel   *model);
+void            layout_detector_delete      (LayoutDetector      *detector);
+/* in bits, LAYOUT_THRESHOLD_DEFAULT to start with */
+void            layout_detector_set_threshold
+                                            (LayoutDetector      *detector,
+                                             guint                threshold);
+/* A new word starts. */
+void            layout_detector_reset       (LayoutDetector      *detector);
+/* The rest of the word is let go: no guess is made until the next
+ * reset. */
+void            layout_detector_stop        (LayoutDetector      *detector);
+/* Adds keyval, an ASCII letter, to the word. Returns what the word
+ * looks like so far. */
+LayoutGuess     layout_detector_push        (LayoutDetector      *detector,
+                                             guint                keyval);
+/* The keys of the word so far, as pushed. */
+const guint*    layout_detector_get_keys    (const LayoutDetector *detector,
+                                             guint               *n_keys);
+
+#endif
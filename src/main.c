@@ -10,6 +10,7 @@
 
 #include "i18n.h"
 #include "engine.h"
+#include "eventlog.h"
 
 
 static IBusBus *bus = NULL;
@@ -18,11 +19,15 @@ static IBusFactory *factory = NULL;
 /* options */
 static gboolean ibus = FALSE;
 static gboolean verbose = FALSE;
+static gchar   *replay = NULL;
+static gboolean replay_fast = FALSE;
 
 static const GOptionEntry entries[] =
 {
     { "ibus", 'i', 0, G_OPTION_ARG_NONE, &ibus, "component is executed by ibus", NULL },
-    { "verbose", 'v', 0, G_OPTION_ARG_NONE, &verbose, "verbose", NULL },
+    { "verbose", 'v', 0, G_OPTION_ARG_NONE, &verbose, "write the event log to stderr, on SIGUSR2 and at exit", NULL },
+    { "replay", 0, 0, G_OPTION_ARG_FILENAME, &replay, "replay a key trace offline", "FILE" },
+    { "replay-fast", 0, 0, G_OPTION_ARG_NONE, &replay_fast, "replay without the recorded delays", NULL },
     { NULL },
 };
 
@@ -36,12 +41,42 @@ ibus_disconnected_cb (IBusBus  *bus,
 }
 
 
+/* The event log is written on SIGUSR2, to the terminal with --verbose
+ * and to the cache directory otherwise. */
+static void
+start_event_log (void)
+{
+    gchar *dir;
+    gchar *filename;
+
+    if (verbose) {
+        event_log_init (NULL);
+        return;
+    }
+
+    dir = g_build_filename (g_get_user_cache_dir (), "ibus-hangul", NULL);
+    g_mkdir_with_parents (dir, 0700);
+    filename = g_build_filename (dir, "events", NULL);
+    event_log_init (filename);
+    g_free (filename);
+    g_free (dir);
+}
+
+static void
+stop_event_log (void)
+{
+    if (verbose)
+        event_log_dump (2);
+    event_log_cleanup ();
+}
+
 static void
 start_component (void)
 {
     IBusComponent *component;
 
     ibus_init ();
+    start_event_log ();
 
     bus = ibus_bus_new ();
     g_signal_connect (bus, "disconnected", G_CALLBACK (ibus_disconnected_cb), NULL);
@@ -82,6 +117,7 @@ start_component (void)
     ibus_main ();
 
     ibus_hangul_exit ();
+    stop_event_log ();
 }
 
 int
@@ -92,6 +128,9 @@ main (gint argc, gchar **argv)
 
     setlocale (LC_ALL, "");
 
+    if (!g_thread_supported ())
+        g_thread_init (NULL);
+
     bindtextdomain(GETTEXT_PACKAGE, LOCALEDIR);
     bind_textdomain_codeset(GETTEXT_PACKAGE, "UTF-8");
     textdomain(GETTEXT_PACKAGE);
@@ -105,6 +144,18 @@ main (gint argc, gchar **argv)
         exit (-1);
     }
 
+    if (replay != NULL) {
+        gboolean res;
+
+        ibus_init ();
+        start_event_log ();
+        ibus_hangul_init (NULL);
+        res = ibus_hangul_replay_trace (replay, !replay_fast);
+        ibus_hangul_exit ();
+        stop_event_log ();
+        return res ? 0 : 1;
+    }
+
     start_component ();
     return 0;
 }
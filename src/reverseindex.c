@@ -0,0 +1,192 @@
+/* vim:set et sts=4: */
+#include <stdlib.h>
+#include <string.h>
+
+#include "reverseindex.h"
+
+typedef struct _ReverseEntry ReverseEntry;
+
+struct _ReverseEntry {
+    /* in the string pool of the trie, which stores every string once,
+     * so equal values have equal pointers */
+    const gchar *value;
+    guint32      key_id;
+    guint32      n;
+};
+
+struct _ReverseIndex {
+    const DictTrie *trie;
+    /* sorted by value, then in dictionary order */
+    ReverseEntry   *entries;
+    guint           n_entries;
+    /* value -> index + 1 of its first entry */
+    GHashTable     *table;
+};
+
+static int
+reverse_entry_compare (const void *a, const void *b)
+{
+    const ReverseEntry *x = a;
+    const ReverseEntry *y = b;
+
+    if (x->value != y->value)
+        return x->value < y->value ? -1 : 1;
+    if (x->key_id != y->key_id)
+        return x->key_id < y->key_id ? -1 : 1;
+    return (gint) x->n - (gint) y->n;
+}
+
+ReverseIndex*
+reverse_index_new (const DictTrie *trie)
+{
+    ReverseIndex *index;
+    guint n_keys;
+    guint i, j, n;
+    guint k = 0;
+
+    if (trie == NULL)
+        return NULL;
+
+    n_keys = dict_trie_get_n_keys (trie);
+    n = 0;
+    for (i = 0; i < n_keys; ++i)
+        n += dict_trie_get_n_entries (trie, i);
+
+    index = g_new (ReverseIndex, 1);
+    index->trie = trie;
+    index->n_entries = n;
+    index->entries = g_new (ReverseEntry, MAX (n, 1));
+    index->table = g_hash_table_new (g_str_hash, g_str_equal);
+
+    for (i = 0; i < n_keys; ++i) {
+        n = dict_trie_get_n_entries (trie, i);
+        for (j = 0; j < n; ++j) {
+            index->entries[k].value = dict_trie_get_value (trie, i, j);
+            index->entries[k].key_id = i;
+            index->entries[k].n = j;
+            k++;
+        }
+    }
+
+    qsort (index->entries, index->n_entries, sizeof (ReverseEntry),
+           reverse_entry_compare);
+
+    for (i = 0; i < index->n_entries; ++i) {
+        const gchar *value = index->entries[i].value;
+
+        if (value[0] == '\0')
+            continue;
+        if (i == 0 || index->entries[i - 1].value != value)
+            g_hash_table_insert (index->table, (gpointer) value,
+                                 GUINT_TO_POINTER (i + 1));
+    }
+
+    return index;
+}
+
+void
+reverse_index_delete (ReverseIndex *index)
+{
+    if (index == NULL)
+        return;
+
+    g_hash_table_destroy (index->table);
+    g_free (index->entries);
+    g_free (index);
+}
+
+/* Returns the first entry of text, or NULL. */
+static const ReverseEntry*
+reverse_index_find (const ReverseIndex *index, const gchar *text)
+{
+    guint i;
+
+    i = GPOINTER_TO_UINT (g_hash_table_lookup (index->table, text));
+    if (i == 0)
+        return NULL;
+
+    return &index->entries[i - 1];
+}
+
+gboolean
+reverse_index_lookup (const ReverseIndex *index,
+                      const gchar        *text,
+                      GString            *reading)
+{
+    const ReverseEntry *entry;
+    GString *key;
+
+    if (index == NULL)
+        return FALSE;
+
+    entry = reverse_index_find (index, text);
+    if (entry == NULL)
+        return FALSE;
+
+    key = g_string_new (NULL);
+    dict_trie_get_key (index->trie, entry->key_id, key);
+    g_string_append_len (reading, key->str, key->len);
+    g_string_free (key, TRUE);
+
+    return TRUE;
+}
+
+void
+reverse_index_search (const ReverseIndex *index,
+                      const gchar        *text,
+                      CandidateList      *list)
+{
+    const ReverseEntry *entry;
+    const gchar *key;
+    GString *reading;
+    guint length;
+    gboolean found = FALSE;
+
+    if (index == NULL || text[0] == '\0')
+        return;
+
+    length = g_utf8_strlen (text, -1);
+    key = candidate_list_intern (list, text, -1);
+    reading = g_string_new (NULL);
+
+    entry = reverse_index_find (index, text);
+    if (entry != NULL) {
+        const ReverseEntry *end = index->entries + index->n_entries;
+        const gchar *value = entry->value;
+
+        for (; entry < end && entry->value == value; ++entry) {
+            const gchar *comment;
+
+            dict_trie_get_key (index->trie, entry->key_id, reading);
+            comment = dict_trie_get_comment (index->trie, entry->key_id,
+                                             entry->n);
+            candidate_list_append (list, key,
+                    candidate_list_intern (list, reading->str, reading->len),
+                    comment, length);
+        }
+        g_string_free (reading, TRUE);
+        return;
+    }
+
+    // Text that is not a word of its own, one character at a time.
+    while (*text != '\0') {
+        const gchar *next = g_utf8_next_char (text);
+        gchar c[8];
+
+        memcpy (c, text, next - text);
+        c[next - text] = '\0';
+        if (reverse_index_lookup (index, c, reading))
+            found = TRUE;
+        else
+            g_string_append (reading, c);
+
+        text = next;
+    }
+
+    if (found)
+        candidate_list_append (list, key,
+                candidate_list_intern (list, reading->str, reading->len),
+                "", length);
+
+    g_string_free (reading, TRUE);
+}
@@ -0,0 +1,32 @@
+/* vim:set et sts=4: */
+#ifndef __REVERSE_INDEX_H__
+#define __REVERSE_INDEX_H__
+
+#include <glib.h>
+
+#include "dicttrie.h"
+#include "candidate.h"
+
+/* ReverseIndex maps the values of a dictionary back to their keys, so
+ * that 韓 gives 한 and 大韓 gives 대한. It is built once from the trie,
+ * and finding the readings of a value is one hash lookup. */
+typedef struct _ReverseIndex ReverseIndex;
+
+ReverseIndex* reverse_index_new      (const DictTrie     *trie);
+void          reverse_index_delete   (ReverseIndex       *index);
+
+/* Appends a reading of text to reading, and returns FALSE if text is
+ * not a value of the dictionary. */
+gboolean      reverse_index_lookup   (const ReverseIndex *index,
+                                      const gchar        *text,
+                                      GString            *reading);
+
+/* Appends the readings of text to list: every key that has text as a
+ * value, with the comment of that entry. If there is none, a reading
+ * is made up character by character, keeping the characters that have
+ * no reading. Candidates replace the whole of text. */
+void          reverse_index_search   (const ReverseIndex *index,
+                                      const gchar        *text,
+                                      CandidateList      *list);
+
+#endif
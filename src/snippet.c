@@ -0,0 +1,156 @@
+/* vim:set et sts=4: */
+#include "snippet.h"
+
+struct _SnippetTable {
+    volatile gint  ref_count;
+    DictTrie      *trie;
+    guint          n_nodes;
+    /* the children of node x are [first_child[x], first_child[x + 1]) */
+    guint32       *first_child;
+    /* the labels of the trie, copied so a step doesn't rank bits */
+    guint8        *labels;
+    /* the node of the longest proper suffix of a node's string that is
+     * in the trie */
+    guint32       *fail;
+    /* the longest key that is a suffix of a node's string, or -1 */
+    gint32        *match;
+};
+
+static gint
+snippet_table_child (const SnippetTable *table, guint node, guint8 c)
+{
+    guint i;
+
+    // the labels of the children are sorted, and there are few
+    for (i = table->first_child[node]; i < table->first_child[node + 1];
+         ++i) {
+        if (table->labels[i] == c)
+            return i;
+        if (table->labels[i] > c)
+            break;
+    }
+
+    return -1;
+}
+
+/* Follows byte c from node, or a suffix of its string. */
+static guint
+snippet_table_goto (const SnippetTable *table, guint node, guint8 c)
+{
+    gint child;
+
+    while ((child = snippet_table_child (table, node, c)) < 0) {
+        if (node == 0)
+            return 0;
+        node = table->fail[node];
+    }
+
+    return child;
+}
+
+SnippetTable*
+snippet_table_new (DictTrie *trie)
+{
+    SnippetTable *table;
+    guint n, x;
+
+    table = g_new (SnippetTable, 1);
+    table->ref_count = 1;
+    table->trie = trie;
+    table->n_nodes = n = dict_trie_get_n_nodes (trie);
+    table->first_child = g_new0 (guint32, n + 1);
+    table->labels = g_new (guint8, n);
+    table->fail = g_new0 (guint32, n);
+    table->match = g_new (gint32, n);
+
+    // Count the children of each node, then make the counts offsets:
+    // the children of the nodes are in order, after the root.
+    for (x = 1; x < n; ++x)
+        table->first_child[dict_trie_get_parent (trie, x) + 1]++;
+    table->first_child[0] = 1;
+    for (x = 1; x <= n; ++x)
+        table->first_child[x] += table->first_child[x - 1];
+
+    for (x = 0; x < n; ++x)
+        table->labels[x] = dict_trie_get_label (trie, x);
+
+    // A suffix is shorter than the string, so its node comes first in
+    // level order and its links are made already.
+    table->match[0] = dict_trie_get_node_key (trie, 0);
+    for (x = 1; x < n; ++x) {
+        guint parent = dict_trie_get_parent (trie, x);
+        gint key;
+
+        if (parent != 0)
+            table->fail[x] = snippet_table_goto (table, table->fail[parent],
+                                                 table->labels[x]);
+
+        key = dict_trie_get_node_key (trie, x);
+        table->match[x] = key >= 0 ? key : table->match[table->fail[x]];
+    }
+
+    return table;
+}
+
+SnippetTable*
+snippet_table_load (const gchar *filename)
+{
+    DictTrie *trie;
+
+    trie = dict_trie_load (filename);
+    if (trie == NULL)
+        return NULL;
+
+    return snippet_table_new (trie);
+}
+
+SnippetTable*
+snippet_table_ref (SnippetTable *table)
+{
+    g_atomic_int_inc (&table->ref_count);
+    return table;
+}
+
+void
+snippet_table_unref (SnippetTable *table)
+{
+    if (table == NULL)
+        return;
+
+    if (!g_atomic_int_dec_and_test (&table->ref_count))
+        return;
+
+    g_free (table->first_child);
+    g_free (table->labels);
+    g_free (table->fail);
+    g_free (table->match);
+    dict_trie_delete (table->trie);
+    g_free (table);
+}
+
+const DictTrie*
+snippet_table_get_trie (const SnippetTable *table)
+{
+    return table->trie;
+}
+
+guint
+snippet_table_step (const SnippetTable *table, guint state, gunichar c)
+{
+    gchar buf[6];
+    gint i, len;
+
+    // The keys are UTF-8, so a key found ends and starts at a character
+    // however the bytes are walked.
+    len = g_unichar_to_utf8 (c, buf);
+    for (i = 0; i < len; ++i)
+        state = snippet_table_goto (table, state, buf[i]);
+
+    return state;
+}
+
+gint
+snippet_table_get_match (const SnippetTable *table, guint state)
+{
+    return table->match[state];
+}
@@ -0,0 +1,42 @@
+/* vim:set et sts=4: */
+#ifndef __SNIPPET_H__
+#define __SNIPPET_H__
+
+#include <glib.h>
+
+#include "dicttrie.h"
+
+/* SnippetTable expands short keys into text of the user's, e.g. "ㄱㅅ"
+ * into a whole greeting. The snippets are a dictionary file, one
+ * "key:expansion:comment" a line, built into a DictTrie with the links
+ * of an Aho-Corasick automaton on top of it.
+ *
+ * The text typed is followed with a state, which is advanced by one
+ * step for each character: it is the node of the longest end of the
+ * text that starts a key. So a key is found as soon as its last
+ * character is typed, at a cost per character that doesn't grow with
+ * the number of snippets. A table is read only once made, and is shared
+ * between the engines. */
+typedef struct _SnippetTable SnippetTable;
+
+/* the state before any text */
+#define SNIPPET_STATE_START     0
+
+/* Takes trie. */
+SnippetTable*   snippet_table_new       (DictTrie           *trie);
+/* Reads the snippets in filename, or returns NULL. */
+SnippetTable*   snippet_table_load      (const gchar        *filename);
+SnippetTable*   snippet_table_ref       (SnippetTable       *table);
+void            snippet_table_unref     (SnippetTable       *table);
+
+const DictTrie* snippet_table_get_trie  (const SnippetTable *table);
+
+/* Returns the state after c. */
+guint           snippet_table_step      (const SnippetTable *table,
+                                         guint               state,
+                                         gunichar            c);
+/* Returns the id of the longest key the text ends with, or -1. */
+gint            snippet_table_get_match (const SnippetTable *table,
+                                         guint               state);
+
+#endif
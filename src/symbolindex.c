@@ -0,0 +1,338 @@
+/* vim:set et sts=4: */
+#include <stdlib.h>
+#include <string.h>
+
+#include "symbolindex.h"
+
+typedef struct _SymbolEntry SymbolEntry;
+typedef struct _SymbolWord SymbolWord;
+typedef struct _SymbolPosting SymbolPosting;
+
+struct _SymbolEntry {
+    guint32 key_id;
+    guint32 n;
+};
+
+/* a word, and its entries in postings[first, first + n) */
+struct _SymbolWord {
+    const gchar *word;
+    guint32      first;
+    guint32      n;
+};
+
+struct _SymbolPosting {
+    const gchar *word;
+    guint32      entry;
+};
+
+struct _SymbolIndex {
+    const DictTrie *trie;
+    SymbolEntry    *entries;
+    guint           n_entries;
+    /* sorted by strcmp() */
+    SymbolWord     *words;
+    guint           n_words;
+    guint32        *postings;
+    GStringChunk   *chunk;
+};
+
+/* Returns the next word of str, lower case, in word, and where it ends;
+ * NULL if there is none. Words are runs of letters and digits. */
+static const gchar*
+next_word (const gchar *str, GString *word)
+{
+    g_string_truncate (word, 0);
+
+    while (*str != '\0' && !g_unichar_isalnum (g_utf8_get_char (str)))
+        str = g_utf8_next_char (str);
+
+    while (*str != '\0') {
+        gunichar c = g_utf8_get_char (str);
+
+        if (!g_unichar_isalnum (c))
+            break;
+        g_string_append_unichar (word, g_unichar_tolower (c));
+        str = g_utf8_next_char (str);
+    }
+
+    return word->len > 0 ? str : NULL;
+}
+
+static int
+symbol_posting_compare (const void *a, const void *b)
+{
+    const SymbolPosting *x = a;
+    const SymbolPosting *y = b;
+    int r;
+
+    // the words are interned, so equal words are one pointer
+    if (x->word != y->word) {
+        r = strcmp (x->word, y->word);
+        if (r != 0)
+            return r;
+    }
+    if (x->entry != y->entry)
+        return x->entry < y->entry ? -1 : 1;
+    return 0;
+}
+
+SymbolIndex*
+symbol_index_new (const DictTrie *trie)
+{
+    SymbolIndex *index;
+    GArray *entries;
+    GArray *postings;
+    GString *word;
+    guint n_keys;
+    guint i, j, n;
+
+    if (trie == NULL)
+        return NULL;
+
+    index = g_new0 (SymbolIndex, 1);
+    index->trie = trie;
+    index->chunk = g_string_chunk_new (4096);
+
+    entries = g_array_new (FALSE, FALSE, sizeof (SymbolEntry));
+    postings = g_array_new (FALSE, FALSE, sizeof (SymbolPosting));
+    word = g_string_new (NULL);
+
+    n_keys = dict_trie_get_n_keys (trie);
+    for (i = 0; i < n_keys; ++i) {
+        n = dict_trie_get_n_entries (trie, i);
+        for (j = 0; j < n; ++j) {
+            const gchar *name = dict_trie_get_comment (trie, i, j);
+            SymbolEntry entry = { i, j };
+
+            while ((name = next_word (name, word)) != NULL) {
+                SymbolPosting posting;
+
+                posting.word = g_string_chunk_insert_const (index->chunk,
+                                                            word->str);
+                posting.entry = entries->len;
+                g_array_append_val (postings, posting);
+            }
+            g_array_append_val (entries, entry);
+        }
+    }
+
+    qsort (postings->data, postings->len, sizeof (SymbolPosting),
+           symbol_posting_compare);
+
+    index->postings = g_new (guint32, MAX (postings->len, 1));
+    index->words = g_new (SymbolWord, MAX (postings->len, 1));
+    n = 0;
+    for (i = 0; i < postings->len; ++i) {
+        SymbolPosting *p = &g_array_index (postings, SymbolPosting, i);
+        SymbolWord *last = index->n_words > 0 ?
+                           &index->words[index->n_words - 1] : NULL;
+
+        if (last == NULL || last->word != p->word) {
+            last = &index->words[index->n_words++];
+            last->word = p->word;
+            last->first = n;
+            last->n = 0;
+        } else if (index->postings[n - 1] == p->entry) {
+            // a word twice in one name
+            continue;
+        }
+
+        index->postings[n++] = p->entry;
+        last->n++;
+    }
+
+    index->n_entries = entries->len;
+    index->entries = (SymbolEntry *) g_array_free (entries, FALSE);
+    g_array_free (postings, TRUE);
+    g_string_free (word, TRUE);
+
+    return index;
+}
+
+void
+symbol_index_delete (SymbolIndex *index)
+{
+    if (index == NULL)
+        return;
+
+    g_string_chunk_free (index->chunk);
+    g_free (index->postings);
+    g_free (index->words);
+    g_free (index->entries);
+    g_free (index);
+}
+
+/* Returns the first word that is not less than prefix. */
+static guint
+symbol_index_lower_bound (const SymbolIndex *index, const gchar *prefix)
+{
+    guint lo = 0;
+    guint hi = index->n_words;
+
+    while (lo < hi) {
+        guint mid = lo + (hi - lo) / 2;
+
+        if (strcmp (index->words[mid].word, prefix) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+static int
+guint32_compare (const void *a, const void *b)
+{
+    guint32 x = *(const guint32 *) a;
+    guint32 y = *(const guint32 *) b;
+
+    return x < y ? -1 : x > y;
+}
+
+/* Puts the sorted entries that have a word starting with prefix in
+ * matches. */
+static void
+symbol_index_find (const SymbolIndex *index,
+                   const gchar       *prefix,
+                   GArray            *matches)
+{
+    gsize len = strlen (prefix);
+    guint i, j;
+    guint n_words = 0;
+
+    g_array_set_size (matches, 0);
+    for (i = symbol_index_lower_bound (index, prefix);
+         i < index->n_words &&
+         strncmp (index->words[i].word, prefix, len) == 0; ++i) {
+        const SymbolWord *w = &index->words[i];
+
+        g_array_append_vals (matches, index->postings + w->first, w->n);
+        n_words++;
+    }
+
+    // The list of one word is sorted already; those of several words
+    // are merged here.
+    if (n_words < 2)
+        return;
+
+    qsort (matches->data, matches->len, sizeof (guint32), guint32_compare);
+    for (i = 0, j = 0; i < matches->len; ++i) {
+        guint32 e = g_array_index (matches, guint32, i);
+
+        if (j == 0 || g_array_index (matches, guint32, j - 1) != e)
+            g_array_index (matches, guint32, j++) = e;
+    }
+    g_array_set_size (matches, j);
+}
+
+/* Keeps the entries of result that are also in matches. */
+static void
+intersect (GArray *result, const GArray *matches)
+{
+    guint i = 0, j = 0, n = 0;
+
+    while (i < result->len && j < matches->len) {
+        guint32 a = g_array_index (result, guint32, i);
+        guint32 b = g_array_index (matches, guint32, j);
+
+        if (a < b) {
+            i++;
+        } else if (a > b) {
+            j++;
+        } else {
+            g_array_index (result, guint32, n++) = a;
+            i++;
+            j++;
+        }
+    }
+    g_array_set_size (result, n);
+}
+
+static gint
+symbol_entry_compare (gconstpointer a, gconstpointer b, gpointer data)
+{
+    const SymbolIndex *index = data;
+    const SymbolEntry *x = &index->entries[*(const guint32 *) a];
+    const SymbolEntry *y = &index->entries[*(const guint32 *) b];
+    gsize lx = strlen (dict_trie_get_comment (index->trie, x->key_id, x->n));
+    gsize ly = strlen (dict_trie_get_comment (index->trie, y->key_id, y->n));
+
+    if (lx != ly)
+        return lx < ly ? -1 : 1;
+    return guint32_compare (a, b);
+}
+
+guint
+symbol_index_search (const SymbolIndex *index,
+                     const DictMask    *mask,
+                     const gchar       *query,
+                     CandidateList     *list)
+{
+    GArray *result = NULL;
+    GArray *matches;
+    GHashTable *seen;
+    GString *word;
+    const gchar *key;
+    const gchar *p;
+    guint length;
+    guint n = 0;
+    guint i;
+
+    if (index == NULL)
+        return 0;
+
+    matches = g_array_new (FALSE, FALSE, sizeof (guint32));
+    word = g_string_new (NULL);
+
+    p = query;
+    while ((p = next_word (p, word)) != NULL) {
+        symbol_index_find (index, word->str, matches);
+        if (result == NULL) {
+            result = matches;
+            matches = g_array_new (FALSE, FALSE, sizeof (guint32));
+        } else {
+            intersect (result, matches);
+        }
+
+        if (result->len == 0)
+            break;
+    }
+
+    g_string_free (word, TRUE);
+    g_array_free (matches, TRUE);
+
+    if (result == NULL)
+        return 0;
+
+    g_array_sort_with_data (result, symbol_entry_compare, (gpointer) index);
+
+    key = candidate_list_intern (list, query, -1);
+    length = g_utf8_strlen (query, -1);
+
+    // A symbol can be filed under several jamo. Values are pool strings,
+    // so the same symbol is the same pointer.
+    seen = g_hash_table_new (g_direct_hash, g_direct_equal);
+    for (i = 0; i < result->len; ++i) {
+        const SymbolEntry *e = &index->entries[g_array_index (result,
+                                                              guint32, i)];
+        const gchar *value;
+
+        if (!dict_trie_entry_visible (index->trie, mask, e->key_id, e->n))
+            continue;
+
+        value = dict_trie_get_value (index->trie, e->key_id, e->n);
+        if (g_hash_table_lookup (seen, value) != NULL)
+            continue;
+        g_hash_table_insert (seen, (gpointer) value, (gpointer) value);
+
+        candidate_list_append (list, key, value,
+                dict_trie_get_comment (index->trie, e->key_id, e->n),
+                length);
+        n++;
+    }
+    g_hash_table_destroy (seen);
+    g_array_free (result, TRUE);
+
+    return n;
+}
@@ -0,0 +1,30 @@
+/* vim:set et sts=4: */
+#ifndef __SYMBOL_INDEX_H__
+#define __SYMBOL_INDEX_H__
+
+#include <glib.h>
+
+#include "dicttrie.h"
+#include "candidate.h"
+
+/* SymbolIndex finds symbols by the words of their names. The names are
+ * the comments of the symbol dictionary, e.g. "black heart suit". Every
+ * word of every name is kept once in a sorted table, with the sorted
+ * list of the entries that have it, so a search is a binary search and
+ * a merge of short lists for each word of the query, however many
+ * symbols there are. */
+typedef struct _SymbolIndex SymbolIndex;
+
+SymbolIndex* symbol_index_new     (const DictTrie     *trie);
+void         symbol_index_delete  (SymbolIndex        *index);
+
+/* Appends the symbols whose names have a word starting with each word
+ * of query, e.g. "bla hea" gives ♥. Shorter names come first, and each
+ * symbol only once; those that don't pass mask are left out. The
+ * candidates replace query. Returns the number of candidates appended. */
+guint        symbol_index_search  (const SymbolIndex  *index,
+                                   const DictMask     *mask,
+                                   const gchar        *query,
+                                   CandidateList      *list);
+
+#endif
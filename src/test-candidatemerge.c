@@ -0,0 +1,185 @@
+/* vim:set et sts=4: */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <glib.h>
+
+#include "candidatemerge.h"
+
+/* Tests of CandidateMerge over sources made of arrays, which count the
+ * candidates taken from them, so the laziness of the merge shows. */
+
+typedef struct _ArraySource ArraySource;
+
+struct _ArraySource {
+    CandidateSource       source;
+    const CandidateEntry *entries;
+    guint                 n_entries;
+    guint                 pos;
+    guint                *n_taken;
+};
+
+static gboolean
+array_source_next (CandidateSource *source,
+                   CandidateList   *list,
+                   CandidateEntry  *entry)
+{
+    ArraySource *array = (ArraySource *) source;
+
+    if (array->pos == array->n_entries)
+        return FALSE;
+
+    *entry = array->entries[array->pos++];
+    (*array->n_taken)++;
+    return TRUE;
+}
+
+static void
+array_source_destroy (CandidateSource *source)
+{
+    g_free (source);
+}
+
+static CandidateSource*
+array_source_new (const CandidateEntry *entries,
+                  guint                 n_entries,
+                  guint                 min_rank,
+                  guint                *n_taken)
+{
+    ArraySource *array;
+
+    array = g_new0 (ArraySource, 1);
+    array->source.next = array_source_next;
+    array->source.destroy = array_source_destroy;
+    array->source.min_rank = min_rank;
+    array->entries = entries;
+    array->n_entries = n_entries;
+    array->n_taken = n_taken;
+    *n_taken = 0;
+
+    return &array->source;
+}
+
+static const CandidateEntry symbols[] = {
+    { "a", "α", "", 1, 0 },
+    { "a", "∀", "", 1, 2 },
+    { "a", "å", "", 1, 5 },
+};
+
+static const CandidateEntry words[] = {
+    { "a", "ā", "", 1, 1 },
+    { "a", "à", "", 1, 2 },
+    { "a", "α", "", 1, 3 },
+    { "a", "á", "", 1, 5 },
+};
+
+static const CandidateEntry late_words[] = {
+    { "a", "ǎ", "", 1, 6 },
+    { "a", "â", "", 1, 7 },
+};
+
+static void
+test_order (void)
+{
+    static const gchar *expected[] = { "α", "ā", "∀", "à", "å", "á" };
+    CandidateMerge *merge;
+    CandidateList *list;
+    guint n_symbols, n_words;
+    guint i;
+
+    merge = candidate_merge_new ();
+    candidate_merge_add (merge,
+                         array_source_new (words, G_N_ELEMENTS (words), 0,
+                                           &n_words), 0);
+    candidate_merge_add (merge,
+                         array_source_new (symbols, G_N_ELEMENTS (symbols),
+                                           0, &n_symbols), 1);
+
+    list = candidate_list_new ();
+    candidate_merge_attach (merge, list);
+
+    // by rank, then the higher priority first; the second α is left out
+    g_assert_cmpuint (candidate_list_fill (list, 100), ==,
+                      G_N_ELEMENTS (expected));
+    g_assert (candidate_list_is_complete (list));
+    for (i = 0; i < G_N_ELEMENTS (expected); ++i)
+        g_assert_cmpstr (candidate_list_get_nth_value (list, i), ==,
+                         expected[i]);
+
+    candidate_list_delete (list);
+}
+
+static void
+test_same_priority (void)
+{
+    CandidateMerge *merge;
+    CandidateList *list;
+    guint n_symbols, n_words;
+
+    merge = candidate_merge_new ();
+    candidate_merge_add (merge,
+                         array_source_new (symbols, G_N_ELEMENTS (symbols),
+                                           0, &n_symbols), 0);
+    candidate_merge_add (merge,
+                         array_source_new (words, G_N_ELEMENTS (words), 0,
+                                           &n_words), 0);
+
+    list = candidate_list_new ();
+    candidate_merge_attach (merge, list);
+
+    // of the same rank, the source added first comes first
+    candidate_list_fill (list, 4);
+    g_assert_cmpstr (candidate_list_get_nth_value (list, 2), ==, "∀");
+    g_assert_cmpstr (candidate_list_get_nth_value (list, 3), ==, "à");
+
+    candidate_list_delete (list);
+}
+
+static void
+test_lazy (void)
+{
+    CandidateMerge *merge;
+    CandidateList *list;
+    guint n_symbols, n_words;
+
+    merge = candidate_merge_new ();
+    candidate_merge_add (merge,
+                         array_source_new (symbols, G_N_ELEMENTS (symbols),
+                                           0, &n_symbols), 1);
+    // nothing of this one can come before rank 4
+    candidate_merge_add (merge,
+                         array_source_new (late_words,
+                                           G_N_ELEMENTS (late_words), 4,
+                                           &n_words), 0);
+
+    list = candidate_list_new ();
+    candidate_merge_attach (merge, list);
+
+    g_assert_cmpuint (candidate_list_fill (list, 2), ==, 2);
+    g_assert (!candidate_list_is_complete (list));
+    g_assert_cmpuint (n_words, ==, 0);
+
+    // past rank 4, the first word is needed to order them
+    g_assert_cmpuint (candidate_list_fill (list, 3), ==, 3);
+    g_assert_cmpstr (candidate_list_get_nth_value (list, 2), ==, "å");
+    g_assert_cmpuint (n_words, ==, 1);
+
+    g_assert_cmpuint (candidate_list_fill (list, 4), ==, 4);
+    g_assert_cmpstr (candidate_list_get_nth_value (list, 3), ==, "ǎ");
+    g_assert_cmpuint (n_words, ==, 1);
+
+    candidate_list_delete (list);
+}
+
+int
+main (int argc, char **argv)
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/candidatemerge/order", test_order);
+    g_test_add_func ("/candidatemerge/same-priority", test_same_priority);
+    g_test_add_func ("/candidatemerge/lazy", test_lazy);
+
+    return g_test_run ();
+}
@@ -0,0 +1,87 @@
+/* vim:set et sts=4: */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <unistd.h>
+
+#include "charfilter.h"
+
+static void
+test_ksx1001 (void)
+{
+    CharFilter *filter;
+
+    filter = char_filter_new_ksx1001 ();
+
+    g_assert (char_filter_contains (filter, 'A'));
+    g_assert (char_filter_contains (filter, 0xac00));   // 가
+    g_assert (char_filter_contains (filter, 0x97d3));   // 韓
+    g_assert (char_filter_contains (filter, 0x3131));   // ㄱ
+    // not among the 2350 syllables of KS X 1001
+    g_assert (!char_filter_contains (filter, 0xb620));  // 똠
+    g_assert (!char_filter_contains (filter, 0x10ffff));
+    g_assert (!char_filter_contains (filter, 0x110000));
+
+    g_assert (char_filter_accepts (filter, "가나 abc"));
+    g_assert (!char_filter_accepts (filter, "똠방각하"));
+    g_assert (char_filter_accepts (filter, ""));
+
+    char_filter_delete (filter);
+}
+
+static void
+test_load (void)
+{
+    CharFilter *filter;
+    gchar *filename;
+    gint fd;
+
+    fd = g_file_open_tmp ("test-charfilter-XXXXXX.txt", &filename, NULL);
+    g_assert (fd >= 0);
+    close (fd);
+    g_assert (g_file_set_contents (filename,
+                                   "# 丁 is left out\n"
+                                   "韓 國\n"
+                                   "\t家\n"
+                                   "\xc3\xbf\xc4\x80\n", -1, NULL));
+
+    filter = char_filter_load (filename);
+    g_unlink (filename);
+    g_free (filename);
+    g_assert (filter != NULL);
+
+    g_assert (char_filter_contains (filter, 0x97d3));   // 韓
+    g_assert (char_filter_contains (filter, 0x570b));   // 國
+    g_assert (char_filter_contains (filter, 0x5bb6));   // 家
+    g_assert (!char_filter_contains (filter, 0x4e01));  // 丁
+    g_assert (!char_filter_contains (filter, '#'));
+    g_assert (!char_filter_contains (filter, ' '));
+    g_assert (!char_filter_contains (filter, 'A'));
+
+    // the last of a page and the first of the next
+    g_assert (char_filter_contains (filter, 0xff));
+    g_assert (char_filter_contains (filter, 0x100));
+    g_assert (!char_filter_contains (filter, 0xfe));
+    g_assert (!char_filter_contains (filter, 0x101));
+
+    g_assert (char_filter_accepts (filter, "韓國"));
+    g_assert (!char_filter_accepts (filter, "韓丁"));
+
+    char_filter_delete (filter);
+
+    g_assert (char_filter_load ("/nonexistent/filter.txt") == NULL);
+}
+
+int
+main (int argc, char **argv)
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/charfilter/ksx1001", test_ksx1001);
+    g_test_add_func ("/charfilter/load", test_load);
+
+    return g_test_run ();
+}
@@ -0,0 +1,196 @@
+/* vim:set et sts=4: */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <glib.h>
+#include <hangul.h>
+
+#include "composer.h"
+
+/* Checks the fast path of Composer against libhangul: for every standard
+ * keyboard a random keystroke corpus is typed into a Composer and into a
+ * plain HangulInputContext, and the return value, the commit string and
+ * the preedit string must be the same after every key. The corpus is
+ * typed twice, while the transition table is being filled and once it
+ * mostly is. The seed is fixed, so a failure can be reproduced with
+ * ibus-hangul-bench-composer, which times the same on a larger corpus.
+ * The 2-set keyboard is also typed on two threads at once. */
+
+#define N_EVENTS        50000
+#define SEED            20100521
+
+enum {
+    EVENT_BACKSPACE = -1,
+    EVENT_FLUSH     = -2,
+    EVENT_RESET     = -3,
+};
+
+static const gchar *keyboards[] = {
+    "2", "2y", "32", "39", "3f", "3s", "3y"
+};
+
+static GArray *corpus = NULL;
+
+static gboolean
+ucs_equal (const ucschar *a, const ucschar *b)
+{
+    while (*a != 0 && *a == *b) {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+/* Mostly letters, as in text, with the rest of the keyboard, BackSpace
+ * and the odd key that is not ASCII. */
+static GArray*
+corpus_new (guint32 seed)
+{
+    static const gchar punctuation[] = " .,;'/[]-=`!?\"()";
+    GArray *events;
+    GRand *rand;
+    guint i;
+
+    events = g_array_sized_new (FALSE, FALSE, sizeof (gint), N_EVENTS);
+    rand = g_rand_new_with_seed (seed);
+
+    for (i = 0; i < N_EVENTS; ++i) {
+        gint r = g_rand_int_range (rand, 0, 1000);
+        gint event;
+
+        if (r < 620)
+            event = 'a' + g_rand_int_range (rand, 0, 26);
+        else if (r < 720)
+            event = 'A' + g_rand_int_range (rand, 0, 26);
+        else if (r < 800)
+            event = punctuation[g_rand_int_range (rand, 0,
+                                              sizeof (punctuation) - 1)];
+        else if (r < 850)
+            event = '0' + g_rand_int_range (rand, 0, 10);
+        else if (r < 950)
+            event = EVENT_BACKSPACE;
+        else if (r < 970)
+            event = EVENT_FLUSH;
+        else if (r < 980)
+            event = EVENT_RESET;
+        else
+            event = 0xa0 + g_rand_int_range (rand, 0, 0x60);
+
+        g_array_append_val (events, event);
+    }
+
+    g_rand_free (rand);
+    return events;
+}
+
+static void
+check (Composer *composer, HangulInputContext *context)
+{
+    guint i;
+
+    for (i = 0; i < corpus->len; ++i) {
+        gint event = g_array_index (corpus, gint, i);
+        gboolean retval1;
+        gboolean retval2;
+
+        if (event == EVENT_BACKSPACE) {
+            retval1 = composer_backspace (composer);
+            retval2 = hangul_ic_backspace (context);
+        } else if (event == EVENT_FLUSH) {
+            g_assert (ucs_equal (composer_flush (composer),
+                                 hangul_ic_flush (context)));
+            continue;
+        } else if (event == EVENT_RESET) {
+            composer_reset (composer);
+            hangul_ic_reset (context);
+            continue;
+        } else {
+            retval1 = composer_process (composer, event);
+            retval2 = hangul_ic_process (context, event);
+        }
+
+        if (retval1 != retval2 ||
+            !ucs_equal (composer_get_commit_string (composer),
+                        hangul_ic_get_commit_string (context)) ||
+            !ucs_equal (composer_get_preedit_string (composer),
+                        hangul_ic_get_preedit_string (context)))
+            g_error ("differs from libhangul at event %u (%d)", i, event);
+    }
+}
+
+static gpointer
+check_keyboard (gpointer data)
+{
+    const gchar *keyboard = data;
+    Composer *composer;
+    HangulInputContext *context;
+
+    composer = composer_new (keyboard);
+    context = hangul_ic_new (keyboard);
+
+    check (composer, context);
+    check (composer, context);
+
+    composer_delete (composer);
+    hangul_ic_delete (context);
+
+    return NULL;
+}
+
+static void
+test_keyboard (gconstpointer data)
+{
+    check_keyboard ((gpointer) data);
+}
+
+/* Composers of the same keyboard on two threads at once, each filling
+ * the tables of its thread. */
+static void
+test_threads (void)
+{
+    GThread *threads[2];
+    guint i;
+
+    // so the tables are filled while both run
+    composer_cleanup ();
+
+    for (i = 0; i < G_N_ELEMENTS (threads); ++i) {
+        threads[i] = g_thread_create (check_keyboard, (gpointer) "2",
+                                      TRUE, NULL);
+        g_assert (threads[i] != NULL);
+    }
+
+    for (i = 0; i < G_N_ELEMENTS (threads); ++i)
+        g_thread_join (threads[i]);
+}
+
+int
+main (int argc, char **argv)
+{
+    gint res;
+    guint i;
+
+    if (!g_thread_supported ())
+        g_thread_init (NULL);
+
+    g_test_init (&argc, &argv, NULL);
+
+    corpus = corpus_new (SEED);
+    composer_set_fast_path (TRUE);
+
+    for (i = 0; i < G_N_ELEMENTS (keyboards); ++i) {
+        gchar *path = g_strdup_printf ("/composer/%s", keyboards[i]);
+
+        g_test_add_data_func (path, keyboards[i], test_keyboard);
+        g_free (path);
+    }
+    g_test_add_func ("/composer/threads", test_threads);
+
+    res = g_test_run ();
+
+    composer_cleanup ();
+    g_array_free (corpus, TRUE);
+
+    return res;
+}
@@ -0,0 +1,491 @@
+/* vim:set et sts=4: */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "core.h"
+
+/* Tests of Core through its callbacks, as the engine drives it. The
+ * keyboard is the 2-set one, and the dictionary and the snippets have a
+ * single entry each for the syllable "rk" composes, so the tests don't
+ * depend on the data libhangul ships. */
+
+#define KEY_Return      0xff0d
+#define KEY_Escape      0xff1b
+#define KEY_Down        0xff54
+
+#define HANJA_VALUE     "韓"
+#define SNIPPET_VALUE   "snippet"
+
+typedef struct _Fixture Fixture;
+
+struct _Fixture {
+    Core      *core;
+    /* the text the application has got, as it would with the engine */
+    GString   *text;
+    /* the last preedit string */
+    GString   *preedit;
+    /* candidates of the list shown, 0 while hidden */
+    guint      n_candidates;
+    /* the keys of the search callback, "" for a cancel */
+    GPtrArray *searches;
+    /* the application can delete the text before the cursor */
+    gboolean   can_delete;
+};
+
+static CoreDicts *dicts = NULL;
+static SnippetTable *snippets = NULL;
+/* what "rk" composes */
+static gchar     *syllable = NULL;
+
+static void
+append_ucs4 (GString *str, const ucschar *ucs)
+{
+    gchar *utf8;
+
+    utf8 = g_ucs4_to_utf8 ((const gunichar *) ucs, -1, NULL, NULL, NULL);
+    g_string_append (str, utf8);
+    g_free (utf8);
+}
+
+static void
+commit_cb (Core *core, const ucschar *str, gpointer user_data)
+{
+    Fixture *fixture = user_data;
+
+    append_ucs4 (fixture->text, str);
+}
+
+static void
+update_preedit_cb (Core          *core,
+                   const ucschar *str,
+                   guint          n_fixed,
+                   gpointer       user_data)
+{
+    Fixture *fixture = user_data;
+
+    g_string_truncate (fixture->preedit, 0);
+    append_ucs4 (fixture->preedit, str);
+}
+
+static void
+end_preedit_cb (Core *core, const ucschar *str, gpointer user_data)
+{
+    Fixture *fixture = user_data;
+
+    // the application keeps the preedit string
+    append_ucs4 (fixture->text, str);
+    g_string_truncate (fixture->preedit, 0);
+}
+
+static void
+update_candidates_cb (Core                *core,
+                      const CandidateList *list,
+                      gpointer             user_data)
+{
+    Fixture *fixture = user_data;
+
+    fixture->n_candidates = candidate_list_get_size (list);
+}
+
+static void
+hide_candidates_cb (Core *core, gpointer user_data)
+{
+    Fixture *fixture = user_data;
+
+    fixture->n_candidates = 0;
+}
+
+static void
+search_cb (Core *core, const gchar *key, gpointer user_data)
+{
+    Fixture *fixture = user_data;
+
+    g_ptr_array_add (fixture->searches, g_strdup (key != NULL ? key : ""));
+}
+
+static gboolean
+delete_text_cb (Core *core, guint n_chars, gpointer user_data)
+{
+    Fixture *fixture = user_data;
+    const gchar *end;
+
+    if (!fixture->can_delete)
+        return FALSE;
+
+    end = fixture->text->str + fixture->text->len;
+    for (; n_chars > 0; --n_chars) {
+        g_assert (end > fixture->text->str);
+        end = g_utf8_prev_char (end);
+    }
+    g_string_truncate (fixture->text, end - fixture->text->str);
+
+    return TRUE;
+}
+
+static const CoreCallbacks callbacks = {
+    commit_cb,
+    update_preedit_cb,
+    end_preedit_cb,
+    update_candidates_cb,
+    NULL,
+    hide_candidates_cb,
+    NULL,
+    delete_text_cb,
+    NULL,
+};
+
+static const CoreCallbacks async_callbacks = {
+    commit_cb,
+    update_preedit_cb,
+    end_preedit_cb,
+    update_candidates_cb,
+    NULL,
+    hide_candidates_cb,
+    search_cb,
+    NULL,
+    NULL,
+};
+
+static void
+fixture_setup (Fixture *fixture, const CoreCallbacks *cbs)
+{
+    fixture->core = core_new (dicts, "2");
+    fixture->text = g_string_new (NULL);
+    fixture->preedit = g_string_new (NULL);
+    fixture->n_candidates = 0;
+    fixture->searches = g_ptr_array_new ();
+    fixture->can_delete = TRUE;
+    core_set_callbacks (fixture->core, cbs, fixture);
+}
+
+static void
+fixture_teardown (Fixture *fixture)
+{
+    core_delete (fixture->core);
+    g_string_free (fixture->text, TRUE);
+    g_string_free (fixture->preedit, TRUE);
+    g_ptr_array_foreach (fixture->searches, (GFunc) g_free, NULL);
+    g_ptr_array_free (fixture->searches, TRUE);
+}
+
+/* Types keys, which the application inserts if they are passed on. */
+static void
+type (Fixture *fixture, const gchar *keys)
+{
+    for (; *keys != '\0'; ++keys) {
+        if (!core_process_key (fixture->core, *keys))
+            g_string_append_c (fixture->text, *keys);
+    }
+}
+
+static const gchar*
+last_search (Fixture *fixture)
+{
+    g_assert (fixture->searches->len > 0);
+    return g_ptr_array_index (fixture->searches, fixture->searches->len - 1);
+}
+
+static void
+test_compose (void)
+{
+    Fixture fixture;
+
+    fixture_setup (&fixture, &callbacks);
+
+    type (&fixture, "rk");
+    g_assert_cmpstr (fixture.text->str, ==, "");
+    g_assert_cmpstr (fixture.preedit->str, ==, syllable);
+
+    // a key the keyboard doesn't take ends the preedit string
+    g_assert (!core_process_key (fixture.core, ' '));
+    g_assert_cmpstr (fixture.text->str, ==, syllable);
+    g_assert_cmpstr (fixture.preedit->str, ==, "");
+
+    fixture_teardown (&fixture);
+}
+
+static void
+test_search_in_place (void)
+{
+    Fixture fixture;
+
+    fixture_setup (&fixture, &callbacks);
+
+    type (&fixture, "rk");
+    core_show_candidates (fixture.core);
+    g_assert_cmpuint (fixture.n_candidates, ==, 1);
+
+    g_assert (core_process_key (fixture.core, '1'));
+    g_assert_cmpstr (fixture.text->str, ==, HANJA_VALUE);
+    g_assert_cmpstr (fixture.preedit->str, ==, "");
+    g_assert_cmpuint (fixture.n_candidates, ==, 0);
+    g_assert (!core_has_candidates (fixture.core));
+
+    fixture_teardown (&fixture);
+}
+
+static void
+test_search_async (void)
+{
+    Fixture fixture;
+
+    fixture_setup (&fixture, &async_callbacks);
+
+    type (&fixture, "rk");
+    core_show_candidates (fixture.core);
+    g_assert_cmpstr (last_search (&fixture), ==, syllable);
+    g_assert (core_has_candidates (fixture.core));
+    g_assert (core_get_candidates (fixture.core) == NULL);
+
+    core_set_search_result (fixture.core,
+                            core_dicts_search (dicts, NULL, syllable));
+    g_assert_cmpuint (fixture.n_candidates, ==, 1);
+
+    g_assert (core_process_key (fixture.core, KEY_Return));
+    g_assert_cmpstr (fixture.text->str, ==, HANJA_VALUE);
+
+    fixture_teardown (&fixture);
+}
+
+static void
+test_type_during_search (void)
+{
+    Fixture fixture;
+    GString *preedit;
+
+    fixture_setup (&fixture, &async_callbacks);
+
+    type (&fixture, "rk");
+    core_show_candidates (fixture.core);
+    g_assert_cmpstr (last_search (&fixture), ==, syllable);
+
+    // the key goes to the composition, and the search is cancelled
+    type (&fixture, "s");
+    g_assert_cmpstr (last_search (&fixture), ==, "");
+    g_assert (!core_has_candidates (fixture.core));
+    preedit = g_string_new (fixture.preedit->str);
+    g_assert_cmpstr (preedit->str, !=, syllable);
+
+    // the result of the old preedit string comes late
+    core_set_search_result (fixture.core,
+                            core_dicts_search (dicts, NULL, syllable));
+    g_assert_cmpuint (fixture.n_candidates, ==, 0);
+    g_assert (core_get_candidates (fixture.core) == NULL);
+    g_assert_cmpstr (fixture.preedit->str, ==, preedit->str);
+
+    // and the next key isn't taken as a selection
+    g_assert (!core_process_key (fixture.core, '1'));
+    g_assert_cmpstr (fixture.text->str, ==, preedit->str);
+
+    g_string_free (preedit, TRUE);
+    fixture_teardown (&fixture);
+}
+
+static void
+test_reset_during_search (void)
+{
+    Fixture fixture;
+
+    fixture_setup (&fixture, &async_callbacks);
+
+    type (&fixture, "rk");
+    core_show_candidates (fixture.core);
+    core_reset (fixture.core);
+    g_assert_cmpstr (last_search (&fixture), ==, "");
+
+    core_set_search_result (fixture.core,
+                            core_dicts_search (dicts, NULL, syllable));
+    g_assert_cmpuint (fixture.n_candidates, ==, 0);
+    g_assert (!core_has_candidates (fixture.core));
+
+    fixture_teardown (&fixture);
+}
+
+static void
+test_snippet_expand (void)
+{
+    Fixture fixture;
+    gchar *expected;
+
+    fixture_setup (&fixture, &callbacks);
+    core_set_snippets (fixture.core, snippets, TRUE);
+
+    type (&fixture, "-rk ");
+    expected = g_strdup ("-" SNIPPET_VALUE " ");
+    g_assert_cmpstr (fixture.text->str, ==, expected);
+    g_free (expected);
+
+    fixture_teardown (&fixture);
+}
+
+static void
+test_snippet_in_word (void)
+{
+    Fixture fixture;
+    gchar *expected;
+
+    fixture_setup (&fixture, &callbacks);
+    core_set_snippets (fixture.core, snippets, TRUE);
+
+    // the key ends a word it doesn't start
+    type (&fixture, "1rk ");
+    expected = g_strconcat ("1", syllable, " ", NULL);
+    g_assert_cmpstr (fixture.text->str, ==, expected);
+    g_free (expected);
+
+    fixture_teardown (&fixture);
+}
+
+static void
+test_snippet_without_delete (void)
+{
+    Fixture fixture;
+    gchar *expected;
+
+    fixture_setup (&fixture, &callbacks);
+    fixture.can_delete = FALSE;
+    core_set_snippets (fixture.core, snippets, FALSE);
+
+    type (&fixture, "-rk ");
+    g_assert_cmpuint (fixture.n_candidates, ==, 0);
+    expected = g_strconcat ("-", syllable, " ", NULL);
+    g_assert_cmpstr (fixture.text->str, ==, expected);
+    g_free (expected);
+
+    fixture_teardown (&fixture);
+}
+
+static void
+test_snippet_offer (void)
+{
+    Fixture fixture;
+    gchar *expected;
+
+    fixture_setup (&fixture, &callbacks);
+    core_set_snippets (fixture.core, snippets, FALSE);
+
+    type (&fixture, "-rk ");
+    g_assert_cmpuint (fixture.n_candidates, ==, 1);
+
+    // Return and the digits go on to the application at first
+    g_assert (!core_process_key (fixture.core, KEY_Return));
+    g_assert_cmpuint (fixture.n_candidates, ==, 0);
+    type (&fixture, "1");
+    expected = g_strconcat ("-", syllable, " 1", NULL);
+    g_assert_cmpstr (fixture.text->str, ==, expected);
+    g_free (expected);
+
+    // and take from the offer once the user moves in it
+    type (&fixture, " -rk ");
+    g_assert_cmpuint (fixture.n_candidates, ==, 1);
+    g_assert (core_process_key (fixture.core, KEY_Down));
+    g_assert (core_process_key (fixture.core, KEY_Return));
+    expected = g_strconcat ("-", syllable, " 1 -" SNIPPET_VALUE " ", NULL);
+    g_assert_cmpstr (fixture.text->str, ==, expected);
+    g_free (expected);
+
+    fixture_teardown (&fixture);
+}
+
+static void
+test_escape (void)
+{
+    Fixture fixture;
+
+    fixture_setup (&fixture, &callbacks);
+
+    type (&fixture, "rk");
+    core_show_candidates (fixture.core);
+    g_assert (core_process_key (fixture.core, KEY_Escape));
+    g_assert_cmpuint (fixture.n_candidates, ==, 0);
+    g_assert_cmpstr (fixture.preedit->str, ==, syllable);
+    g_assert_cmpstr (fixture.text->str, ==, "");
+
+    fixture_teardown (&fixture);
+}
+
+static gchar*
+write_file (const gchar *contents)
+{
+    gchar *filename;
+    gint fd;
+
+    fd = g_file_open_tmp ("test-core-XXXXXX.txt", &filename, NULL);
+    g_assert (fd >= 0);
+    close (fd);
+    g_assert (g_file_set_contents (filename, contents, -1, NULL));
+
+    return filename;
+}
+
+/* Finds what "rk" composes, and makes the dictionary and the snippets
+ * of the tests with it. */
+static void
+load_dicts (void)
+{
+    CoreDicts *empty;
+    Core *core;
+    gchar *filename;
+    gchar *contents;
+
+    empty = core_dicts_load (NULL, NULL, NULL);
+    core = core_new (empty, "2");
+    core_process_key (core, 'r');
+    core_process_key (core, 'k');
+    syllable = g_ucs4_to_utf8 ((const gunichar *) core_get_preedit (core,
+                                                                    NULL),
+                               -1, NULL, NULL, NULL);
+    core_delete (core);
+    core_dicts_unref (empty);
+
+    contents = g_strdup_printf ("%s:%s:\n", syllable, HANJA_VALUE);
+    filename = write_file (contents);
+    dicts = core_dicts_load (filename, NULL, NULL);
+    g_unlink (filename);
+    g_free (filename);
+    g_free (contents);
+
+    contents = g_strdup_printf ("%s:%s:\n", syllable, SNIPPET_VALUE);
+    filename = write_file (contents);
+    snippets = snippet_table_load (filename);
+    g_assert (snippets != NULL);
+    g_unlink (filename);
+    g_free (filename);
+    g_free (contents);
+}
+
+int
+main (int argc, char **argv)
+{
+    gint res;
+
+    g_test_init (&argc, &argv, NULL);
+
+    load_dicts ();
+
+    g_test_add_func ("/core/compose", test_compose);
+    g_test_add_func ("/core/search-in-place", test_search_in_place);
+    g_test_add_func ("/core/search-async", test_search_async);
+    g_test_add_func ("/core/type-during-search", test_type_during_search);
+    g_test_add_func ("/core/reset-during-search", test_reset_during_search);
+    g_test_add_func ("/core/escape", test_escape);
+    g_test_add_func ("/core/snippet-expand", test_snippet_expand);
+    g_test_add_func ("/core/snippet-in-word", test_snippet_in_word);
+    g_test_add_func ("/core/snippet-without-delete",
+                     test_snippet_without_delete);
+    g_test_add_func ("/core/snippet-offer", test_snippet_offer);
+
+    res = g_test_run ();
+
+    snippet_table_unref (snippets);
+    core_dicts_unref (dicts);
+    g_free (syllable);
+
+    return res;
+}
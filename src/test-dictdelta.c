@@ -0,0 +1,252 @@
+/* vim:set et sts=4: */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <unistd.h>
+
+#include "dictdelta.h"
+
+/* Tests of DictDelta: a delta made by diff must give the new dictionary
+ * back, and one that doesn't fit must be turned down. */
+
+static const DictEntry old_entries[] = {
+    { "가", "佳", "아름다울 가" },
+    { "가", "家", "집 가" },
+    { "가", "可", "옳을 가" },
+    { "나", "那", "어찌 나" },
+    { "다", "多", "많을 다" },
+};
+
+static const DictEntry new_entries[] = {
+    // 可 moved first, 佳 with a new comment, 家 left out
+    { "가", "可", "옳을 가" },
+    { "가", "佳", "아름다울 가 (새)" },
+    { "나", "那", "어찌 나" },
+    { "나", "奈", "어찌 내" },
+    { "라", "羅", "벌릴 라" },
+};
+
+static gchar*
+tmp_file_new (const gchar *contents)
+{
+    gchar *filename;
+    gint fd;
+
+    fd = g_file_open_tmp ("test-dictdelta-XXXXXX.delta", &filename, NULL);
+    g_assert (fd >= 0);
+    close (fd);
+    if (contents != NULL)
+        g_assert (g_file_set_contents (filename, contents, -1, NULL));
+
+    return filename;
+}
+
+/* Loads the delta in contents, or gives the error code. */
+static DictDelta*
+delta_load (const gchar *contents, gint *code)
+{
+    DictDelta *delta;
+    GError *error = NULL;
+    gchar *filename;
+
+    filename = tmp_file_new (contents);
+    delta = dict_delta_load (filename, &error);
+    g_unlink (filename);
+    g_free (filename);
+
+    if (delta == NULL) {
+        g_assert (error != NULL);
+        g_assert (error->domain == DICT_DELTA_ERROR);
+        *code = error->code;
+        g_error_free (error);
+    }
+
+    return delta;
+}
+
+static void
+assert_same_entries (const Dictionary *a, const Dictionary *b)
+{
+    guint i;
+
+    g_assert_cmpuint (dictionary_get_n_keys (a), ==,
+                      dictionary_get_n_keys (b));
+    for (i = 0; i < dictionary_get_n_keys (a); ++i) {
+        const DictEntry *ea, *eb;
+        guint na, nb, j;
+
+        g_assert_cmpstr (dictionary_get_key (a, i), ==,
+                         dictionary_get_key (b, i));
+        ea = dictionary_get_entries (a, i, &na);
+        eb = dictionary_get_entries (b, i, &nb);
+        g_assert_cmpuint (na, ==, nb);
+        for (j = 0; j < na; ++j) {
+            g_assert_cmpstr (ea[j].value, ==, eb[j].value);
+            g_assert_cmpstr (ea[j].comment, ==, eb[j].comment);
+        }
+    }
+}
+
+static void
+test_diff (void)
+{
+    Dictionary *old_dict;
+    Dictionary *new_dict;
+    Dictionary *dict;
+    DictDelta *delta;
+    GError *error = NULL;
+    gchar *filename;
+    gchar *checksum;
+
+    old_dict = dictionary_new (old_entries, G_N_ELEMENTS (old_entries));
+    new_dict = dictionary_new (new_entries, G_N_ELEMENTS (new_entries));
+
+    filename = tmp_file_new (NULL);
+    g_assert (dict_delta_diff (old_dict, new_dict, 2, filename, NULL));
+    delta = dict_delta_load (filename, NULL);
+    g_unlink (filename);
+    g_free (filename);
+    g_assert (delta != NULL);
+
+    g_assert_cmpuint (dict_delta_get_version (delta), ==, 2);
+    checksum = dictionary_get_checksum (old_dict);
+    g_assert_cmpstr (dict_delta_get_base (delta), ==, checksum);
+    g_free (checksum);
+    checksum = dictionary_get_checksum (new_dict);
+    g_assert_cmpstr (dict_delta_get_result (delta), ==, checksum);
+    g_free (checksum);
+
+    dict = dict_delta_apply (delta, old_dict, NULL);
+    g_assert (dict != NULL);
+    assert_same_entries (dict, new_dict);
+    dictionary_delete (dict);
+
+    // not to the dictionary it makes
+    g_assert (dict_delta_apply (delta, new_dict, &error) == NULL);
+    g_assert (g_error_matches (error, DICT_DELTA_ERROR,
+                               DICT_DELTA_ERROR_BASE));
+    g_error_free (error);
+
+    dict_delta_free (delta);
+    dictionary_delete (new_dict);
+    dictionary_delete (old_dict);
+}
+
+/* A delta written by hand, with a change of each kind. */
+static void
+test_apply (void)
+{
+    static const DictEntry result_entries[] = {
+        { "가", "家", "집 가" },
+        { "가", "佳", "아름다울 가" },
+        { "나", "那", "어찌 나" },
+        { "다", "多", "많을 다" },
+        { "마", "馬", "말 마" },
+    };
+    Dictionary *base;
+    Dictionary *result;
+    Dictionary *dict;
+    DictDelta *delta;
+    GError *error = NULL;
+    gchar *base_sum;
+    gchar *result_sum;
+    gchar *contents;
+    gint code;
+
+    base = dictionary_new (old_entries, G_N_ELEMENTS (old_entries));
+    result = dictionary_new (result_entries, G_N_ELEMENTS (result_entries));
+    base_sum = dictionary_get_checksum (base);
+    result_sum = dictionary_get_checksum (result);
+
+    contents = g_strdup_printf ("# comments and blank lines are skipped\n"
+                                "\n"
+                                "@version 3\n"
+                                "@base %s\n"
+                                "@result %s\n"
+                                "-가:可\n"
+                                "+마:馬:말 마\n"
+                                "=가:家:0\n", base_sum, result_sum);
+    delta = delta_load (contents, &code);
+    g_free (contents);
+    g_assert (delta != NULL);
+    dict = dict_delta_apply (delta, base, NULL);
+    g_assert (dict != NULL);
+    assert_same_entries (dict, result);
+    dictionary_delete (dict);
+    dict_delta_free (delta);
+
+    // an entry that is not there
+    contents = g_strdup_printf ("@version 3\n@base %s\n@result %s\n"
+                                "-나:奈\n", base_sum, result_sum);
+    delta = delta_load (contents, &code);
+    g_free (contents);
+    g_assert (delta != NULL);
+    g_assert (dict_delta_apply (delta, base, &error) == NULL);
+    g_assert (g_error_matches (error, DICT_DELTA_ERROR,
+                               DICT_DELTA_ERROR_RESULT));
+    g_clear_error (&error);
+    dict_delta_free (delta);
+
+    // the changes apply, but don't give the result
+    contents = g_strdup_printf ("@version 3\n@base %s\n@result %s\n"
+                                "-가:可\n", base_sum, result_sum);
+    delta = delta_load (contents, &code);
+    g_free (contents);
+    g_assert (delta != NULL);
+    g_assert (dict_delta_apply (delta, base, &error) == NULL);
+    g_assert (g_error_matches (error, DICT_DELTA_ERROR,
+                               DICT_DELTA_ERROR_RESULT));
+    g_error_free (error);
+    dict_delta_free (delta);
+
+    g_free (result_sum);
+    g_free (base_sum);
+    dictionary_delete (result);
+    dictionary_delete (base);
+}
+
+static void
+test_parse (void)
+{
+    static const gchar *bad[] = {
+        // no header
+        "+가:加:더할 가\n",
+        "@version 1\n@base 00\n",
+        "@version 0\n@base 00\n@result 00\n",
+        // a line not understood
+        "@version 1\n@base 00\n@result 00\n*가:加\n",
+        "@version 1\n@base 00\n@result 00\n@size 3\n",
+        "@version 1\n@base 00\n@result 00\n+가\n",
+        "@version 1\n@base 00\n@result 00\n-:加\n",
+        "@version 1\n@base 00\n@result 00\n=가:加\n",
+        "@version 1\n@base 00\n@result 00\n=가:加:x\n",
+    };
+    GError *error = NULL;
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS (bad); ++i) {
+        gint code = -1;
+
+        g_assert (delta_load (bad[i], &code) == NULL);
+        g_assert_cmpint (code, ==, DICT_DELTA_ERROR_PARSE);
+    }
+
+    g_assert (dict_delta_load ("/nonexistent/1.delta", &error) == NULL);
+    g_assert (error != NULL);
+    g_error_free (error);
+}
+
+int
+main (int argc, char **argv)
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/dictdelta/diff", test_diff);
+    g_test_add_func ("/dictdelta/apply", test_apply);
+    g_test_add_func ("/dictdelta/parse", test_parse);
+
+    return g_test_run ();
+}
@@ -0,0 +1,279 @@
+/* vim:set et sts=4: */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <glib.h>
+#include <string.h>
+
+#include "dicttrie.h"
+
+/* Tests of DictTrie on a small dictionary whose keys share prefixes, so
+ * the LOUDS walk, the prefix matches and the completions can be checked
+ * by hand. */
+
+static const DictEntry entries[] = {
+    { "가",     "佳", "아름다울 가" },
+    { "가",     "家", "집 가" },
+    { "가나",   "假那", "" },
+    { "가나다", "ㄱㄴㄷ", "" },
+    { "가다",   "去", "갈 거" },
+    { "나",     "我", "나 아" },
+    { "나",     "家", "집 가" },
+    { "abc",    "ABC", "" },
+};
+
+static const gchar *missing_keys[] = {
+    "", "가가", "가나다라", "다", "ab", "abcd",
+};
+
+static DictTrie *trie = NULL;
+
+static void
+test_keys (void)
+{
+    GString *key;
+    guint i;
+
+    g_assert_cmpuint (dict_trie_get_n_keys (trie), ==, 6);
+
+    key = g_string_new (NULL);
+    for (i = 0; i < G_N_ELEMENTS (entries); ++i) {
+        gint id = dict_trie_find_key (trie, entries[i].key);
+
+        g_assert_cmpint (id, >=, 0);
+        dict_trie_get_key (trie, id, key);
+        g_assert_cmpstr (key->str, ==, entries[i].key);
+    }
+    g_string_free (key, TRUE);
+
+    for (i = 0; i < G_N_ELEMENTS (missing_keys); ++i)
+        g_assert_cmpint (dict_trie_find_key (trie, missing_keys[i]), ==, -1);
+}
+
+static void
+test_entries (void)
+{
+    gint id;
+
+    // in the order of the file
+    id = dict_trie_find_key (trie, "가");
+    g_assert_cmpuint (dict_trie_get_n_entries (trie, id), ==, 2);
+    g_assert_cmpstr (dict_trie_get_value (trie, id, 0), ==, "佳");
+    g_assert_cmpstr (dict_trie_get_comment (trie, id, 0), ==, "아름다울 가");
+    g_assert_cmpstr (dict_trie_get_value (trie, id, 1), ==, "家");
+
+    id = dict_trie_find_key (trie, "나");
+    g_assert_cmpuint (dict_trie_get_n_entries (trie, id), ==, 2);
+    g_assert_cmpstr (dict_trie_get_value (trie, id, 1), ==, "家");
+    g_assert_cmpstr (dict_trie_get_comment (trie, id, 1), ==, "집 가");
+}
+
+static void
+test_nodes (void)
+{
+    guint n_nodes = dict_trie_get_n_nodes (trie);
+    guint n_keys = 0;
+    guint node;
+
+    for (node = 1; node < n_nodes; ++node) {
+        g_assert_cmpuint (dict_trie_get_parent (trie, node), <, node);
+        if (dict_trie_get_node_key (trie, node) >= 0)
+            n_keys++;
+    }
+    g_assert_cmpint (dict_trie_get_node_key (trie, 0), ==, -1);
+    g_assert_cmpuint (n_keys, ==, dict_trie_get_n_keys (trie));
+}
+
+static void
+test_find_prefixes (void)
+{
+    GArray *key_ids;
+    GArray *lengths;
+    GString *key;
+
+    key_ids = g_array_new (FALSE, FALSE, sizeof (guint));
+    lengths = g_array_new (FALSE, FALSE, sizeof (guint));
+    key = g_string_new (NULL);
+
+    g_assert_cmpuint (dict_trie_find_prefixes (trie, "가나다라", key_ids,
+                                               lengths), ==, 3);
+    // longest first
+    dict_trie_get_key (trie, g_array_index (key_ids, guint, 0), key);
+    g_assert_cmpstr (key->str, ==, "가나다");
+    g_assert_cmpuint (g_array_index (lengths, guint, 0), ==,
+                      strlen ("가나다"));
+    dict_trie_get_key (trie, g_array_index (key_ids, guint, 2), key);
+    g_assert_cmpstr (key->str, ==, "가");
+    g_assert_cmpuint (g_array_index (lengths, guint, 2), ==, strlen ("가"));
+
+    g_array_set_size (key_ids, 0);
+    g_array_set_size (lengths, 0);
+    g_assert_cmpuint (dict_trie_find_prefixes (trie, "다", key_ids,
+                                               lengths), ==, 0);
+
+    g_string_free (key, TRUE);
+    g_array_free (key_ids, TRUE);
+    g_array_free (lengths, TRUE);
+}
+
+static void
+test_match_prefix (void)
+{
+    CandidateList *list;
+
+    list = candidate_list_new ();
+    g_assert_cmpuint (dict_trie_match_prefix (trie, NULL, "가나다", list),
+                      ==, 3);
+    g_assert_cmpuint (candidate_list_get_size (list), ==, 4);
+    g_assert_cmpstr (candidate_list_get_nth_value (list, 0), ==, "ㄱㄴㄷ");
+    g_assert_cmpstr (candidate_list_get_nth_key (list, 0), ==, "가나다");
+    g_assert_cmpstr (candidate_list_get_nth_value (list, 1), ==, "假那");
+    g_assert_cmpstr (candidate_list_get_nth_value (list, 2), ==, "佳");
+    g_assert_cmpstr (candidate_list_get_nth_value (list, 3), ==, "家");
+    candidate_list_delete (list);
+}
+
+/* A search taken a few entries at a time finds what match_prefix does. */
+static void
+test_search (void)
+{
+    CandidateList *all;
+    CandidateList *list;
+    DictTrieSearch *search;
+    guint i;
+
+    all = candidate_list_new ();
+    dict_trie_match_prefix (trie, NULL, "가나다", all);
+
+    list = candidate_list_new ();
+    search = dict_trie_search_new (trie, NULL, "가나다");
+    g_assert_cmpuint (dict_trie_search_get_total (search), ==,
+                      candidate_list_get_size (all));
+    g_assert_cmpuint (dict_trie_search_next (search, 3, list), ==, 3);
+    g_assert_cmpuint (dict_trie_search_next (search, 3, list), ==, 1);
+    g_assert_cmpuint (dict_trie_search_next (search, 3, list), ==, 0);
+    dict_trie_search_free (search);
+
+    g_assert_cmpuint (candidate_list_get_size (list), ==,
+                      candidate_list_get_size (all));
+    for (i = 0; i < candidate_list_get_size (all); ++i) {
+        g_assert_cmpstr (candidate_list_get_nth_value (list, i), ==,
+                         candidate_list_get_nth_value (all, i));
+        g_assert_cmpuint (candidate_list_get_nth_length (list, i), ==,
+                          candidate_list_get_nth_length (all, i));
+    }
+
+    candidate_list_delete (list);
+    candidate_list_delete (all);
+}
+
+static void
+test_complete (void)
+{
+    CandidateList *list;
+
+    list = candidate_list_new ();
+    g_assert_cmpuint (dict_trie_complete (trie, NULL, "가", 10, list),
+                      ==, 4);
+    // in sorted order of the keys
+    g_assert_cmpstr (candidate_list_get_nth_key (list, 0), ==, "가");
+    g_assert_cmpstr (candidate_list_get_nth_key (list, 2), ==, "가나");
+    g_assert_cmpstr (candidate_list_get_nth_key (list, 3), ==, "가나다");
+    g_assert_cmpstr (candidate_list_get_nth_key (list, 4), ==, "가다");
+    candidate_list_delete (list);
+
+    list = candidate_list_new ();
+    g_assert_cmpuint (dict_trie_complete (trie, NULL, "가", 2, list),
+                      ==, 2);
+    g_assert_cmpuint (candidate_list_get_size (list), ==, 3);
+    candidate_list_delete (list);
+}
+
+static gboolean
+accept_not_house (const gchar *value, gpointer user_data)
+{
+    return strcmp (value, "家") != 0;
+}
+
+static void
+test_mask (void)
+{
+    CandidateList *list;
+    DictMask *mask;
+    gint id;
+
+    mask = dict_mask_new (trie, accept_not_house, NULL);
+
+    id = dict_trie_find_key (trie, "가");
+    g_assert (dict_trie_entry_visible (trie, mask, id, 0));
+    g_assert (!dict_trie_entry_visible (trie, mask, id, 1));
+    g_assert (dict_trie_entry_visible (trie, NULL, id, 1));
+
+    list = candidate_list_new ();
+    dict_trie_match_prefix (trie, mask, "가나다", list);
+    g_assert_cmpuint (candidate_list_get_size (list), ==, 3);
+    g_assert_cmpstr (candidate_list_get_nth_value (list, 2), ==, "佳");
+    candidate_list_delete (list);
+
+    dict_mask_delete (mask);
+}
+
+static void
+test_to_dictionary (void)
+{
+    Dictionary *dict;
+    guint i;
+
+    dict = dict_trie_to_dictionary (trie);
+    g_assert_cmpuint (dictionary_get_n_keys (dict), ==,
+                      dict_trie_get_n_keys (trie));
+
+    for (i = 0; i < dictionary_get_n_keys (dict); ++i) {
+        const DictEntry *dict_entries;
+        guint n, j;
+        gint id;
+
+        id = dict_trie_find_key (trie, dictionary_get_key (dict, i));
+        g_assert_cmpint (id, >=, 0);
+        dict_entries = dictionary_get_entries (dict, i, &n);
+        g_assert_cmpuint (n, ==, dict_trie_get_n_entries (trie, id));
+        for (j = 0; j < n; ++j) {
+            g_assert_cmpstr (dict_entries[j].value, ==,
+                             dict_trie_get_value (trie, id, j));
+            g_assert_cmpstr (dict_entries[j].comment, ==,
+                             dict_trie_get_comment (trie, id, j));
+        }
+    }
+
+    dictionary_delete (dict);
+}
+
+int
+main (int argc, char **argv)
+{
+    Dictionary *dict;
+    gint res;
+
+    g_test_init (&argc, &argv, NULL);
+
+    dict = dictionary_new (entries, G_N_ELEMENTS (entries));
+    trie = dict_trie_new (dict);
+    dictionary_delete (dict);
+
+    g_test_add_func ("/dicttrie/keys", test_keys);
+    g_test_add_func ("/dicttrie/entries", test_entries);
+    g_test_add_func ("/dicttrie/nodes", test_nodes);
+    g_test_add_func ("/dicttrie/find-prefixes", test_find_prefixes);
+    g_test_add_func ("/dicttrie/match-prefix", test_match_prefix);
+    g_test_add_func ("/dicttrie/search", test_search);
+    g_test_add_func ("/dicttrie/complete", test_complete);
+    g_test_add_func ("/dicttrie/mask", test_mask);
+    g_test_add_func ("/dicttrie/to-dictionary", test_to_dictionary);
+
+    res = g_test_run ();
+
+    dict_trie_delete (trie);
+
+    return res;
+}
@@ -0,0 +1,103 @@
+/* vim:set et sts=4: */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <ibus.h>
+
+#include "engine.h"
+
+/* Tests of the engine that need IBus, on engines that are not connected
+ * to the bus, as ibus-hangul-bench-engine runs them. */
+
+static guint serial = 0;
+
+static IBusEngine*
+engine_new (void)
+{
+    IBusEngine *engine;
+    gchar *path;
+
+    path = g_strdup_printf ("/org/freedesktop/IBus/Engine/Test/%u",
+                            ++serial);
+    engine = g_object_new (IBUS_TYPE_HANGUL_ENGINE,
+                           "name", "hangul",
+                           "path", path,
+                           NULL);
+    g_free (path);
+
+    return engine;
+}
+
+static void
+engine_free (IBusEngine *engine)
+{
+    ibus_object_destroy ((IBusObject *) engine);
+    g_object_unref (engine);
+}
+
+/* The panel drops the properties on every focus out, so they have to be
+ * registered again on the next focus in. */
+static void
+test_focus_properties (void)
+{
+    IBusEngine *engine;
+    IBusEngine *other;
+    IBusEngineClass *klass;
+    guint n;
+
+    engine = engine_new ();
+    other = engine_new ();
+    klass = IBUS_ENGINE_GET_CLASS (engine);
+
+    n = ibus_hangul_engine_get_n_registrations ();
+    klass->focus_in (engine);
+    g_assert_cmpuint (ibus_hangul_engine_get_n_registrations (), ==, n + 1);
+
+    klass->focus_out (engine);
+    klass->focus_in (engine);
+    g_assert_cmpuint (ibus_hangul_engine_get_n_registrations (), ==, n + 2);
+
+    // without a focus out the panel still has them
+    klass->focus_in (engine);
+    g_assert_cmpuint (ibus_hangul_engine_get_n_registrations (), ==, n + 2);
+
+    klass->focus_out (engine);
+    klass->focus_in (other);
+    g_assert_cmpuint (ibus_hangul_engine_get_n_registrations (), ==, n + 3);
+    klass->focus_out (other);
+    klass->focus_in (engine);
+    g_assert_cmpuint (ibus_hangul_engine_get_n_registrations (), ==, n + 4);
+
+    // and when the engine is switched away from
+    klass->disable (engine);
+    klass->enable (engine);
+    klass->focus_in (engine);
+    g_assert_cmpuint (ibus_hangul_engine_get_n_registrations (), ==, n + 5);
+
+    engine_free (other);
+    engine_free (engine);
+}
+
+int
+main (int argc, char **argv)
+{
+    gint res;
+
+    if (!g_thread_supported ())
+        g_thread_init (NULL);
+
+    g_test_init (&argc, &argv, NULL);
+
+    ibus_init ();
+    ibus_hangul_init (NULL);
+    ibus_hangul_engine_set_pool_size (0);
+
+    g_test_add_func ("/engine/focus-properties", test_focus_properties);
+
+    res = g_test_run ();
+
+    ibus_hangul_exit ();
+
+    return res;
+}
@@ -0,0 +1,110 @@
+/* vim:set et sts=4: */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <glib.h>
+
+#include "fuzzyindex.h"
+
+/* Tests of FuzzyIndex: every key one jamo edit away is found, of each
+ * kind of edit, and none further away. */
+
+static const DictEntry entries[] = {
+    { "한국", "韓國", "" },
+    { "한국어", "韓國語", "" },
+    { "학교", "學校", "" },
+    { "가", "家", "" },
+    { "나", "那", "" },
+    { "abc", "ABC", "" },
+};
+
+static DictTrie *trie = NULL;
+static FuzzyIndex *fuzzy = NULL;
+
+/* Returns the values found for key, joined with spaces. */
+static gchar*
+search (const gchar *key)
+{
+    CandidateList *list;
+    GString *str;
+    guint i;
+
+    list = candidate_list_new ();
+    fuzzy_index_search (fuzzy, NULL, key, list);
+
+    str = g_string_new (NULL);
+    for (i = 0; i < candidate_list_get_size (list); ++i) {
+        if (i > 0)
+            g_string_append_c (str, ' ');
+        g_string_append (str, candidate_list_get_nth_value (list, i));
+        // the whole reading is replaced
+        g_assert_cmpuint (candidate_list_get_nth_length (list, i), ==,
+                          g_utf8_strlen (key, -1));
+    }
+    candidate_list_delete (list);
+
+    return g_string_free (str, FALSE);
+}
+
+static void
+assert_search (const gchar *key, const gchar *expected)
+{
+    gchar *values = search (key);
+
+    g_assert_cmpstr (values, ==, expected);
+    g_free (values);
+}
+
+static void
+test_one_edit (void)
+{
+    // ㄴ changed to ㅇ
+    assert_search ("항국", "韓國");
+    // ㄴ left out
+    assert_search ("하국", "韓國");
+    assert_search ("하교", "學校");
+    // ㄹ put in
+    assert_search ("한국얼", "韓國語");
+    // in the order of the keys
+    assert_search ("다", "家 那");
+    // two swapped
+    assert_search ("acb", "ABC");
+}
+
+static void
+test_not_found (void)
+{
+    // the exact key is not a near miss
+    assert_search ("한국", "");
+    // two edits away
+    assert_search ("항귝", "");
+    assert_search ("더", "");
+    // bc is left of both, but they are two edits apart
+    assert_search ("bcd", "");
+    assert_search ("", "");
+}
+
+int
+main (int argc, char **argv)
+{
+    Dictionary *dict;
+    gint res;
+
+    g_test_init (&argc, &argv, NULL);
+
+    dict = dictionary_new (entries, G_N_ELEMENTS (entries));
+    trie = dict_trie_new (dict);
+    dictionary_delete (dict);
+    fuzzy = fuzzy_index_new (trie);
+
+    g_test_add_func ("/fuzzyindex/one-edit", test_one_edit);
+    g_test_add_func ("/fuzzyindex/not-found", test_not_found);
+
+    res = g_test_run ();
+
+    fuzzy_index_delete (fuzzy);
+    dict_trie_delete (trie);
+
+    return res;
+}
@@ -0,0 +1,182 @@
+/* vim:set et sts=4: */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "snippet.h"
+
+/* Tests of SnippetTable on keys that end one another and overlap, so
+ * the failure links are taken. The matches are also checked against a
+ * plain search over random text. */
+
+static const DictEntry entries[] = {
+    { "ㄱㅅ",   "감사합니다", "" },
+    { "ㅅ",     "수고하세요", "" },
+    { "ㄱㅅㄱ", "감사감사", "" },
+    { "abcd",   "ABCD", "" },
+    { "bc",     "BC", "" },
+    { "c",      "C", "" },
+    { "bcx",    "BCX", "" },
+};
+
+static SnippetTable *table = NULL;
+
+/* Returns the key of the match after text, or NULL. */
+static const gchar*
+match_after (const gchar *text)
+{
+    static GString *key = NULL;
+    guint state = SNIPPET_STATE_START;
+    const gchar *p;
+    gint id;
+
+    for (p = text; *p != '\0'; p = g_utf8_next_char (p))
+        state = snippet_table_step (table, state, g_utf8_get_char (p));
+
+    id = snippet_table_get_match (table, state);
+    if (id < 0)
+        return NULL;
+
+    if (key == NULL)
+        key = g_string_new (NULL);
+    dict_trie_get_key (snippet_table_get_trie (table), id, key);
+    return key->str;
+}
+
+static void
+test_match (void)
+{
+    g_assert (match_after ("") == NULL);
+    g_assert_cmpstr (match_after ("ㄱㅅ"), ==, "ㄱㅅ");
+    g_assert_cmpstr (match_after ("ㄴㄱㅅ"), ==, "ㄱㅅ");
+    g_assert_cmpstr (match_after ("ㄱㅅㄱ"), ==, "ㄱㅅㄱ");
+    // a shorter key at the end of a longer one
+    g_assert_cmpstr (match_after ("ㄴㅅ"), ==, "ㅅ");
+    g_assert_cmpstr (match_after ("abc"), ==, "bc");
+    g_assert_cmpstr (match_after ("abcd"), ==, "abcd");
+    g_assert_cmpstr (match_after ("abcx"), ==, "bcx");
+    g_assert (match_after ("ㄱ") == NULL);
+    g_assert (match_after ("abcde") == NULL);
+    g_assert (match_after ("ab") == NULL);
+    // from the middle of a key that failed
+    g_assert (match_after ("abcab") == NULL);
+    g_assert_cmpstr (match_after ("abcabc"), ==, "bc");
+    g_assert_cmpstr (match_after ("abdbcx"), ==, "bcx");
+}
+
+static void
+test_random (void)
+{
+    static const gunichar alphabet[] = {
+        0x3131, 0x3134, 0x3145, 'a', 'b', 'c', 'd', 'x'
+    };
+    const DictTrie *trie = snippet_table_get_trie (table);
+    GString *text;
+    GString *key;
+    GRand *rand;
+    guint state = SNIPPET_STATE_START;
+    guint i, j;
+
+    text = g_string_new (NULL);
+    key = g_string_new (NULL);
+    rand = g_rand_new_with_seed (20100521);
+
+    for (i = 0; i < 2000; ++i) {
+        gunichar c;
+        gint longest = -1;
+        gint id;
+
+        c = alphabet[g_rand_int_range (rand, 0, G_N_ELEMENTS (alphabet))];
+        g_string_append_unichar (text, c);
+        state = snippet_table_step (table, state, c);
+
+        for (j = 0; j < G_N_ELEMENTS (entries); ++j) {
+            gsize len = strlen (entries[j].key);
+
+            if (len <= text->len &&
+                memcmp (text->str + text->len - len, entries[j].key,
+                        len) == 0 &&
+                (longest < 0 || len > strlen (entries[longest].key)))
+                longest = j;
+        }
+
+        id = snippet_table_get_match (table, state);
+        if (longest < 0) {
+            g_assert_cmpint (id, ==, -1);
+        } else {
+            g_assert_cmpint (id, >=, 0);
+            dict_trie_get_key (trie, id, key);
+            g_assert_cmpstr (key->str, ==, entries[longest].key);
+        }
+    }
+
+    g_rand_free (rand);
+    g_string_free (key, TRUE);
+    g_string_free (text, TRUE);
+}
+
+static void
+test_load (void)
+{
+    SnippetTable *loaded;
+    const DictTrie *trie;
+    gchar *filename;
+    guint state = SNIPPET_STATE_START;
+    gint fd;
+    gint id;
+
+    fd = g_file_open_tmp ("test-snippet-XXXXXX.txt", &filename, NULL);
+    g_assert (fd >= 0);
+    close (fd);
+    g_assert (g_file_set_contents (filename,
+                                   "ㅇㄴ:안녕하세요:인사\n", -1, NULL));
+
+    loaded = snippet_table_load (filename);
+    g_unlink (filename);
+    g_free (filename);
+    g_assert (loaded != NULL);
+
+    state = snippet_table_step (loaded, state, 0x3147);   // ㅇ
+    g_assert_cmpint (snippet_table_get_match (loaded, state), ==, -1);
+    state = snippet_table_step (loaded, state, 0x3134);   // ㄴ
+    id = snippet_table_get_match (loaded, state);
+    g_assert_cmpint (id, >=, 0);
+    trie = snippet_table_get_trie (loaded);
+    g_assert_cmpstr (dict_trie_get_value (trie, id, 0), ==, "안녕하세요");
+
+    // shared, so it lives until the last unref
+    snippet_table_ref (loaded);
+    snippet_table_unref (loaded);
+    g_assert (snippet_table_get_trie (loaded) == trie);
+    snippet_table_unref (loaded);
+
+    g_assert (snippet_table_load ("/nonexistent/snippets.txt") == NULL);
+}
+
+int
+main (int argc, char **argv)
+{
+    Dictionary *dict;
+    gint res;
+
+    g_test_init (&argc, &argv, NULL);
+
+    dict = dictionary_new (entries, G_N_ELEMENTS (entries));
+    table = snippet_table_new (dict_trie_new (dict));
+    dictionary_delete (dict);
+
+    g_test_add_func ("/snippet/match", test_match);
+    g_test_add_func ("/snippet/random", test_random);
+    g_test_add_func ("/snippet/load", test_load);
+
+    res = g_test_run ();
+
+    snippet_table_unref (table);
+
+    return res;
+}
@@ -0,0 +1,346 @@
+/* vim:set et sts=4: */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef HAVE_EXECINFO_H
+#include <execinfo.h>
+#include <pthread.h>
+#include <signal.h>
+#endif
+
+/* The main thread is asked for its backtrace with a real-time signal,
+ * so SIGPROF is left to profilers. */
+#if defined (HAVE_EXECINFO_H) && defined (SIGRTMIN)
+#define WATCHDOG_BACKTRACE
+#define WATCHDOG_SIGNAL         (SIGRTMIN + 2)
+#endif
+
+#include "watchdog.h"
+
+/* reports logged at most in an interval, the rest are counted */
+#define WATCHDOG_LOG_BURST      5
+#define WATCHDOG_LOG_INTERVAL   (60 * G_USEC_PER_SEC)
+
+/* frames of a backtrace, and how long to wait for the main thread */
+#define WATCHDOG_MAX_FRAMES     32
+#define WATCHDOG_SIGNAL_WAIT    (100 * 1000)
+
+struct _Watchdog {
+    guint64         threshold;      /* µs */
+    guint64         tick;           /* µs between checks */
+    GThread        *thread;
+    volatile gint   quit;
+
+    // Written by the main thread only. The fields below serial are
+    // written while it is even, and read by the watchdog thread while
+    // it is odd, i.e. while a callback runs.
+    volatile gint   serial;
+    guint           depth;
+    guint64         start;
+    WatchdogPhase   phase;
+    guint           preedit_length;
+    guint           n_candidates;
+    guint           histogram[WATCHDOG_N_BUCKETS];
+
+    // the watchdog thread only
+    gint            reported;
+    guint64         log_start;
+    guint           n_logged;
+    guint           n_suppressed;
+
+#ifdef WATCHDOG_BACKTRACE
+    gboolean         has_signal;
+    pthread_t        main_thread;
+    struct sigaction old_action;
+#endif
+};
+
+static const gchar * const phase_names[] = {
+    "key event",
+    "focus in",
+    "focus out",
+    "reset",
+    "config change",
+};
+
+#ifdef WATCHDOG_BACKTRACE
+/* filled by the signal handler on the main thread */
+static void *backtrace_frames[WATCHDOG_MAX_FRAMES];
+static volatile gint backtrace_size = -1;
+
+static void
+watchdog_signal_handler (int signum)
+{
+    g_atomic_int_set (&backtrace_size,
+                      backtrace (backtrace_frames, WATCHDOG_MAX_FRAMES));
+}
+#endif
+
+static guint64
+watchdog_now (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (guint64) ts.tv_sec * G_USEC_PER_SEC + ts.tv_nsec / 1000;
+}
+
+/* Appends where the main thread is now to str. */
+static void
+watchdog_append_backtrace (Watchdog *watchdog, GString *str)
+{
+#ifdef WATCHDOG_BACKTRACE
+    guint64 deadline;
+    gchar **symbols;
+    gint size;
+    gint i;
+
+    // The main thread has to take its own backtrace, so it is
+    // interrupted with a signal. It may be in a system call that the
+    // signal ends early, which GLib retries.
+    if (!watchdog->has_signal)
+        return;
+
+    g_atomic_int_set (&backtrace_size, -1);
+    if (pthread_kill (watchdog->main_thread, WATCHDOG_SIGNAL) != 0)
+        return;
+
+    deadline = watchdog_now () + WATCHDOG_SIGNAL_WAIT;
+    while ((size = g_atomic_int_get (&backtrace_size)) < 0) {
+        if (watchdog_now () > deadline)
+            return;
+        g_usleep (1000);
+    }
+
+    symbols = backtrace_symbols (backtrace_frames, size);
+    if (symbols == NULL)
+        return;
+
+    // the first two frames are the signal handler
+    for (i = 2; i < size; i++)
+        g_string_append_printf (str, "\n  #%d %s", i - 2, symbols[i]);
+    free (symbols);
+#endif
+}
+
+static void
+watchdog_report (Watchdog      *watchdog,
+                 WatchdogPhase  phase,
+                 guint          preedit_length,
+                 guint          n_candidates,
+                 guint64        elapsed)
+{
+    guint64 now = watchdog_now ();
+    GString *str;
+
+    if (now - watchdog->log_start >= WATCHDOG_LOG_INTERVAL) {
+        watchdog->log_start = now;
+        watchdog->n_logged = 0;
+    }
+
+    if (watchdog->n_logged >= WATCHDOG_LOG_BURST) {
+        watchdog->n_suppressed++;
+        return;
+    }
+    watchdog->n_logged++;
+
+    str = g_string_new (NULL);
+    g_string_append_printf (str,
+            "main loop stalled for %" G_GUINT64_FORMAT " ms in %s: "
+            "preedit %u characters, %u candidates",
+            elapsed / 1000, phase_names[phase],
+            preedit_length, n_candidates);
+    if (watchdog->n_suppressed > 0) {
+        g_string_append_printf (str, " (%u more stalls not logged)",
+                                watchdog->n_suppressed);
+        watchdog->n_suppressed = 0;
+    }
+    watchdog_append_backtrace (watchdog, str);
+
+    g_message ("%s", str->str);
+    g_string_free (str, TRUE);
+}
+
+static gpointer
+watchdog_thread_func (gpointer data)
+{
+    Watchdog *watchdog = data;
+
+    while (!g_atomic_int_get (&watchdog->quit)) {
+        WatchdogPhase phase;
+        guint preedit_length;
+        guint n_candidates;
+        guint64 start;
+        gint serial;
+
+        g_usleep (watchdog->tick);
+
+        serial = g_atomic_int_get (&watchdog->serial);
+        if (serial % 2 == 0 || serial == watchdog->reported)
+            continue;
+
+        start = watchdog->start;
+        phase = watchdog->phase;
+        preedit_length = watchdog->preedit_length;
+        n_candidates = watchdog->n_candidates;
+
+        // the callback may have ended while the fields were read
+        if (g_atomic_int_get (&watchdog->serial) != serial)
+            continue;
+
+        if (watchdog_now () - start < watchdog->threshold)
+            continue;
+
+        // one report for each stall
+        watchdog->reported = serial;
+        watchdog_report (watchdog, phase, preedit_length, n_candidates,
+                         watchdog_now () - start);
+    }
+
+    return NULL;
+}
+
+Watchdog*
+watchdog_new (guint threshold)
+{
+    Watchdog *watchdog;
+
+    watchdog = g_new0 (Watchdog, 1);
+    watchdog->threshold = (guint64) MAX (threshold, 1) * 1000;
+    watchdog->tick = MAX (watchdog->threshold / 4, 5000);
+    watchdog->reported = -1;
+
+#ifdef WATCHDOG_BACKTRACE
+    {
+        struct sigaction action;
+
+        // backtrace() loads what it needs on the first call, which is
+        // not safe in a signal handler
+        backtrace (backtrace_frames, WATCHDOG_MAX_FRAMES);
+
+        memset (&action, 0, sizeof (action));
+        action.sa_handler = watchdog_signal_handler;
+        action.sa_flags = SA_RESTART;
+        sigemptyset (&action.sa_mask);
+        if (sigaction (WATCHDOG_SIGNAL, &action,
+                       &watchdog->old_action) == 0) {
+            // A handler there is someone else's: it is put back, and
+            // the reports go without backtraces.
+            if (watchdog->old_action.sa_handler != SIG_DFL &&
+                watchdog->old_action.sa_handler != SIG_IGN)
+                sigaction (WATCHDOG_SIGNAL, &watchdog->old_action, NULL);
+            else
+                watchdog->has_signal = TRUE;
+        }
+        watchdog->main_thread = pthread_self ();
+    }
+#endif
+
+    watchdog->thread = g_thread_create (watchdog_thread_func, watchdog,
+                                        TRUE, NULL);
+    if (watchdog->thread == NULL) {
+        watchdog_delete (watchdog);
+        return NULL;
+    }
+
+    return watchdog;
+}
+
+void
+watchdog_delete (Watchdog *watchdog)
+{
+    if (watchdog == NULL)
+        return;
+
+    if (watchdog->thread != NULL) {
+        g_atomic_int_set (&watchdog->quit, TRUE);
+        g_thread_join (watchdog->thread);
+    }
+
+#ifdef WATCHDOG_BACKTRACE
+    if (watchdog->has_signal)
+        sigaction (WATCHDOG_SIGNAL, &watchdog->old_action, NULL);
+#endif
+
+    g_free (watchdog);
+}
+
+void
+watchdog_enter (Watchdog       *watchdog,
+                WatchdogPhase   phase,
+                guint           preedit_length,
+                guint           n_candidates)
+{
+    if (watchdog == NULL)
+        return;
+
+    // only the outermost callback is timed
+    if (watchdog->depth++ > 0)
+        return;
+
+    watchdog->start = watchdog_now ();
+    watchdog->phase = phase;
+    watchdog->preedit_length = preedit_length;
+    watchdog->n_candidates = n_candidates;
+    g_atomic_int_inc (&watchdog->serial);
+}
+
+void
+watchdog_leave (Watchdog *watchdog)
+{
+    guint64 elapsed;
+    guint i;
+
+    if (watchdog == NULL || watchdog->depth == 0)
+        return;
+
+    if (--watchdog->depth > 0)
+        return;
+
+    g_atomic_int_inc (&watchdog->serial);
+
+    elapsed = watchdog_now () - watchdog->start;
+    if (elapsed < watchdog->threshold)
+        return;
+
+    for (i = 0; i < WATCHDOG_N_BUCKETS - 1; i++) {
+        if (elapsed < watchdog->threshold << (i + 1))
+            break;
+    }
+    watchdog->histogram[i]++;
+}
+
+void
+watchdog_log_histogram (Watchdog *watchdog)
+{
+    GString *str;
+    guint total = 0;
+    guint i;
+
+    if (watchdog == NULL)
+        return;
+
+    for (i = 0; i < WATCHDOG_N_BUCKETS; i++)
+        total += watchdog->histogram[i];
+    if (total == 0)
+        return;
+
+    str = g_string_new (NULL);
+    g_string_append_printf (str, "%u main loop stalls:", total);
+    for (i = 0; i < WATCHDOG_N_BUCKETS; i++) {
+        if (i < WATCHDOG_N_BUCKETS - 1)
+            g_string_append_printf (str, " <%" G_GUINT64_FORMAT "ms: %u",
+                                    (watchdog->threshold << (i + 1)) / 1000,
+                                    watchdog->histogram[i]);
+        else
+            g_string_append_printf (str, " more: %u", watchdog->histogram[i]);
+    }
+
+    g_message ("%s", str->str);
+    g_string_free (str, TRUE);
+}
@@ -0,0 +1,42 @@
+/* vim:set et sts=4: */
+#ifndef __WATCHDOG_H__
+#define __WATCHDOG_H__
+
+#include <glib.h>
+
+/* Watchdog reports callbacks that hold up the main loop. The main loop
+ * marks where a callback starts and ends; a thread of its own checks
+ * on it, and when a callback runs longer than the threshold, logs what
+ * the engine was doing, with a backtrace of the main thread where the
+ * system can give one. Reports are rate limited. The duration of every
+ * stall goes to a histogram, which is logged on request. */
+typedef struct _Watchdog Watchdog;
+
+typedef enum {
+    WATCHDOG_PHASE_KEY = 0,
+    WATCHDOG_PHASE_FOCUS_IN,
+    WATCHDOG_PHASE_FOCUS_OUT,
+    WATCHDOG_PHASE_RESET,
+    WATCHDOG_PHASE_CONFIG,
+} WatchdogPhase;
+
+/* buckets of the histogram: [1, 2), [2, 4), ... times the threshold */
+#define WATCHDOG_N_BUCKETS  8
+
+/* Must be called on the main thread. threshold is in ms. */
+Watchdog*   watchdog_new            (guint           threshold);
+void        watchdog_delete         (Watchdog       *watchdog);
+
+/* A callback of the main loop starts, with the state of the engine
+ * that a report shows. watchdog can be NULL. */
+void        watchdog_enter          (Watchdog       *watchdog,
+                                     WatchdogPhase   phase,
+                                     guint           preedit_length,
+                                     guint           n_candidates);
+/* The callback is done. Does nothing without a watchdog_enter(). */
+void        watchdog_leave          (Watchdog       *watchdog);
+
+/* Logs the stall counts, if there were any. */
+void        watchdog_log_histogram  (Watchdog       *watchdog);
+
+#endif